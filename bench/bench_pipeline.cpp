@@ -0,0 +1,616 @@
+// Times each stage of the detect -> subpix -> solvePnP -> projectPoints
+// pipeline over the images in the configured directory.
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "calib/calib.hpp"
+
+namespace {
+
+constexpr int kIterations = 20;
+constexpr int kRefineViews = 2000;
+constexpr int kCachedImages = 2000;
+
+struct StageTimes {
+    std::vector<std::string> order;
+    std::map<std::string, double> total_ms;
+    std::map<std::string, int> count;
+
+    void add(const std::string& stage, int64_t ticks) {
+        if (!total_ms.count(stage)) order.push_back(stage);
+        total_ms[stage] += ticks * 1000.0 / cv::getTickFrequency();
+        count[stage]++;
+    }
+};
+
+// Bundle adjustment of a large synthetic capture: kRefineViews noisy views
+// of the board, starting from intrinsics that are a few percent off
+void benchRefinement(const std::vector<cv::Vec3f>& point_set) {
+    calib::Intrinsics truth;
+    truth.camera_matrix = (cv::Mat_<double>(3, 3) << 1400, 0, 960, 0, 1400, 540, 0, 0, 1);
+    truth.dist_coeffs = (cv::Mat_<double>(5, 1) << -0.12, 0.05, 0.0005, -0.0005, 0.0);
+    cv::RNG rng(1);
+
+    std::vector<std::vector<cv::Vec3f>> object_points(kRefineViews, point_set);
+    std::vector<std::vector<cv::Point2f>> image_points(kRefineViews);
+    calib::CalibrationResult result;
+    result.intrinsics.camera_matrix = (cv::Mat_<double>(3, 3) << 1350, 0, 940, 0, 1450, 560, 0, 0, 1);
+    result.intrinsics.dist_coeffs = cv::Mat::zeros(5, 1, CV_64F);
+    for (int v = 0; v < kRefineViews; ++v) {
+        cv::Mat rvec = (cv::Mat_<double>(3, 1) << rng.uniform(-0.6, 0.6), rng.uniform(-0.6, 0.6), rng.uniform(-0.4, 0.4));
+        cv::Mat tvec = (cv::Mat_<double>(3, 1) << rng.uniform(-8.0, 0.0), rng.uniform(-3.0, 3.0), rng.uniform(12.0, 30.0));
+        calib::projectPoints(point_set, rvec, tvec, truth, image_points[v]);
+        for (auto& c : image_points[v]) {
+            c.x += static_cast<float>(rng.gaussian(0.2));
+            c.y += static_cast<float>(rng.gaussian(0.2));
+        }
+        result.rvecs.push_back(rvec);
+        result.tvecs.push_back(tvec);
+    }
+
+    calib::RefineReport report;
+    if (!calib::refineCalibration(object_points, image_points, calib::RefineOptions(), result, report)) {
+        return;
+    }
+    std::cout << "refineCalibration: " << kRefineViews << " views, RMS " << report.initial_rms << " -> "
+              << report.final_rms << " px, " << report.iterations << " iterations, " << report.seconds * 1000.0
+              << " ms" << std::endl;
+}
+
+// Per-frame cost of the annotated output: PNG encoding as task5 used to do
+// on every detected frame against publishing into the shared-memory ring
+void benchFrameOutput(const cv::Mat& frame) {
+    const std::string name = "/calib_bench_frames";
+    calib::FramePublisher publisher;
+    if (!publisher.open(name, 8, frame.total() * frame.elemSize())) {
+        return;
+    }
+    std::vector<uchar> png;
+    int64_t t0 = cv::getTickCount();
+    for (int i = 0; i < kIterations; ++i) {
+        cv::imencode(".png", frame, png);
+    }
+    int64_t t1 = cv::getTickCount();
+    for (int i = 0; i < kIterations; ++i) {
+        publisher.publish(frame, i, 0.0);
+    }
+    int64_t t2 = cv::getTickCount();
+    const double ms = 1000.0 / cv::getTickFrequency() / kIterations;
+    std::cout << "Annotated output (" << frame.cols << "x" << frame.rows << "): PNG encode " << (t1 - t0) * ms
+              << " ms, frame channel publish " << (t2 - t1) * ms << " ms" << std::endl;
+}
+
+// AR drawing on a 4K frame: drawing straight into the frame as the tools used
+// to, against recording into the overlay and blending its dirty tiles
+void benchOverlay(const cv::Size& pattern_size, const std::vector<cv::Vec3f>& point_set) {
+    cv::Mat frame(2160, 3840, CV_8UC3, cv::Scalar(90, 90, 90));
+    calib::Intrinsics intrinsics;
+    intrinsics.camera_matrix = (cv::Mat_<double>(3, 3) << 2800, 0, 1920, 0, 2800, 1080, 0, 0, 1);
+    intrinsics.dist_coeffs = cv::Mat::zeros(5, 1, CV_64F);
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.2, -0.3, 0.1);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4.0, -3.0, 25.0);
+    std::vector<cv::Point2f> corners;
+    calib::projectPoints(point_set, rvec, tvec, intrinsics, corners);
+
+    int64_t t0 = cv::getTickCount();
+    for (int i = 0; i < kIterations; ++i) {
+        cv::drawChessboardCorners(frame, pattern_size, corners, true);
+        calib::drawAxes(frame, intrinsics, rvec, tvec, 3.0f);
+        calib::drawProjectedCorners(frame, point_set, intrinsics, rvec, tvec, cv::Scalar(255, 0, 255));
+    }
+    int64_t t1 = cv::getTickCount();
+    calib::Overlay overlay;
+    for (int i = 0; i < kIterations; ++i) {
+        overlay.begin();
+        overlay.chessboardCorners(pattern_size, corners, true);
+        overlay.axes(intrinsics, rvec, tvec, 3.0f);
+        overlay.projectedCorners(point_set, intrinsics, rvec, tvec, cv::Scalar(255, 0, 255));
+        // Alternate the pose slightly so every frame is redrawn
+        rvec.at<double>(0) += i % 2 ? 1e-3 : -1e-3;
+        overlay.composite(frame);
+    }
+    int64_t t2 = cv::getTickCount();
+    int dirty_area = 0;
+    for (const cv::Rect& rect : overlay.dirtyRects()) dirty_area += rect.area();
+    const double ms = 1000.0 / cv::getTickFrequency() / kIterations;
+    std::cout << "AR overlay (3840x2160): direct drawing " << (t1 - t0) * ms << " ms, overlay composite "
+              << (t2 - t1) * ms << " ms over " << 100.0 * dirty_area / frame.total() << "% of the frame"
+              << std::endl;
+}
+
+// Subpixel refinement of every detected board: cv::cornerSubPix against the
+// batched refiner, started cold and warm from the previous run's offsets
+void benchSubpix(const std::vector<std::string>& images, const calib::Config& cfg) {
+    std::vector<cv::Mat> grays;
+    std::vector<std::vector<cv::Point2f>> boards;
+    for (const std::string& image_path : images) {
+        cv::Mat gray;
+        calib::toGray(cv::imread(image_path), gray);
+        std::vector<cv::Point2f> corners;
+        if (gray.empty() || !calib::findBoard(gray, cfg, corners)) continue;
+        grays.push_back(gray);
+        boards.push_back(corners);
+    }
+    if (boards.empty()) return;
+
+    calib::SubpixOptions cold_options = calib::subpixOptions(cfg);
+    cold_options.warm_start = false;
+    std::vector<calib::SubpixRefiner> cold(boards.size(), calib::SubpixRefiner(cold_options));
+    std::vector<calib::SubpixRefiner> warm(boards.size(), calib::SubpixRefiner(calib::subpixOptions(cfg)));
+    int64_t ticks[3] = {0, 0, 0};
+    int iterations[2] = {0, 0};
+    for (int i = 0; i < kIterations; ++i) {
+        for (size_t b = 0; b < boards.size(); ++b) {
+            std::vector<cv::Point2f> corners = boards[b];
+            int64_t t0 = cv::getTickCount();
+            cv::cornerSubPix(grays[b], corners, cfg.subpixWinSize(), cv::Size(-1, -1), cfg.subpixCriteria());
+            int64_t t1 = cv::getTickCount();
+            corners = boards[b];
+            cold[b].refine(grays[b], corners);
+            int64_t t2 = cv::getTickCount();
+            corners = boards[b];
+            warm[b].refine(grays[b], corners);
+            int64_t t3 = cv::getTickCount();
+            ticks[0] += t1 - t0;
+            ticks[1] += t2 - t1;
+            ticks[2] += t3 - t2;
+            iterations[0] += cold[b].lastIterations();
+            iterations[1] += warm[b].lastIterations();
+        }
+    }
+    const double runs = static_cast<double>(kIterations * boards.size());
+    const double ms = 1000.0 / cv::getTickFrequency() / runs;
+    std::cout << "Subpixel refinement (" << boards[0].size() << " corners): cornerSubPix " << ticks[0] * ms
+              << " ms, batched " << ticks[1] * ms << " ms (" << iterations[0] / runs << " iterations), warm "
+              << ticks[2] * ms << " ms (" << iterations[1] / runs << " iterations)" << std::endl;
+}
+
+// Projection of a large point set with each distortion model, against
+// cv::projectPoints with the same coefficients
+void benchProjection(const std::vector<cv::Vec3f>& point_set) {
+    std::vector<cv::Vec3f> points;
+    for (int i = 0; i < 1000; ++i) points.insert(points.end(), point_set.begin(), point_set.end());
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.2, -0.3, 0.1);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4.0, 2.0, 20.0);
+    const cv::Mat coefficients = (cv::Mat_<double>(8, 1) << -0.12, 0.05, 5e-4, -5e-4, 0.01, 0.02, -0.01, 5e-3);
+    std::vector<cv::Point2f> projected;
+    std::cout << "projectPoints (" << points.size() << " points):";
+    for (calib::DistortionModel model : {calib::DistortionModel::None, calib::DistortionModel::Radial2,
+                                         calib::DistortionModel::RadTan5, calib::DistortionModel::Rational8,
+                                         calib::DistortionModel::Fisheye}) {
+        calib::Intrinsics intrinsics = calib::initialIntrinsics(cv::Size(1920, 1080), model);
+        intrinsics.camera_matrix.at<double>(0, 0) = intrinsics.camera_matrix.at<double>(1, 1) = 1400;
+        const int n = calib::distortionCoefficients(model);
+        if (n > 0) intrinsics.dist_coeffs = coefficients.rowRange(0, n).clone();
+
+        int64_t t0 = cv::getTickCount();
+        for (int i = 0; i < kIterations; ++i) calib::projectPoints(points, rvec, tvec, intrinsics, projected);
+        int64_t t1 = cv::getTickCount();
+        std::cout << " " << calib::distortionModelName(model) << " "
+                  << (t1 - t0) * 1000.0 / cv::getTickFrequency() / kIterations << " ms";
+        if (model == calib::DistortionModel::Rational8) {
+            t0 = cv::getTickCount();
+            for (int i = 0; i < kIterations; ++i) {
+                cv::projectPoints(points, rvec, tvec, intrinsics.camera_matrix, intrinsics.dist_coeffs, projected);
+            }
+            t1 = cv::getTickCount();
+            std::cout << " (cv::projectPoints " << (t1 - t0) * 1000.0 / cv::getTickFrequency() / kIterations
+                      << " ms)";
+        }
+    }
+    std::cout << std::endl;
+}
+
+// One tracked frame of task4: solve the pose, measure its error and project
+// the axes, through cv::Mat poses and through the fixed-size types
+void benchPosePath(const std::vector<cv::Vec3f>& point_set) {
+    calib::Intrinsics intrinsics = calib::initialIntrinsics(cv::Size(1280, 720));
+    intrinsics.camera_matrix.at<double>(0, 0) = intrinsics.camera_matrix.at<double>(1, 1) = 1000;
+    intrinsics.dist_coeffs.at<double>(0) = -0.1;
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.2, -0.3, 0.1);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4.0, 2.0, 20.0);
+    std::vector<cv::Point2f> corners;
+    calib::projectPoints(point_set, rvec, tvec, intrinsics, corners);
+    const int frames = 100 * kIterations;
+
+    double error = 0.0;
+    int64_t t0 = cv::getTickCount();
+    for (int i = 0; i < frames; ++i) {
+        cv::Mat r, t;
+        calib::solvePose(point_set, corners, intrinsics, r, t);
+        error += calib::reprojectionError(point_set, corners, intrinsics, r, t);
+        std::vector<cv::Point3f> axes_points = {{0, 0, 0}, {3, 0, 0}, {0, 3, 0}, {0, 0, -3}};
+        std::vector<cv::Point2f> axes;
+        calib::projectPoints(axes_points, r, t, intrinsics, axes);
+    }
+    int64_t t1 = cv::getTickCount();
+
+    const calib::Camera camera = calib::toCamera(intrinsics);
+    for (int i = 0; i < frames; ++i) {
+        calib::Pose pose;
+        calib::solvePose(point_set, corners, camera, pose);
+        error += calib::reprojectionError(point_set, corners, camera, pose);
+        const std::array<cv::Point3f, 4> axes_points = {cv::Point3f(0, 0, 0), cv::Point3f(3, 0, 0),
+                                                        cv::Point3f(0, 3, 0), cv::Point3f(0, 0, -3)};
+        std::array<cv::Point2f, 4> axes;
+        calib::projectPoints(axes_points, pose, camera, axes.data());
+    }
+    int64_t t2 = cv::getTickCount();
+
+    const double ms = 1000.0 / cv::getTickFrequency() / frames;
+    std::cout << "Pose path per frame: Mat " << (t1 - t0) * ms << " ms, fixed-size " << (t2 - t1) * ms
+              << " ms (error " << error / (2 * frames) << " px)" << std::endl;
+}
+
+// Latency and accuracy of each PnP solver: against ground truth on noisy
+// synthetic views, and by reprojection error on the boards in image_dir
+void benchPoseSolvers(const std::vector<std::string>& images, const calib::Config& cfg,
+                      const std::vector<cv::Vec3f>& point_set) {
+    struct Variant {
+        const char* name;
+        calib::PoseOptions options;
+    };
+    std::vector<Variant> variants;
+    for (calib::PoseSolver solver : {calib::PoseSolver::Iterative, calib::PoseSolver::Ippe, calib::PoseSolver::Sqpnp}) {
+        calib::PoseOptions options;
+        options.solver = solver;
+        variants.push_back({calib::poseSolverName(solver), options});
+    }
+    variants.push_back({"ippe+refine", variants[1].options});
+    variants.back().options.refine = true;
+
+    // Synthetic views with 0.3 px corner noise
+    calib::Intrinsics synthetic = calib::initialIntrinsics(cv::Size(1280, 720));
+    synthetic.camera_matrix.at<double>(0, 0) = synthetic.camera_matrix.at<double>(1, 1) = 1000;
+    synthetic.dist_coeffs.at<double>(0) = -0.1;
+    const calib::Camera synthetic_camera = calib::toCamera(synthetic);
+    cv::RNG rng(1);
+    std::vector<calib::Pose> truths;
+    std::vector<std::vector<cv::Point2f>> views;
+    for (int i = 0; i < 500; ++i) {
+        calib::Pose truth;
+        truth.rvec = cv::Vec3d(rng.gaussian(0.4), rng.gaussian(0.4), rng.gaussian(0.4));
+        truth.tvec = cv::Vec3d(rng.uniform(-6.0, 2.0), rng.uniform(-2.0, 6.0), rng.uniform(15.0, 60.0));
+        std::vector<cv::Point2f> corners;
+        calib::projectPoints(point_set, truth, synthetic_camera, corners);
+        for (auto& c : corners) {
+            c.x += static_cast<float>(rng.gaussian(0.3));
+            c.y += static_cast<float>(rng.gaussian(0.3));
+        }
+        truths.push_back(truth);
+        views.push_back(corners);
+    }
+
+    // Replayed boards, with the saved calibration if there is one
+    calib::Intrinsics intrinsics;
+    std::vector<std::vector<cv::Point2f>> detections;
+    for (const std::string& image_path : images) {
+        cv::Mat gray;
+        calib::toGray(cv::imread(image_path), gray);
+        std::vector<cv::Point2f> corners;
+        if (gray.empty() || !calib::detectBoard(gray, cfg, corners)) continue;
+        detections.push_back(corners);
+        if (intrinsics.camera_matrix.empty()) {
+            intrinsics = calib::initialIntrinsics(gray.size());
+            intrinsics.camera_matrix.at<double>(0, 0) = intrinsics.camera_matrix.at<double>(1, 1) =
+                std::max(gray.cols, gray.rows);
+        }
+    }
+    calib::Intrinsics saved;
+    if (calib::loadCalibration(cfg.calibration_file, saved)) intrinsics = saved;
+    const calib::Camera camera = calib::toCamera(intrinsics);
+
+    std::cout << "Pose solvers (" << views.size() << " synthetic views, " << detections.size()
+              << " replayed boards):" << std::endl;
+    for (const Variant& variant : variants) {
+        std::vector<double> rotation_errors, translation_errors;
+        int64_t t0 = cv::getTickCount();
+        for (size_t i = 0; i < views.size(); ++i) {
+            calib::Pose pose;
+            calib::solvePose(point_set, views[i], synthetic_camera, pose, variant.options);
+            const cv::Matx33d R = pose.rotation().t() * truths[i].rotation();
+            rotation_errors.push_back(std::acos(std::min(1.0, (cv::trace(R) - 1.0) / 2.0)) * 180.0 / CV_PI);
+            translation_errors.push_back(cv::norm(pose.tvec - truths[i].tvec));
+        }
+        int64_t t1 = cv::getTickCount();
+        double replay_error = 0.0;
+        for (const auto& corners : detections) {
+            calib::Pose pose;
+            calib::solvePose(point_set, corners, camera, pose, variant.options);
+            replay_error += calib::reprojectionError(point_set, corners, camera, pose);
+        }
+        int64_t t2 = cv::getTickCount();
+
+        const size_t flips =
+            std::count_if(rotation_errors.begin(), rotation_errors.end(), [](double e) { return e > 5.0; });
+        std::nth_element(rotation_errors.begin(), rotation_errors.begin() + rotation_errors.size() / 2,
+                         rotation_errors.end());
+        std::nth_element(translation_errors.begin(), translation_errors.begin() + translation_errors.size() / 2,
+                         translation_errors.end());
+        const double us = 1e6 / cv::getTickFrequency();
+        std::cout << "  " << std::left << std::setw(12) << variant.name << std::right << std::fixed
+                  << std::setprecision(1) << (t1 - t0) * us / views.size() << " us/pose, median error "
+                  << std::setprecision(3) << rotation_errors[rotation_errors.size() / 2] << " deg "
+                  << translation_errors[translation_errors.size() / 2] << " units, " << flips << " flipped";
+        if (!detections.empty()) {
+            std::cout << "; replayed " << std::setprecision(1) << (t2 - t1) * us / detections.size()
+                      << " us/pose, " << std::setprecision(3) << replay_error / detections.size() << " px RMS";
+        }
+        std::cout << std::endl;
+    }
+}
+
+// Several boards in a synthetic 1080p scene: one detector for all of them,
+// mostly tracking, against one full detectBoard per board and frame as
+// separate processes would run
+void benchMultiBoard(const calib::Config& cfg) {
+    const std::vector<std::pair<cv::Size, int>> layout = {{{9, 6}, 40}, {{7, 5}, 36}, {{9, 6}, 30}, {{5, 4}, 44}};
+    const std::vector<cv::Point> origins = {{100, 100}, {1100, 500}, {150, 600}, {1200, 60}};
+    cv::Mat scene(1080, 1920, CV_8U, cv::Scalar(200));
+    std::string boards;
+    for (size_t b = 0; b < layout.size(); ++b) {
+        const cv::Size inner = layout[b].first;
+        const int square = layout[b].second;
+        cv::Mat board = scene(cv::Rect(origins[b], cv::Size((inner.width + 3) * square, (inner.height + 3) * square)));
+        board.setTo(255);
+        for (int r = 0; r <= inner.height; ++r) {
+            for (int c = 0; c <= inner.width; ++c) {
+                if ((r + c) % 2 == 0) board(cv::Rect((c + 1) * square, (r + 1) * square, square, square)).setTo(0);
+            }
+        }
+    }
+    cv::GaussianBlur(scene, scene, cv::Size(3, 3), 0.8);
+
+    const double ms = 1000.0 / cv::getTickFrequency() / kIterations;
+    std::cout << "Multi-board detection (1920x1080):";
+    for (size_t count = 1; count <= layout.size(); ++count) {
+        calib::Config multi_cfg = cfg;
+        multi_cfg.boards.clear();
+        for (size_t b = 0; b < count; ++b) {
+            multi_cfg.boards += (b ? "," : "") + std::to_string(layout[b].first.width) + "x" +
+                                std::to_string(layout[b].first.height);
+        }
+        calib::MultiBoardDetector detector(multi_cfg);
+        std::vector<calib::BoardDetection> detections;
+        detector.detect(scene, detections);
+        int64_t t0 = cv::getTickCount();
+        for (int i = 0; i < kIterations; ++i) detector.detect(scene, detections);
+        int64_t t1 = cv::getTickCount();
+        for (int i = 0; i < kIterations; ++i) {
+            for (size_t b = 0; b < count; ++b) {
+                calib::Config single_cfg = cfg;
+                single_cfg.board_width = layout[b].first.width;
+                single_cfg.board_height = layout[b].first.height;
+                std::vector<cv::Point2f> corners;
+                calib::detectBoard(scene, single_cfg, corners);
+            }
+        }
+        int64_t t2 = cv::getTickCount();
+        std::cout << (count > 1 ? "," : "") << " " << count << " boards " << (t1 - t0) * ms << " ms ("
+                  << detections.size() << " found, separate " << (t2 - t1) * ms << " ms)";
+    }
+    std::cout << std::endl;
+}
+
+// The tracking loop's detection under the quality controller: first fixed at
+// the configured settings, then adaptive with half of that latency as budget
+void benchQuality(const std::vector<std::string>& images, const calib::Config& cfg) {
+    std::vector<cv::Mat> grays;
+    for (const std::string& image_path : images) {
+        cv::Mat gray;
+        calib::toGray(cv::imread(image_path), gray);
+        if (!gray.empty()) grays.push_back(gray);
+    }
+    if (grays.empty()) return;
+
+    calib::Config run_cfg = cfg;
+    run_cfg.quality_adaptive = false;
+    for (int run = 0; run < 2; ++run) {
+        calib::QualityController quality(run_cfg);
+        calib::BoardGate gate(run_cfg);
+        std::vector<cv::Point2f> corners;
+        for (int i = 0; i < 10 * kIterations; ++i) {
+            // Each image is held for several frames, as a board in front of a camera
+            quality.beginFrame();
+            quality.detect(grays[(i / 10) % grays.size()], corners, gate);
+            quality.endFrame();
+        }
+        calib::printQualityMetrics(std::cout, quality.options(), quality.metrics());
+        run_cfg.quality_adaptive = true;
+        run_cfg.quality_budget_ms = std::max(0.5 * quality.metrics().latency_ms, 0.01);
+        run_cfg.quality_hold_frames = 10;
+    }
+}
+
+// A directory of kCachedImages files (hard links to the input images) run
+// through the detection cache: first with an empty cache, where every file is
+// hashed and each distinct image detected once, then again from the cache
+// file, where every file is recognized by its size and time
+void benchDetectionCache(const std::vector<std::string>& images, const calib::Config& cfg) {
+    namespace fs = std::filesystem;
+    const std::string dir = "bench_detection_cache";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::vector<std::string> paths;
+    for (int i = 0; i < kCachedImages; ++i) {
+        const std::string& source = images[i % images.size()];
+        const std::string path = dir + "/" + std::to_string(i) + fs::path(source).extension().string();
+        std::error_code ec;
+        fs::create_hard_link(source, path, ec);
+        if (ec && !fs::copy_file(source, path, ec)) {
+            std::cerr << "Error: Could not create " << path << ": " << ec.message() << std::endl;
+            fs::remove_all(dir);
+            return;
+        }
+        paths.push_back(path);
+    }
+
+    double seconds[2] = {0, 0};
+    calib::CacheStats stats[2];
+    for (int run = 0; run < 2; ++run) {
+        int64_t t0 = cv::getTickCount();
+        calib::DetectionCache cache;
+        if (!cache.open(dir + "/cache", cfg)) break;
+        calib::Detection detection;
+        for (const std::string& path : paths) cache.detect(path, cfg, detection);
+        cache.flush();
+        seconds[run] = (cv::getTickCount() - t0) / cv::getTickFrequency();
+        stats[run] = cache.stats();
+    }
+    std::cout << "Detection cache (" << kCachedImages << " files): empty " << seconds[0] << " s ("
+              << stats[0].misses << " detected, " << stats[0].hashed << " hashed), cached " << seconds[1] << " s ("
+              << stats[1].hits << " hits)" << std::endl;
+    fs::remove_all(dir);
+}
+
+// A sphere of about 5000 triangles over a 1280x720 frame: every triangle edge
+// drawn as an overlay line, against the rasterizer filling it with flat and
+// Gouraud shading
+void benchRaster() {
+    const cv::Mat background(720, 1280, CV_8UC3, cv::Scalar(90, 90, 90));
+    cv::Mat frame;
+    calib::Camera camera;
+    camera.K = cv::Matx33d(1000, 0, 640, 0, 1000, 360, 0, 0, 1);
+    calib::Pose pose{cv::Vec3d(0.2, -0.3, 0.1), cv::Vec3d(0, 0, 8)};
+    const calib::Mesh sphere = calib::sphereMesh(cv::Vec3f(0, 0, 0), 3.0f, 50, 50, cv::Scalar(255, 255, 0));
+
+    calib::Overlay overlay;
+    std::vector<cv::Point2f> projected;
+    int64_t t0 = cv::getTickCount();
+    for (int i = 0; i < kIterations; ++i) {
+        background.copyTo(frame);
+        overlay.begin();
+        calib::projectPoints(sphere.vertices, pose, camera, projected);
+        for (const cv::Vec3i& t : sphere.triangles) {
+            for (int k = 0; k < 3; ++k) {
+                overlay.line(calib::OverlayLayer::Objects, projected[t[k]], projected[t[(k + 1) % 3]],
+                             cv::Scalar(255, 255, 0), 1);
+            }
+        }
+        overlay.composite(frame);
+        pose.rvec[0] += i % 2 ? 1e-3 : -1e-3;
+    }
+    int64_t t1 = cv::getTickCount();
+    double filled_ms[2];
+    int64_t tiles = 0;
+    for (calib::Shading shading : {calib::Shading::Flat, calib::Shading::Gouraud}) {
+        calib::RasterOptions options;
+        options.shading = shading;
+        calib::Rasterizer rasterizer(options);
+        const int64_t start = cv::getTickCount();
+        for (int i = 0; i < kIterations; ++i) {
+            background.copyTo(frame);
+            rasterizer.begin(frame.size());
+            rasterizer.draw(sphere, camera, pose);
+            rasterizer.render(frame);
+            pose.rvec[0] += i % 2 ? 1e-3 : -1e-3;
+        }
+        filled_ms[shading == calib::Shading::Gouraud] =
+            (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / kIterations;
+        tiles = rasterizer.stats().tiles;
+    }
+    const double ms = 1000.0 / cv::getTickFrequency() / kIterations;
+    std::cout << "Rendering " << sphere.triangles.size() << " triangles (1280x720): wireframe overlay "
+              << (t1 - t0) * ms << " ms, filled flat " << filled_ms[0] << " ms, gouraud " << filled_ms[1]
+              << " ms over " << tiles << " tiles" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
+
+    std::vector<std::string> images = calib::listImages(cfg.image_dir);
+    if (images.empty()) {
+        std::cerr << "Error: No images found in " << cfg.image_dir << std::endl;
+        return -1;
+    }
+
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    std::vector<cv::Point3f> axes_points = { {0, 0, 0}, {3, 0, 0}, {0, 3, 0}, {0, 0, -3} };
+    StageTimes times;
+    calib::Config gate_cfg = cfg;
+    gate_cfg.gate_force_every = 0;
+    calib::BoardGate gate(gate_cfg);
+
+    for (int iteration = 0; iteration < kIterations; ++iteration) {
+        for (const std::string& image_path : images) {
+            int64_t t0 = cv::getTickCount();
+            cv::Mat frame = cv::imread(image_path);
+            int64_t t1 = cv::getTickCount();
+            times.add("imread", t1 - t0);
+            if (frame.empty()) continue;
+
+            cv::Mat gray;
+            calib::toGray(frame, gray);
+            int64_t t2 = cv::getTickCount();
+            times.add("toGray", t2 - t1);
+
+            // The gate check alone: with no report() it never stays open
+            bool admitted = gate.admit(gray);
+            int64_t t_gate = cv::getTickCount();
+            times.add(admitted ? "boardGate (pass)" : "boardGate (reject)", t_gate - t2);
+
+            std::vector<cv::Point2f> corners;
+            bool found = calib::findBoard(gray, cfg, corners);
+            int64_t t3 = cv::getTickCount();
+            times.add(found ? "findBoard (hit)" : "findBoard (miss)", t3 - t_gate);
+            if (!found) continue;
+
+            calib::refineCorners(gray, cfg, corners);
+            int64_t t4 = cv::getTickCount();
+            times.add("refineCorners", t4 - t3);
+
+            // A plausible pinhole camera for this image size is enough to time the solver
+            calib::Intrinsics intrinsics = calib::initialIntrinsics(gray.size());
+            intrinsics.camera_matrix.at<double>(0, 0) = intrinsics.camera_matrix.at<double>(1, 1) =
+                std::max(gray.cols, gray.rows);
+            cv::Mat rvec, tvec;
+            int64_t t5 = cv::getTickCount();
+            calib::solvePose(point_set, corners, intrinsics, rvec, tvec);
+            int64_t t6 = cv::getTickCount();
+            times.add("solvePose", t6 - t5);
+
+            std::vector<cv::Point2f> image_points;
+            calib::projectPoints(axes_points, rvec, tvec, intrinsics, image_points);
+            int64_t t7 = cv::getTickCount();
+            times.add("projectPoints", t7 - t6);
+        }
+    }
+
+    std::cout << "Pipeline benchmark: " << images.size() << " images x " << kIterations << " iterations, "
+              << cv::getNumThreads() << " OpenCV threads" << std::endl;
+    std::cout << std::left << std::setw(20) << "stage" << std::right << std::setw(10) << "calls"
+              << std::setw(14) << "mean ms" << std::endl;
+    for (const auto& stage : times.order) {
+        std::cout << std::left << std::setw(20) << stage << std::right << std::setw(10) << times.count[stage]
+                  << std::setw(14) << std::fixed << std::setprecision(3)
+                  << times.total_ms[stage] / times.count[stage] << std::endl;
+    }
+
+    benchSubpix(images, cfg);
+    benchProjection(point_set);
+    benchPosePath(point_set);
+    benchPoseSolvers(images, cfg, point_set);
+    benchFrameOutput(cv::imread(images.front()));
+    benchOverlay(cfg.boardSize(), point_set);
+    benchRefinement(point_set);
+    benchDetectionCache(images, cfg);
+    benchQuality(images, cfg);
+    benchMultiBoard(cfg);
+    benchRaster();
+    return 0;
+}
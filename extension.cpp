@@ -2,16 +2,19 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
-#include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "calib/calib.hpp"
 
 // Global variables for OpenGL
+calib::Config cfg;
 cv::Mat frame;
 cv::VideoCapture cap;
-cv::Mat camera_matrix, dist_coeffs;
-cv::Mat rvec, tvec;
+calib::Camera camera;
+calib::Pose pose;
+std::vector<cv::Vec3f> point_set;  // built once in main
+std::vector<cv::Point2f> image_points;
 std::vector<cv::Point3f> cube_points = {
     {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, // Base
     {0, 0, -1}, {1, 0, -1}, {1, 1, -1}, {0, 1, -1} // Top
@@ -134,29 +137,24 @@ void display() {
     }
 
     cv::Mat gray;
-    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    calib::toGray(frame, gray);
 
     // Detect checkerboard corners
     std::vector<cv::Point2f> corners;
-    cv::Size CHECKERBOARD(9, 6);
-    bool ret = cv::findChessboardCorners(gray, CHECKERBOARD, corners);
+    cv::Size CHECKERBOARD = cfg.boardSize();
+    bool ret = calib::detectBoard(gray, cfg, corners);
 
     if (ret) {
-        cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001));
         cv::drawChessboardCorners(frame, CHECKERBOARD, corners, ret);
 
         // Solve for pose
-        std::vector<cv::Point3f> point_set;
-        for (int i = 0; i < CHECKERBOARD.height; i++) {
-            for (int j = 0; j < CHECKERBOARD.width; j++) {
-                point_set.push_back(cv::Vec3f(j, -i, 0));
-            }
-        }
-        cv::solvePnP(point_set, corners, camera_matrix, dist_coeffs, rvec, tvec);
+        ret = calib::solvePose(point_set, corners, camera, pose);
+        if (!ret) std::cerr << "Error: Could not solve the board pose" << std::endl;
+    }
 
+    if (ret) {
         // Project cube points
-        std::vector<cv::Point2f> image_points;
-        cv::projectPoints(cube_points, rvec, tvec, camera_matrix, dist_coeffs, image_points);
+        calib::projectPoints(cube_points, pose, camera, image_points);
 
         // Draw cube
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -184,38 +182,25 @@ void display() {
 }
 
 int main(int argc, char** argv) {
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
+
     std::cout << "Reading calibration parameters..." << std::endl;
 
     // Read the camera calibration parameters from a file
-    std::ifstream file("calibration_parameters.txt");
-    if (file.is_open()) {
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.find("Camera matrix:") != std::string::npos) {
-                camera_matrix = cv::Mat::eye(3, 3, CV_64F);
-                for (int i = 0; i < 3; ++i) {
-                    for (int j = 0; j < 3; ++j) {
-                        file >> camera_matrix.at<double>(i, j);
-                    }
-                }
-            } else if (line.find("Distortion coefficients:") != std::string::npos) {
-                dist_coeffs = cv::Mat::zeros(8, 1, CV_64F);
-                for (int i = 0; i < 8; ++i) {
-                    file >> dist_coeffs.at<double>(i);
-                }
-            }
-        }
-        file.close();
-    } else {
-        std::cerr << "Error: Could not open calibration_parameters.txt" << std::endl;
+    calib::Intrinsics intrinsics;
+    if (!calib::loadCalibration(cfg.calibration_file, intrinsics)) {
         return -1;
     }
+    camera = calib::toCamera(intrinsics);
+    point_set = calib::boardPoints(cfg);
 
     std::cout << "Calibration parameters read successfully." << std::endl;
 
     // Start video capture
     std::cout << "Starting video capture..." << std::endl;
-    cap.open(0); // Use the default camera (index 0)
+    cap.open(cfg.camera_index);
     if (!cap.isOpened()) {
         std::cerr << "Error: Could not open video capture" << std::endl;
         return -1;
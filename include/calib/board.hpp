@@ -0,0 +1,21 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "calib/config.hpp"
+
+namespace calib {
+
+// 3D world points of the board corners, row by row, scaled by the square size
+std::vector<cv::Vec3f> boardPoints(const Config& cfg);
+std::vector<cv::Vec3f> boardPoints(cv::Size board_size, double square_size);
+
+// True if the file name has one of the image extensions the tools accept
+bool isImageFile(const std::string& filename);
+
+// Image files in a directory, sorted by name so runs are repeatable
+std::vector<std::string> listImages(const std::string& directory);
+
+}  // namespace calib
@@ -0,0 +1,26 @@
+#pragma once
+
+// Convenience header pulling in the whole libcalib API
+#include "calib/board.hpp"
+#include "calib/calibration.hpp"
+#include "calib/capture.hpp"
+#include "calib/config.hpp"
+#include "calib/detect.hpp"
+#include "calib/detection_cache.hpp"
+#include "calib/distortion.hpp"
+#include "calib/frame_channel.hpp"
+#include "calib/geometry.hpp"
+#include "calib/ingest.hpp"
+#include "calib/io.hpp"
+#include "calib/multi_board.hpp"
+#include "calib/overlay.hpp"
+#include "calib/pose.hpp"
+#include "calib/pose_channel.hpp"
+#include "calib/projection.hpp"
+#include "calib/quality.hpp"
+#include "calib/raster.hpp"
+#include "calib/refine.hpp"
+#include "calib/report.hpp"
+#include "calib/rig.hpp"
+#include "calib/subpix.hpp"
+#include "calib/trajectory.hpp"
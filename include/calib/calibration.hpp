@@ -0,0 +1,55 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "calib/config.hpp"
+
+namespace calib {
+
+// Minimum number of board views task3 accepts before calibrating
+constexpr size_t kMinCalibrationViews = 5;
+
+// Lens distortion models, by their coefficients:
+//   None       no distortion
+//   Radial2    k1, k2
+//   RadTan5    k1, k2, p1, p2, k3 (OpenCV's default model)
+//   Rational8  k1, k2, p1, p2, k3, k4, k5, k6 (OpenCV's CALIB_RATIONAL_MODEL)
+//   Fisheye    k1, k2, k3, k4 of the equidistant model (cv::fisheye)
+enum class DistortionModel { None, Radial2, RadTan5, Rational8, Fisheye };
+
+// Number of coefficients of a model
+int distortionCoefficients(DistortionModel model);
+
+// Config and file name of a model: none, radial2, radtan5, rational8, fisheye
+const char* distortionModelName(DistortionModel model);
+bool parseDistortionModel(const std::string& name, DistortionModel& model);
+
+// The distortion_model config key
+DistortionModel distortionModel(const Config& cfg);
+
+// Camera intrinsics as used by solvePnP / projectPoints
+struct Intrinsics {
+    cv::Mat camera_matrix;  // 3x3 CV_64F
+    cv::Mat dist_coeffs;    // distortionCoefficients(model) x 1 CV_64F
+    DistortionModel model = DistortionModel::RadTan5;
+};
+
+struct CalibrationResult {
+    Intrinsics intrinsics;
+    double reprojection_error = 0;
+    std::vector<cv::Mat> rvecs, tvecs;  // board pose for each view
+};
+
+// Starting point for calibration: unit focal length, principal point at the
+// image centre and zero distortion coefficients of the model
+Intrinsics initialIntrinsics(cv::Size image_size, DistortionModel model = DistortionModel::RadTan5);
+
+// Calibrate from matched board/image points of several views, estimating
+// only the coefficients of initial.model (cv::fisheye::calibrate for Fisheye)
+CalibrationResult calibrate(const std::vector<std::vector<cv::Vec3f>>& object_points,
+                            const std::vector<std::vector<cv::Point2f>>& image_points,
+                            cv::Size image_size, const Intrinsics& initial);
+
+}  // namespace calib
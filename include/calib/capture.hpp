@@ -0,0 +1,133 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "calib/config.hpp"
+
+namespace calib {
+
+// When the capture assistant accepts a view and when it has enough
+struct CaptureOptions {
+    int grid_columns = 16;         // coverage cells across the image
+    double coverage_target = 0.6;  // done once this fraction of cells has a corner...
+    int min_views = 15;            // ...and at least this many views were accepted
+    int max_views = 40;            // done after this many views regardless
+    double min_novelty = 1.0;      // pose distance to every accepted view (see viewDistance)
+    int min_new_cells = 4;         // or this many coverage cells no view covered yet
+    double min_sharpness = 0.15;   // see edgeSharpness; 0 accepts any
+    double max_motion = 2.0;       // mean corner motion since the previous frame in pixels, 0 off
+};
+
+// Capture options from the capture_* config keys; the grid is report_grid so
+// that capture aims at the coverage the quality report measures
+CaptureOptions captureOptions(const Config& cfg);
+
+// Where the board sits in the image and how it is turned, from its outer
+// corners alone (no intrinsics are needed, so it works before calibration)
+struct ViewSignature {
+    cv::Point2d center;   // board centre as a fraction of the image size
+    double log_scale;     // log of the board size relative to the image diagonal
+    double angle;         // roll of the board rows in degrees, (-90, 90]
+    double tilt_x;        // log ratio of the top and bottom edge lengths
+    double tilt_y;        // log ratio of the left and right edge lengths
+};
+
+ViewSignature viewSignature(const std::vector<cv::Point2f>& corners, cv::Size pattern_size, cv::Size image_size);
+
+// Distance between two views. 1 is roughly a move over a tenth of the image,
+// a 20% change in distance, 15 degrees of roll or a 10% change in the
+// perspective of the board, and they add up.
+double viewDistance(const ViewSignature& a, const ViewSignature& b);
+
+// Sharpness of the edges in a region of an 8-bit image: the 99th percentile
+// of the gradient magnitude over the intensity range. About 0.5 for a sharp
+// edge and 0.4 / sigma for one blurred by a Gaussian of sigma pixels.
+double edgeSharpness(const cv::Mat& gray, const cv::Rect& roi);
+
+// Picks calibration views from a stream of detected boards.
+//
+// A detection is accepted when the board is held still, its edges are sharp
+// and it adds something: a pose unlike every accepted view or corners in
+// coverage cells no view has reached. Accepted corners are kept in memory.
+// The capture is done once the coverage target and the minimum number of
+// views are reached.
+class CaptureAssistant {
+public:
+    enum class Verdict { Accepted, NoBoard, Moving, Redundant, Blurred, Done };
+
+    CaptureAssistant(cv::Size pattern_size, const CaptureOptions& options);
+
+    // Judge the detection of one frame; empty corners mean no board was found
+    Verdict offer(const cv::Mat& gray, const std::vector<cv::Point2f>& corners);
+
+    // Accept a view unconditionally (manual capture)
+    void accept(const std::vector<cv::Point2f>& corners, cv::Size image_size);
+
+    bool done() const;
+
+    const std::vector<std::vector<cv::Point2f>>& views() const { return views_; }
+    // Fraction of coverage cells with at least one accepted corner
+    double coverage() const;
+    // Accepted corners per coverage cell (CV_32S)
+    const cv::Mat& coverageGrid() const { return grid_; }
+
+    // Measurements of the last offer()
+    double lastSharpness() const { return last_sharpness_; }
+    double lastNovelty() const { return last_novelty_; }
+
+private:
+    void resizeGrid(cv::Size image_size);
+    cv::Point cell(cv::Point2f p) const;
+
+    cv::Size pattern_size_;
+    CaptureOptions options_;
+    cv::Size image_size_;
+    cv::Mat grid_;
+    std::vector<std::vector<cv::Point2f>> views_;
+    std::vector<ViewSignature> signatures_;
+    std::vector<cv::Point2f> previous_;
+    double last_sharpness_ = 0.0;
+    double last_novelty_ = 0.0;
+};
+
+const char* verdictName(CaptureAssistant::Verdict verdict);
+
+// Writes images on a background thread so that encoding never stalls the
+// capture loop. write() copies the image and only blocks while max_pending
+// images are already waiting.
+class AsyncImageWriter {
+public:
+    explicit AsyncImageWriter(size_t max_pending = 8);
+    ~AsyncImageWriter();
+    AsyncImageWriter(const AsyncImageWriter&) = delete;
+    AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+    void write(const std::string& path, const cv::Mat& image);
+
+    // Write everything still queued and stop the thread
+    void close();
+
+    int written() const;
+    int failed() const;
+
+private:
+    void run();
+
+    size_t max_pending_;
+    std::deque<std::pair<std::string, cv::Mat>> queue_;
+    bool stop_ = false;
+    int written_ = 0;
+    int failed_ = 0;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread thread_;
+};
+
+}  // namespace calib
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+namespace calib {
+
+// One board of a multi-board setup
+struct BoardSpec {
+    cv::Size size;  // inner corners per row and column
+    double square_size = 1.0;
+};
+
+// Runtime settings shared by every tool. The board, detection and file
+// defaults are the constants that used to be compiled into each program.
+// Later features are on by default, though (the board gate, batched subpixel
+// refinement, IPPE poses, bundle adjustment, the detection cache, trajectory
+// and report files), so results and written files differ from the original
+// programs unless those are turned off.
+struct Config {
+    // Checkerboard geometry
+    int board_width = 9;       // inner corners per row
+    int board_height = 6;      // inner corners per column
+    double square_size = 1.0;  // edge length of one square in mm
+
+    // Boards task4 looks for together (see MultiBoardDetector):
+    // comma separated WxH or WxH:square_size, such as "9x6, 7x5:0.5", with
+    // square_size where it is omitted. Empty tracks the one board above.
+    std::string boards;
+    int boards_search_width = 1280;    // width boards are searched for at, 0 full resolution
+    double boards_track_margin = 0.5;  // region around a tracked board, as a fraction of its size
+
+    // findChessboardCorners flags
+    bool adaptive_thresh = true;
+    bool normalize_image = true;
+    bool fast_check = false;
+
+    // Fast-reject gate in front of findChessboardCorners (see BoardGate)
+    bool gate = true;
+    int gate_width = 320;       // width the frame is downscaled to for the check
+    int gate_force_every = 15;  // run full detection after this many gated frames, 0 never
+
+    // cornerSubPix settings (window is the half size passed to cornerSubPix)
+    int subpix_window = 11;
+    int subpix_max_iter = 30;
+    double subpix_epsilon = 0.001;
+    // Refinement engine (see SubpixRefiner); false uses cv::cornerSubPix
+    bool subpix_batched = true;
+    bool subpix_warm_start = true;      // tracking tools start from the previous frame's offsets
+    int subpix_parallel_corners = 256;  // boards with this many corners refine in parallel, 0 never
+
+    int threads = -1;  // OpenCV worker threads, -1 keeps the OpenCV default
+    int camera_index = 0;
+    std::string image_dir = "images";
+    std::string calibration_file = "calibration_parameters.txt";
+
+    // Detections of image_dir files are cached here by image content and
+    // detection settings (see DetectionCache); empty disables the cache
+    std::string detection_cache = ".calib_cache";
+    bool detection_cache_gray = false;  // also keep the decoded gray planes
+
+    // Frame input for the streaming tools (see FrameSource): empty for the
+    // camera, otherwise a video file, an image directory or a numbered
+    // pattern such as frames/%06d.png
+    std::string input;
+    int start_frame = 0;
+    int end_frame = -1;       // exclusive, -1 reads to the end
+    int frame_step = 1;       // use every Nth frame
+    int prefetch = 8;         // frames decoded ahead of the consumer
+    int decode_threads = 2;   // parallel decoders for image sequences
+    double input_fps = 30.0;  // frame rate assumed when the source has none
+    bool hw_decode = true;    // ask the video backend for hardware decoding
+    bool display = true;      // show frames in a window
+
+    // Lens model task3 calibrates: none, radial2, radtan5, rational8 or
+    // fisheye (see DistortionModel). It is saved with the calibration.
+    std::string distortion_model = "radtan5";
+
+    // Bundle-adjustment refinement after calibrateCamera (see
+    // refineCalibration); refine_loss is none, huber or cauchy
+    bool refine = true;
+    int refine_max_iter = 50;
+    std::string refine_loss = "huber";
+    double refine_loss_scale = 1.0;     // pixels
+    double refine_reject_factor = 3.0;  // x median view error, 0 keeps every view
+
+    // Quality report written by task3 and calibration_report: <report_file>.html
+    // and <report_file>.json; empty disables it. Gates of 0 are not checked;
+    // with report_enforce a failed gate makes the tool exit with status 2.
+    std::string report_file = "calibration_report";
+    int report_grid = 16;               // coverage cells across the image
+    double report_max_rms = 1.0;        // pixels
+    double report_max_view_rms = 2.0;   // pixels
+    double report_min_coverage = 0.5;   // fraction of cells with corners
+    bool report_enforce = false;
+
+    // Automatic capture in task2 (see CaptureAssistant): views are accepted
+    // while the board is still, sharp and novel until capture_coverage of the
+    // report_grid cells hold a corner and capture_min_views were taken.
+    // Images are saved to capture_dir.
+    bool capture_auto = true;
+    std::string capture_dir = "captures";
+    double capture_coverage = 0.6;
+    int capture_min_views = 15;
+    int capture_max_views = 40;
+    double capture_min_novelty = 1.0;     // pose distance to every accepted view
+    int capture_min_new_cells = 4;        // or this many uncovered cells reached
+    double capture_min_sharpness = 0.15;  // edge sharpness, 0 accepts blurred views
+    double capture_max_motion = 2.0;      // mean corner motion between frames in pixels, 0 off
+
+    // Rig calibration in task3: comma separated image directories, one per
+    // camera, with matching file names for synchronized frames. Empty
+    // calibrates the single camera in image_dir.
+    std::string rig_cameras;
+    std::string rig_file = "rig_calibration.yml";
+    bool rig_rectify = true;  // export rectification maps for neighbouring cameras
+
+    // PnP solver of every pose (see PoseTracker): iterative, ippe or sqpnp.
+    // Mirror-image IPPE poses whose errors are within pose_ambiguity_ratio of
+    // each other are resolved towards the previous frame's pose.
+    std::string pose_solver = "ippe";
+    double pose_ambiguity_ratio = 1.2;
+    bool pose_refine = false;  // polish each pose with solvePnPRefineLM
+
+    // Latency budget of the tracking tools (see QualityController): with
+    // quality_adaptive, detection resolution, subpixel effort, detection
+    // cadence and overlay detail are lowered while frames take longer than
+    // quality_budget_ms and raised again once they stay under
+    // quality_raise_below of it for quality_hold_frames frames
+    bool quality_adaptive = false;
+    double quality_budget_ms = 33.0;
+    double quality_raise_below = 0.7;
+    int quality_hold_frames = 30;
+
+    // Binary pose trajectory written by the tracking tools (see
+    // TrajectoryWriter); empty disables it
+    std::string trajectory_file = "trajectory.ctraj";
+    int trajectory_chunk_rows = 4096;
+    bool trajectory_float32 = false;
+    bool trajectory_delta = true;
+
+    // Shared-memory channel the tracking tools publish every pose to (see
+    // PosePublisher); empty disables it
+    std::string pose_channel;
+    int pose_channel_capacity = 1024;  // poses kept for slow subscribers
+
+    // Overlay primitives the tracking tools draw, a comma separated subset of
+    // corners, axes, projected, objects; keys 1-4 toggle them at run time
+    std::string overlay_layers = "corners,axes,projected,objects";
+    double overlay_opacity = 1.0;  // 0 transparent .. 1 opaque
+
+    // How task6 draws its objects: wireframe lines, or filled and depth
+    // tested with flat or gouraud shading (see Rasterizer)
+    std::string render_mode = "wireframe";
+
+    // Shared-memory ring the tracking tools publish annotated frames to (see
+    // FramePublisher); empty disables it. frame_recorder persists it to
+    // record_output: a printf-style image pattern or a video file.
+    std::string frame_channel;
+    int frame_channel_slots = 8;
+    std::string record_output = "frame_%06d.png";
+
+    cv::Size boardSize() const { return cv::Size(board_width, board_height); }
+
+    cv::Size subpixWinSize() const { return cv::Size(subpix_window, subpix_window); }
+
+    cv::TermCriteria subpixCriteria() const {
+        return cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, subpix_max_iter, subpix_epsilon);
+    }
+
+    int chessboardFlags() const;
+
+    // boards parsed, or the single board_width x board_height board
+    std::vector<BoardSpec> boardSpecs() const;
+
+    // rig_cameras split into directories
+    std::vector<std::string> rigCameraDirs() const;
+
+    // overlay_layers split into names
+    std::vector<std::string> overlayLayers() const;
+};
+
+// Apply one key/value pair to the config. Returns false and prints the reason
+// if the key is unknown or the value does not parse.
+bool applySetting(Config& cfg, const std::string& key, const std::string& value);
+
+// Read "key = value" lines from a config file. Blank lines and lines starting
+// with '#' are ignored.
+bool loadConfigFile(const std::string& path, Config& cfg);
+
+// Build the config for a tool: defaults, then the config file, then command
+// line overrides of the form --key=value or --key value. The file is
+// calib.cfg in the working directory unless --config=<path> is given; a
+// missing default file is not an error.
+bool loadConfig(int argc, char** argv, Config& cfg);
+
+}  // namespace calib
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "calib/config.hpp"
+#include "calib/subpix.hpp"
+
+namespace calib {
+
+// Convert a captured frame to the single-channel image detection works on
+void toGray(const cv::Mat& frame, cv::Mat& gray);
+
+// Locate the inner board corners to pixel accuracy
+bool findBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners);
+
+// Refine corner locations to subpixel accuracy in place, with a
+// SubpixRefiner unless subpix_batched is off
+void refineCorners(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners);
+
+// findBoard followed by refineCorners. Returns false if no board was found.
+bool detectBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners);
+
+struct GateStats {
+    int64_t frames = 0;   // frames offered to the gate
+    int64_t gated = 0;    // skipped without running full detection
+    int64_t forced = 0;   // rejected by the gate but detected anyway (gate_force_every)
+    int64_t missed = 0;   // forced frames that did contain a board
+};
+
+// Cheap pre-classifier in front of findChessboardCorners, which is slowest
+// on frames without a board. The frame is downscaled to gate_width and
+// cv::checkChessboard looks for a plausible quad pattern; only frames that
+// pass get full detection. While the board was found in the previous frame
+// the gate stays open.
+//
+// The gate trades detection latency for CPU: a board it misses is picked
+// up by the next frame that passes, or at the latest by the full detection
+// forced after gate_force_every consecutive gated frames. Lower values bound
+// the false-negative streak more tightly; missed / forced in the stats
+// estimates the gate's false-negative rate. It is meant for frame streams;
+// batch calibration over independent images detects every image in full.
+class BoardGate {
+public:
+    explicit BoardGate(const Config& cfg);
+
+    // True if full detection should run on this frame
+    bool admit(const cv::Mat& gray);
+
+    // Outcome of the full detection of an admitted frame
+    void report(bool found);
+
+    const GateStats& stats() const { return stats_; }
+
+private:
+    bool enabled_;
+    cv::Size board_size_;
+    int width_;
+    int force_every_;
+    int since_forced_ = 0;
+    bool last_found_ = false;
+    bool forced_ = false;
+    cv::Mat small_;
+    GateStats stats_;
+};
+
+// detectBoard behind the gate. Gated frames return false without corners.
+bool detectBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners, BoardGate& gate);
+
+// As above, refining with the tracker's own refiner so that consecutive
+// frames warm start from each other. The refiner is reset when the board is
+// lost.
+bool detectBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners, BoardGate& gate,
+                 SubpixRefiner& refiner);
+
+// One-line summary such as "Board gate: skipped 812 of 900 frames (90.2%), ..."
+void printGateStats(std::ostream& out, const GateStats& stats);
+
+}  // namespace calib
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calib/config.hpp"
+#include "calib/detect.hpp"
+
+namespace calib {
+
+// Board detection in one image file
+struct Detection {
+    cv::Size image_size;
+    std::vector<cv::Point2f> corners;  // refined; empty if no board was found
+
+    bool found() const { return !corners.empty(); }
+};
+
+// 64-bit hash of a byte range, used as the content address of image files
+uint64_t contentHash(const void* data, size_t size);
+
+// Hash of the config keys that change what detectBoard returns (board size,
+// chessboard flags, subpixel settings)
+uint64_t detectionParamsHash(const Config& cfg);
+
+struct CacheStats {
+    int64_t hits = 0;      // detections returned without decoding the image
+    int64_t misses = 0;    // images decoded and detected
+    int64_t hashed = 0;    // files read and hashed because their size or time changed
+};
+
+// Persistent store of board detections, addressed by the content of the
+// image file and the detection parameters.
+//
+// A path index remembers the size, modification time and content hash of
+// every file seen, so an unchanged file is recognized from a stat() alone.
+// A file that changed on disk is read and hashed; if its content is still
+// known (a copy, a touch) its detection is reused, otherwise it is decoded
+// from the bytes already read, detected and stored. With store_gray the
+// decoded gray plane is kept too, for tools that need the pixels again.
+//
+// Everything but the gray planes lives in memory and in one file in the
+// cache directory, written by flush() and the destructor. detect() may be
+// called from several threads, but a BoardGate is not thread-safe: threads
+// that pass a gate must each pass their own.
+class DetectionCache {
+public:
+    DetectionCache() = default;
+    ~DetectionCache();
+    DetectionCache(const DetectionCache&) = delete;
+    DetectionCache& operator=(const DetectionCache&) = delete;
+
+    // Load the cache in directory, creating it if needed. A missing or
+    // unreadable cache file starts an empty cache.
+    bool open(const std::string& directory, const Config& cfg);
+    bool isOpen() const { return !directory_.empty(); }
+
+    // Detection of the image at path. Without an open cache this is imread
+    // and detectBoard. The gate, if given, screens images that have to be
+    // detected; images it rejects are reported as boardless but not stored.
+    // The gate is used unlocked, so it must not be shared between threads.
+    // image receives the decoded frame if requested; on a hit it is read
+    // only for that. Returns false if the file cannot be read or decoded.
+    bool detect(const std::string& path, const Config& cfg, Detection& detection, BoardGate* gate = nullptr,
+                cv::Mat* image = nullptr);
+
+    // The stored gray plane of an image detected with store_gray
+    bool loadGray(const std::string& path, cv::Mat& gray);
+
+    // Write the index and detections; false if the cache file cannot be written
+    bool flush();
+
+    CacheStats stats() const;
+
+private:
+    struct FileEntry {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+    };
+
+    struct Record {
+        cv::Size image_size;
+        std::vector<cv::Point2f> corners;
+    };
+
+    bool load();
+    bool lookupFile(const std::string& path, uint64_t size, int64_t mtime, uint64_t& hash) const;
+    std::string grayPath(uint64_t hash) const;
+
+    std::string directory_;
+    uint64_t params_ = 0;
+    bool store_gray_ = false;
+    bool dirty_ = false;
+    std::unordered_map<std::string, FileEntry> files_;
+    // Detections by content hash, for params_ only; records of other
+    // parameters are kept so that switching back still hits
+    std::unordered_map<uint64_t, std::unordered_map<uint64_t, Record>> records_;
+    CacheStats stats_;
+    mutable std::mutex mutex_;
+};
+
+// One-line summary such as "Detection cache: 1998 hits, 2 misses (2 files rehashed)"
+void printCacheStats(std::ostream& out, const CacheStats& stats);
+
+}  // namespace calib
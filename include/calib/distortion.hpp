@@ -0,0 +1,110 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/geometry.hpp"
+
+namespace calib {
+
+// Lens models on normalized image coordinates (X/Z, Y/Z), one specialization
+// per DistortionModel so that each projection loop is compiled for its model
+// and pays only for the terms it has. k points to the model's coefficients.
+template <DistortionModel M>
+struct Lens;
+
+template <>
+struct Lens<DistortionModel::None> {
+    static constexpr int kCoefficients = 0;
+    static cv::Point2d distort(const double*, cv::Point2d p) { return p; }
+    static cv::Point2d undistort(const double*, cv::Point2d p) { return p; }
+};
+
+template <>
+struct Lens<DistortionModel::Radial2> {
+    static constexpr int kCoefficients = 2;
+    static cv::Point2d distort(const double* k, cv::Point2d p) {
+        const double r2 = p.x * p.x + p.y * p.y;
+        return p * (1 + r2 * (k[0] + r2 * k[1]));
+    }
+    static cv::Point2d undistort(const double* k, cv::Point2d p);
+};
+
+template <>
+struct Lens<DistortionModel::RadTan5> {
+    static constexpr int kCoefficients = 5;
+    static cv::Point2d distort(const double* k, cv::Point2d p) {
+        const double r2 = p.x * p.x + p.y * p.y, xy = p.x * p.y;
+        const double radial = 1 + r2 * (k[0] + r2 * (k[1] + r2 * k[4]));
+        return cv::Point2d(p.x * radial + 2 * k[2] * xy + k[3] * (r2 + 2 * p.x * p.x),
+                           p.y * radial + k[2] * (r2 + 2 * p.y * p.y) + 2 * k[3] * xy);
+    }
+    static cv::Point2d undistort(const double* k, cv::Point2d p);
+};
+
+template <>
+struct Lens<DistortionModel::Rational8> {
+    static constexpr int kCoefficients = 8;
+    static cv::Point2d distort(const double* k, cv::Point2d p) {
+        const double r2 = p.x * p.x + p.y * p.y, xy = p.x * p.y;
+        const double radial =
+            (1 + r2 * (k[0] + r2 * (k[1] + r2 * k[4]))) / (1 + r2 * (k[5] + r2 * (k[6] + r2 * k[7])));
+        return cv::Point2d(p.x * radial + 2 * k[2] * xy + k[3] * (r2 + 2 * p.x * p.x),
+                           p.y * radial + k[2] * (r2 + 2 * p.y * p.y) + 2 * k[3] * xy);
+    }
+    static cv::Point2d undistort(const double* k, cv::Point2d p);
+};
+
+template <>
+struct Lens<DistortionModel::Fisheye> {
+    static constexpr int kCoefficients = 4;
+    static cv::Point2d distort(const double* k, cv::Point2d p) {
+        const double r = std::sqrt(p.x * p.x + p.y * p.y);
+        if (r < 1e-12) return p;
+        const double theta = std::atan(r), t2 = theta * theta;
+        const double theta_d = theta * (1 + t2 * (k[0] + t2 * (k[1] + t2 * (k[2] + t2 * k[3]))));
+        return p * (theta_d / r);
+    }
+    static cv::Point2d undistort(const double* k, cv::Point2d p);
+};
+
+// Call f with a default-constructed Lens<model>, so the caller's loop is
+// instantiated once per model
+template <typename F>
+auto withLens(DistortionModel model, F&& f) {
+    switch (model) {
+        case DistortionModel::None: return f(Lens<DistortionModel::None>());
+        case DistortionModel::Radial2: return f(Lens<DistortionModel::Radial2>());
+        case DistortionModel::Rational8: return f(Lens<DistortionModel::Rational8>());
+        case DistortionModel::Fisheye: return f(Lens<DistortionModel::Fisheye>());
+        default: return f(Lens<DistortionModel::RadTan5>());
+    }
+}
+
+// The intrinsics' coefficients padded with zeros to the largest model
+std::array<double, 8> lensCoefficients(const Intrinsics& intrinsics);
+
+// Coefficients in the form OpenCV's pinhole functions (solvePnP,
+// projectPoints, initUndistortRectifyMap) accept: empty for None, k1, k2, 0, 0
+// for Radial2 and the coefficients themselves for RadTan5 and Rational8.
+// Fisheye coefficients have no pinhole form and give an empty matrix.
+cv::Mat pinholeCoefficients(const Intrinsics& intrinsics);
+// The same as a header over camera.k: no copy, valid while camera lives
+cv::Mat pinholeCoefficients(const Camera& camera);
+
+// Pixel coordinates to normalized, undistorted image coordinates
+void undistortPoints(const std::vector<cv::Point2f>& pixels, const Intrinsics& intrinsics,
+                     std::vector<cv::Point2f>& normalized);
+void undistortPoints(const std::vector<cv::Point2f>& pixels, const Camera& camera,
+                     std::vector<cv::Point2f>& normalized);
+
+// Remap tables that undistort an image of the given size into a pinhole view
+// with camera matrix new_camera_matrix (the intrinsics' own if empty), for
+// cv::remap
+void undistortMaps(const Intrinsics& intrinsics, cv::Size size, const cv::Mat& new_camera_matrix, cv::Mat& map_x,
+                   cv::Mat& map_y);
+
+}  // namespace calib
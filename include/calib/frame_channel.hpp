@@ -0,0 +1,97 @@
+#pragma once
+
+// Annotated frames in a POSIX shared-memory ring, so viewers and recorders
+// in other processes can take the tracker's output without it ever encoding
+// an image. The layout follows the pose channel: a fixed number of slots,
+// each guarded by a sequence lock, written round-robin by one publisher.
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+
+#include "calib/pose_channel.hpp"
+
+namespace calib {
+
+struct FrameRing;
+
+// Writer side. The ring's slot size is fixed at open(); frames larger than
+// that are counted as rejected instead of being published. Publishing never
+// waits for readers.
+class FramePublisher {
+public:
+    FramePublisher() = default;
+    ~FramePublisher();
+    FramePublisher(const FramePublisher&) = delete;
+    FramePublisher& operator=(const FramePublisher&) = delete;
+
+    // Replaces an existing channel of the same name
+    bool open(const std::string& name, uint32_t slots, size_t max_frame_bytes);
+    void close();
+    bool isOpen() const { return ring_ != nullptr; }
+
+    // Copy the image into the next slot
+    bool publish(const cv::Mat& image, int64_t frame, double timestamp);
+
+    // Zero-copy variant: render straight into the next slot, then commit().
+    // The returned Mat is only valid until commit().
+    cv::Mat reserve(cv::Size size, int type);
+    void commit(int64_t frame, double timestamp);
+
+    uint64_t published() const { return next_; }
+    uint64_t rejected() const { return rejected_; }
+
+private:
+    std::string name_;
+    FrameRing* ring_ = nullptr;
+    size_t bytes_ = 0;
+    uint64_t next_ = 0;
+    uint64_t rejected_ = 0;
+    bool reserved_ = false;
+};
+
+// A frame as seen by a reader. image points into the shared ring and is
+// read-only (the mapping is PROT_READ); it stays intact only until the
+// publisher wraps around to its slot, which FrameSubscriber::valid() tells.
+struct SharedFrame {
+    cv::Mat image;
+    uint64_t sequence = 0;
+    int64_t frame = -1;
+    double timestamp = 0.0;
+    double published_at = 0.0;  // monotonicSeconds() at commit
+};
+
+class FrameSubscriber {
+public:
+    FrameSubscriber() = default;
+    ~FrameSubscriber();
+    FrameSubscriber(const FrameSubscriber&) = delete;
+    FrameSubscriber& operator=(const FrameSubscriber&) = delete;
+
+    // Fails if no publisher has created the channel yet
+    bool open(const std::string& name);
+    void close();
+
+    // Newest frame; false if none has been published
+    bool latest(SharedFrame& frame) const;
+
+    // Frames in order, starting with the first one published after open()
+    bool next(SharedFrame& frame);
+    bool wait(SharedFrame& frame, double timeout_seconds);
+
+    // True while the frame's slot has not been reused. Check after using a
+    // zero-copy view, or after copying it out, and discard the result if false.
+    bool valid(const SharedFrame& frame) const;
+
+    uint64_t lost() const { return lost_; }
+
+private:
+    bool acquire(uint64_t sequence, SharedFrame& frame) const;
+
+    const FrameRing* ring_ = nullptr;
+    size_t bytes_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t lost_ = 0;
+};
+
+}  // namespace calib
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "calib/calibration.hpp"
+
+namespace calib {
+
+// Fixed-size geometry for the per-frame path. Pose, Camera and PointSpan live
+// on the stack and hold no reference-counted storage, so solving, projecting
+// and drawing a pose creates no per-frame cv::Mat in our code (OpenCV may
+// still allocate internally). The Mat-based types (Intrinsics,
+// rvec/tvec Mats) remain the interface of calibration and file I/O; the
+// adapters below convert at those edges.
+
+// Board pose relative to the camera
+struct Pose {
+    cv::Vec3d rvec;  // Rodrigues rotation vector
+    cv::Vec3d tvec;
+
+    // Rotation matrix of rvec
+    cv::Matx33d rotation() const;
+};
+
+// A pose from rvec/tvec Mats of any float depth and 3x1, 1x3 or 1x1x3 shape
+Pose toPose(const cv::Mat& rvec, const cv::Mat& tvec);
+
+// Distortion coefficients of any model, zero padded to the largest
+// (Rational8); the order is that of Intrinsics::dist_coeffs
+using Distortion = cv::Vec<double, 8>;
+
+// Intrinsics by value
+struct Camera {
+    cv::Matx33d K = cv::Matx33d::eye();
+    Distortion k;
+    DistortionModel model = DistortionModel::RadTan5;
+};
+
+Camera toCamera(const Intrinsics& intrinsics);
+Intrinsics toIntrinsics(const Camera& camera);
+
+static_assert(sizeof(cv::Point3f) == sizeof(cv::Vec3f), "3D point types must share one layout");
+
+// Read-only view of contiguous 3D points: a vector or array of Vec3f or
+// Point3f. The conversions are implicit so every container
+// can be passed where a PointSpan is expected; the view does not own the
+// points.
+class PointSpan {
+public:
+    PointSpan(const cv::Vec3f* data, size_t size) : data_(data), size_(size) {}
+    PointSpan(const std::vector<cv::Vec3f>& points) : PointSpan(points.data(), points.size()) {}
+    PointSpan(const std::vector<cv::Point3f>& points)
+        : PointSpan(reinterpret_cast<const cv::Vec3f*>(points.data()), points.size()) {}
+    template <size_t N>
+    PointSpan(const std::array<cv::Point3f, N>& points)
+        : PointSpan(reinterpret_cast<const cv::Vec3f*>(points.data()), N) {}
+
+    const cv::Vec3f* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const cv::Vec3f& operator[](size_t i) const { return data_[i]; }
+    PointSpan subspan(size_t first, size_t count) const { return PointSpan(data_ + first, count); }
+
+    // CV_32FC3 header over the points for OpenCV functions; no copy
+    cv::Mat mat() const { return cv::Mat(static_cast<int>(size_), 1, CV_32FC3, const_cast<cv::Vec3f*>(data_)); }
+
+private:
+    const cv::Vec3f* data_;
+    size_t size_;
+};
+
+}  // namespace calib
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "calib/config.hpp"
+
+namespace calib {
+
+struct Frame {
+    cv::Mat image;
+    int64_t index = -1;      // frame number in the source
+    double timestamp = 0.0;  // seconds since the start of the source
+};
+
+// Streams frames from a camera, a video file (MP4, MKV, ... as supported by
+// the OpenCV backend) or an image sequence, decoding ahead of the consumer on
+// background threads.
+//
+// Which source is used follows cfg.input: empty opens camera cfg.camera_index,
+// a directory or a printf-style pattern such as "frames/%06d.png" is read as
+// an image sequence, anything else is opened as a video file. Recorded
+// sources honour start_frame / end_frame / frame_step; frames skipped by the
+// step are grabbed without being retrieved (video) or never read (images).
+//
+// Recorded sources apply back-pressure: the decoder stalls once `prefetch`
+// frames are waiting. A live camera never stalls and only the newest frame is
+// kept, so a slow consumer skips frames instead of building up latency.
+class FrameSource {
+public:
+    FrameSource() = default;
+    ~FrameSource();
+    FrameSource(const FrameSource&) = delete;
+    FrameSource& operator=(const FrameSource&) = delete;
+
+    bool open(const Config& cfg);
+
+    // Next frame in source order. Blocks until it is decoded; returns false
+    // at the end of the input or if the camera stops delivering frames.
+    bool read(Frame& frame);
+
+    void close();
+
+    bool isLive() const { return kind_ == Kind::Camera; }
+    double fps() const { return fps_; }
+    int64_t droppedFrames() const;
+
+private:
+    enum class Kind { Camera, Video, Sequence };
+
+    struct Slot {
+        Frame frame;
+        int64_t seq = -1;  // output sequence number held in this slot, -1 if empty
+    };
+
+    bool openSequence(const Config& cfg);
+    bool openVideo(const Config& cfg);
+    void captureLoop();
+    void sequenceLoop();
+    void store(int64_t seq, Frame frame);
+
+    Kind kind_ = Kind::Camera;
+    cv::VideoCapture cap_;
+    std::vector<std::string> files_;
+    int64_t start_ = 0, end_ = -1, step_ = 1;
+    double fps_ = 30.0;
+
+    std::vector<Slot> slots_;
+    int64_t next_read_ = 0;   // next sequence number handed to read()
+    int64_t next_claim_ = 0;  // next sequence number a sequence worker decodes
+    int64_t total_ = -1;      // number of output frames, known once the producer is done
+    int64_t dropped_ = 0;
+    bool stop_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable produced_, consumed_;
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace calib
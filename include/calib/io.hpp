@@ -0,0 +1,36 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/geometry.hpp"
+
+namespace calib {
+
+// Read calibration_parameters.txt as written by saveCalibration. Matrices may
+// be in OpenCV's bracketed print format or plain whitespace separated values.
+// The distortion model is read from the file; files without one get the
+// model matching their number of coefficients (4 are OpenCV's k1, k2, p1, p2).
+bool loadCalibration(const std::string& path, Intrinsics& intrinsics);
+
+// Write the intrinsics, distortion model and reprojection error
+bool saveCalibration(const std::string& path, const Intrinsics& intrinsics, double reprojection_error);
+
+// Per-view board poses in the rotations_translations.txt format
+bool saveViewPoses(const std::string& path, const std::vector<cv::Mat>& rvecs, const std::vector<cv::Mat>& tvecs);
+
+// One pose in the "Rotation vector: [...]" line format used by the live tools
+void writePose(std::ostream& out, const cv::Mat& rvec, const cv::Mat& tvec);
+void writePose(std::ostream& out, const Pose& pose);
+
+// Read poses back from a text log: the one-line records written by writePose
+// or the per-view blocks of saveViewPoses. frames holds the "Image N:" number
+// where the log has one and the position of the pose otherwise.
+bool loadPoseLog(const std::string& path, std::vector<int64_t>& frames, std::vector<cv::Vec3d>& rvecs,
+                 std::vector<cv::Vec3d>& tvecs);
+
+}  // namespace calib
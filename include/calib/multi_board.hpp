@@ -0,0 +1,101 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "calib/config.hpp"
+#include "calib/geometry.hpp"
+#include "calib/pose.hpp"
+#include "calib/subpix.hpp"
+
+namespace calib {
+
+// One board found in a frame
+struct BoardDetection {
+    int board = -1;  // index into Config::boardSpecs()
+    std::vector<cv::Point2f> corners;
+    bool tracked = false;  // found again in the region of its previous corners
+    Pose pose;
+    bool posed = false;   // set by solvePoses
+    double error = 0.0;   // RMS reprojection error of pose in pixels
+};
+
+struct MultiBoardStats {
+    int64_t frames = 0;
+    int64_t found = 0;     // boards found, over all frames
+    int64_t tracked = 0;   // of those, found in their tracking region
+    int64_t searches = 0;  // whole-frame searches for a board
+    int64_t gated = 0;     // searches skipped because checkChessboard saw no such board
+};
+
+// Finds every board of Config::boardSpecs() in a frame, in one pass over a
+// shared pyramid: the full-resolution gray image the corners are refined on,
+// a search image scaled to boards_search_width that findChessboardCorners
+// runs on, and a probe at gate_width for the cheap checkChessboard test.
+//
+// A board found in the previous frame is looked for only in the region of
+// its previous corners, grown by boards_track_margin of its size. These
+// region searches run in parallel. Every board found is then masked out of
+// the search image. The boards still missing are searched for in the whole
+// image, largest first, so a smaller pattern is never found inside a larger
+// board, and two boards of the same size are never found on one board. A
+// missing board is searched for only when the probe passes checkChessboard
+// for its size, or after gate_force_every frames without a search.
+//
+// Boards of the same size are told apart only by tracking: a board keeps its
+// index while it is tracked, and the index of a board that was lost is
+// assigned again by the next search.
+class MultiBoardDetector {
+public:
+    explicit MultiBoardDetector(const Config& cfg);
+
+    const std::vector<BoardSpec>& boards() const { return specs_; }
+    // 3D corner points of a board, scaled by its square size
+    const std::vector<cv::Vec3f>& points(int board) const { return targets_[board].points; }
+
+    // Every board in the frame, ordered by board index
+    void detect(const cv::Mat& gray, std::vector<BoardDetection>& detections);
+
+    // Pose and reprojection error of every detection, solved in parallel with
+    // one PoseTracker per board
+    void solvePoses(const Camera& camera, std::vector<BoardDetection>& detections);
+
+    // Forget the tracked boards
+    void reset();
+
+    const MultiBoardStats& stats() const { return stats_; }
+    // The pose statistics of one board
+    const PoseStats& poseStats(int board) const { return targets_[board].pose_tracker.stats(); }
+
+private:
+    struct Target {
+        BoardSpec spec;
+        std::vector<cv::Vec3f> points;
+        SubpixRefiner refiner;
+        PoseTracker pose_tracker;
+        std::vector<cv::Point2f> previous;  // corners in the previous frame, empty if not found
+        int since_search = 0;               // frames since the last whole-image search
+    };
+
+    bool findInRegion(Target& target, std::vector<cv::Point2f>& corners) const;
+    bool search(Target& target, std::vector<cv::Point2f>& corners);
+    void toFullResolution(std::vector<cv::Point2f>& corners, cv::Point offset) const;
+    void maskOut(const std::vector<cv::Point2f>& corners, cv::Size board_size);
+
+    Config cfg_;
+    std::vector<BoardSpec> specs_;
+    std::vector<Target> targets_;
+    std::vector<int> search_order_;  // largest board first
+    double scale_ = 1.0;             // search image / full resolution
+    cv::Mat search_;                 // found boards masked out
+    cv::Mat probe_;
+    bool probe_ready_ = false;
+    MultiBoardStats stats_;
+};
+
+// Summary such as "Multi-board: 2 boards, 1795 found in 900 frames (1790 tracked), 12 searches, 3 gated"
+void printMultiBoardStats(std::ostream& out, const MultiBoardStats& stats, size_t boards);
+
+}  // namespace calib
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/config.hpp"
+#include "calib/geometry.hpp"
+
+namespace calib {
+
+enum class OverlayLayer { Corners, Axes, Projected, Objects, Count };
+
+// AR drawing layer kept apart from the camera frame.
+//
+// Each frame the tools record their primitives between begin() and
+// composite(). Primitives go into a premultiplied BGRA overlay buffer, and
+// only the kTileSize tiles they touch are cleared, redrawn and blended onto
+// the frame, so the cost follows the overlay's area rather than the frame's.
+// If a frame records exactly the primitives of the previous one and no layer
+// was toggled, nothing is redrawn and the buffer is blended as it is.
+//
+// Hidden layers are still recorded, so toggling one takes effect on the next
+// composite() without recording the frame again.
+class Overlay {
+public:
+    static constexpr int kTileSize = 32;
+
+    Overlay();
+    // Visible layers and opacity from overlay_layers / overlay_opacity
+    explicit Overlay(const Config& cfg);
+
+    void setVisible(OverlayLayer layer, bool visible);
+    bool visible(OverlayLayer layer) const { return visible_[static_cast<size_t>(layer)]; }
+    void toggle(OverlayLayer layer) { setVisible(layer, !visible(layer)); }
+
+    // Keys '1'-'4' toggle the layers in OverlayLayer order. Returns false for
+    // any other key.
+    bool handleKey(int key);
+
+    // Start recording the primitives of a new frame
+    void begin();
+
+    // Sub-pixel, anti-aliased primitives. thickness < 0 fills the circle.
+    void line(OverlayLayer layer, cv::Point2f a, cv::Point2f b, const cv::Scalar& color, int thickness = 2);
+    void circle(OverlayLayer layer, cv::Point2f center, float radius, const cv::Scalar& color, int thickness = -1);
+
+    // The same markings as cv::drawChessboardCorners, on the Corners layer
+    void chessboardCorners(cv::Size pattern_size, const std::vector<cv::Point2f>& corners, bool found);
+
+    // Overlay versions of drawAxes and drawProjectedCorners
+    void axes(const Intrinsics& intrinsics, const cv::Mat& rvec, const cv::Mat& tvec, float length,
+              int thickness = 2);
+    void projectedCorners(const std::vector<cv::Vec3f>& object_points, const Intrinsics& intrinsics,
+                          const cv::Mat& rvec, const cv::Mat& tvec, const cv::Scalar& color);
+    void axes(const Camera& camera, const Pose& pose, float length, int thickness = 2);
+    void projectedCorners(PointSpan object_points, const Camera& camera, const Pose& pose, const cv::Scalar& color);
+
+    // Draw what was recorded since begin() (unless unchanged) and blend it
+    // onto the 8-bit BGR frame
+    void composite(cv::Mat& frame);
+
+    // Regions blended by the last composite(), one per run of dirty tiles
+    const std::vector<cv::Rect>& dirtyRects() const { return dirty_rects_; }
+    // Whether the last composite() had to redraw the overlay
+    bool redrawn() const { return redrawn_; }
+
+private:
+    struct Primitive {
+        enum class Kind { Line, Circle } kind;
+        OverlayLayer layer;
+        cv::Point2f a, b;  // line end points, or circle centre and (radius, 0)
+        cv::Scalar color;  // premultiplied BGRA
+        int thickness;
+
+        bool operator==(const Primitive& other) const;
+    };
+
+    void redraw();
+    void markTiles(const cv::Rect& bounds);
+
+    std::array<bool, static_cast<size_t>(OverlayLayer::Count)> visible_, drawn_visible_;
+    double opacity_ = 1.0;
+    std::vector<Primitive> primitives_, drawn_;
+    cv::Mat buffer_;                      // CV_8UC4, premultiplied
+    cv::Size tiles_;                      // tile grid size
+    std::vector<uint8_t> dirty_tiles_;    // tiles_ row-major, non-zero if drawn on
+    std::vector<cv::Rect> dirty_rects_;
+    std::vector<cv::Point2f> projected_;  // reused by projectedCorners
+    bool redrawn_ = false;
+    bool force_redraw_ = true;
+};
+
+// Blend a premultiplied BGRA overlay onto a same-sized 8-bit BGR image:
+// dst = overlay + dst * (255 - alpha) / 255, vectorized with OpenCV's
+// universal intrinsics where available
+void blendPremultiplied(const cv::Mat& overlay, cv::Mat& dst);
+
+}  // namespace calib
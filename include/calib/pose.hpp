@@ -0,0 +1,88 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/config.hpp"
+#include "calib/geometry.hpp"
+
+namespace calib {
+
+// PnP solvers for the board:
+//   Iterative  cv::SOLVEPNP_ITERATIVE, homography start and Levenberg-Marquardt
+//   Ippe       cv::SOLVEPNP_IPPE, closed form for planar targets; returns both
+//              poses of the planar two-fold ambiguity
+//   Sqpnp      cv::SOLVEPNP_SQPNP, globally optimal for any point layout
+enum class PoseSolver { Iterative, Ippe, Sqpnp };
+
+// Config name of a solver: iterative, ippe, sqpnp
+const char* poseSolverName(PoseSolver solver);
+bool parsePoseSolver(const std::string& name, PoseSolver& solver);
+
+struct PoseOptions {
+    PoseSolver solver = PoseSolver::Ippe;
+    // IPPE: when the second solution's reprojection error is within this
+    // factor of the best, the two are ambiguous and PoseTracker keeps the one
+    // nearer the previous pose. 1 always takes the best.
+    double ambiguity_ratio = 1.2;
+    bool refine = false;  // polish the pose with cv::solvePnPRefineLM
+};
+
+// Solver settings from the pose_* config keys
+PoseOptions poseOptions(const Config& cfg);
+
+// Board pose relative to the camera from detected corners, with the default
+// solver (IPPE on planar points) and the lowest-error solution
+bool solvePose(const std::vector<cv::Vec3f>& object_points, const std::vector<cv::Point2f>& corners,
+               const Intrinsics& intrinsics, cv::Mat& rvec, cv::Mat& tvec);
+bool solvePose(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera, Pose& pose);
+bool solvePose(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera, Pose& pose,
+               const PoseOptions& options);
+
+// RMS distance in pixels between the corners and the board reprojected with
+// the pose
+double reprojectionError(const std::vector<cv::Vec3f>& object_points, const std::vector<cv::Point2f>& corners,
+                         const Intrinsics& intrinsics, const cv::Mat& rvec, const cv::Mat& tvec);
+double reprojectionError(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera,
+                         const Pose& pose);
+
+struct PoseStats {
+    int64_t solved = 0;     // poses returned
+    int64_t failed = 0;     // frames the solver found no pose for
+    int64_t ambiguous = 0;  // IPPE frames with two plausible poses
+    int64_t flipped = 0;    // ambiguous frames where continuity overruled the lower error
+};
+
+// Pose solving across the frames of a stream. IPPE's ambiguity is resolved
+// towards the previous pose and the iterative solver starts from it, so a
+// tracked board does not flip between its mirror-image poses. Object points
+// off the z = 0 plane fall back from IPPE to the iterative solver. Call
+// reset() when the board is lost.
+class PoseTracker {
+public:
+    explicit PoseTracker(const PoseOptions& options = PoseOptions());
+
+    bool solve(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera, Pose& pose);
+    void reset() { has_previous_ = false; }
+
+    const PoseOptions& options() const { return options_; }
+    const PoseStats& stats() const { return stats_; }
+
+private:
+    PoseOptions options_;
+    bool has_previous_ = false;
+    Pose previous_;
+    PoseStats stats_;
+    std::vector<cv::Point2f> normalized_;
+    std::vector<cv::Mat> rvecs_, tvecs_;
+    cv::Mat errors_;
+};
+
+// One-line summary such as "Pose solver ippe: 900 poses, 0 failed, 35 ambiguous, 4 flips avoided"
+void printPoseStats(std::ostream& out, const PoseOptions& options, const PoseStats& stats);
+
+}  // namespace calib
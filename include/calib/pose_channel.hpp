@@ -0,0 +1,100 @@
+#pragma once
+
+// Low-latency local pose transport. The tracker publishes into a POSIX
+// shared-memory ring; any number of processes read from it. This header has
+// no OpenCV dependency so clients only need to link calib_pose.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace calib {
+
+struct PoseMessage {
+    uint64_t sequence = 0;  // 0 for the first pose published on the channel
+    int64_t frame = -1;     // frame number in the tracker's source
+    double timestamp = 0.0; // seconds since the start of the source
+    double rvec[3] = {0, 0, 0};
+    double tvec[3] = {0, 0, 0};
+    double error = 0.0;         // RMS reprojection error in pixels
+    double published_at = 0.0;  // monotonicSeconds() when published
+};
+
+// CLOCK_MONOTONIC in seconds, comparable across processes on one machine
+double monotonicSeconds();
+
+struct PoseRing;
+
+// Writer side. publish() is wait-free: it writes the slot under a per-slot
+// sequence lock and never waits for readers, so a slow or stalled client
+// cannot hold up the tracker. Readers that fall more than `capacity` poses
+// behind lose the oldest ones.
+class PosePublisher {
+public:
+    PosePublisher() = default;
+    ~PosePublisher();
+    PosePublisher(const PosePublisher&) = delete;
+    PosePublisher& operator=(const PosePublisher&) = delete;
+
+    // name is a shared-memory object name such as "/calib_pose"; an existing
+    // channel of that name is replaced
+    bool open(const std::string& name, uint32_t capacity = 1024);
+    void publish(PoseMessage message);
+    void close();
+
+    bool isOpen() const { return ring_ != nullptr; }
+
+private:
+    std::string name_;
+    PoseRing* ring_ = nullptr;
+    size_t bytes_ = 0;
+    uint64_t next_ = 0;
+};
+
+// Reader side: polling of the latest pose, in-order reads with loss
+// detection, and a callback subscription on a background thread.
+class PoseSubscriber {
+public:
+    PoseSubscriber() = default;
+    ~PoseSubscriber();
+    PoseSubscriber(const PoseSubscriber&) = delete;
+    PoseSubscriber& operator=(const PoseSubscriber&) = delete;
+
+    // Fails if no publisher has created the channel yet
+    bool open(const std::string& name);
+    void close();
+
+    // Most recent pose; false if none has been published
+    bool latest(PoseMessage& message) const;
+
+    // Next pose after the previous one returned by next() or wait(), starting
+    // with the first pose published after open(). False if there is none yet.
+    bool next(PoseMessage& message);
+
+    // next(), spinning briefly and then sleeping in short steps until a pose
+    // arrives or the timeout expires
+    bool wait(PoseMessage& message, double timeout_seconds);
+
+    // Poses overwritten before this reader got to them
+    uint64_t lost() const { return lost_; }
+
+    // Call back for every pose on a background thread until unsubscribe().
+    // The thread consumes poses through next(), so don't call next() or
+    // wait() while subscribed.
+    void subscribe(std::function<void(const PoseMessage&)> callback);
+    void unsubscribe();
+
+private:
+    bool read(uint64_t sequence, PoseMessage& message) const;
+
+    const PoseRing* ring_ = nullptr;
+    size_t bytes_ = 0;
+    uint64_t cursor_ = 0;
+    uint64_t lost_ = 0;
+    std::thread worker_;
+    std::atomic<bool> stop_{false};
+};
+
+}  // namespace calib
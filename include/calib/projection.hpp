@@ -0,0 +1,35 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/geometry.hpp"
+
+namespace calib {
+
+// Project 3D world points into the image with the given pose, through the
+// intrinsics' distortion model
+void projectPoints(const std::vector<cv::Point3f>& object_points, const cv::Mat& rvec, const cv::Mat& tvec,
+                   const Intrinsics& intrinsics, std::vector<cv::Point2f>& image_points);
+void projectPoints(const std::vector<cv::Vec3f>& object_points, const cv::Mat& rvec, const cv::Mat& tvec,
+                   const Intrinsics& intrinsics, std::vector<cv::Point2f>& image_points);
+
+// The same with fixed-size pose and camera; image_points receives
+// object_points.size() points. Neither allocates once image_points has grown
+// to the board size.
+void projectPoints(PointSpan object_points, const Pose& pose, const Camera& camera, cv::Point2f* image_points);
+void projectPoints(PointSpan object_points, const Pose& pose, const Camera& camera,
+                   std::vector<cv::Point2f>& image_points);
+
+// Draw the X (red), Y (green) and Z (blue) axes at the board origin. The Z
+// line is drawn along -Z, into the board and away from the camera (+Z = X x Y
+// faces the camera, as board rows run down -y).
+void drawAxes(cv::Mat& frame, const Intrinsics& intrinsics, const cv::Mat& rvec, const cv::Mat& tvec,
+              float length, int thickness = 2);
+
+// Project the board corners with the pose and mark them with filled circles
+void drawProjectedCorners(cv::Mat& frame, const std::vector<cv::Vec3f>& object_points, const Intrinsics& intrinsics,
+                          const cv::Mat& rvec, const cv::Mat& tvec, const cv::Scalar& color);
+
+}  // namespace calib
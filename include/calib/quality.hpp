@@ -0,0 +1,120 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "calib/config.hpp"
+#include "calib/detect.hpp"
+#include "calib/subpix.hpp"
+
+namespace calib {
+
+// Settings of the per-frame path that trade accuracy for time
+struct QualityLevel {
+    double detect_scale = 1.0;   // findChessboardCorners runs on the frame scaled by this
+    int subpix_window = 11;      // refinement at full resolution
+    int subpix_max_iter = 30;
+    int detect_every = 1;        // detect on every Nth frame, track the corners in between
+    bool overlay_detail = true;  // draw the corner markings
+};
+
+// The levels a controller steps through, from the configured settings
+// (level 0) down to the cheapest. No level refines with a larger window or
+// more iterations than the config.
+std::vector<QualityLevel> qualityLevels(const Config& cfg);
+
+struct QualityOptions {
+    bool adaptive = false;     // false stays at level 0
+    double budget_ms = 33.0;   // per-frame latency to hold
+    double raise_below = 0.7;  // step up once latency is under this fraction of the budget
+    int hold_frames = 30;      // frames at a level before stepping up again
+    double smoothing = 0.1;    // weight of the newest frame in the latency average
+};
+
+// Quality options from the quality_* config keys
+QualityOptions qualityOptions(const Config& cfg);
+
+// Parts of a frame that are timed separately
+enum class FrameStage { Detect, Pose, Draw, Output, Count };
+
+const char* frameStageName(FrameStage stage);
+
+struct QualityMetrics {
+    int level = 0;
+    double latency_ms = 0.0;  // smoothed frame latency
+    double last_ms = 0.0;     // latency of the last frame
+    std::array<double, static_cast<size_t>(FrameStage::Count)> stage_ms{};  // smoothed
+    int64_t frames = 0;
+    int64_t over_budget = 0;  // frames slower than the budget
+    int64_t detected = 0;     // frames that ran board detection
+    int64_t tracked = 0;      // frames whose corners were tracked from the previous frame
+    int64_t lowered = 0;      // level changes towards cheaper settings
+    int64_t raised = 0;
+    std::vector<int64_t> frames_at_level;
+};
+
+// Holds the tracking tools to a latency budget by adapting how much work each
+// frame gets.
+//
+// The tools bracket every frame with beginFrame() / endFrame() and mark its
+// stages with lap(). endFrame() updates a moving average of the frame
+// latency. When it exceeds the budget the controller moves one level down
+// qualityLevels(); when it has stayed below raise_below of the budget for
+// hold_frames frames it moves one level up. Lowering waits a few frames
+// after a change so the average can follow, and the gap between the two
+// thresholds keeps the level from oscillating.
+//
+// detect() finds the board at the current level. The frame is downscaled for
+// findChessboardCorners and the corners are refined on the full-resolution
+// frame. Between detections the corners are tracked with pyramidal optical
+// flow from the previous frame and refined again. A corner that cannot be
+// tracked ends the track, and the next frame is detected.
+class QualityController {
+public:
+    explicit QualityController(const Config& cfg);
+
+    // Board corners of the frame at the current level. The gate screens
+    // frames that are detected; tracked frames bypass it.
+    bool detect(const cv::Mat& gray, std::vector<cv::Point2f>& corners, BoardGate& gate);
+
+    void beginFrame();
+    // Record the time since the previous lap (or beginFrame) under stage;
+    // detect() records its own
+    void lap(FrameStage stage);
+    // Account the frame and adjust the level
+    void endFrame();
+
+    const QualityLevel& level() const { return levels_[level_]; }
+    const QualityMetrics& metrics() const { return metrics_; }
+    const QualityOptions& options() const { return options_; }
+
+private:
+    void setLevel(int level);
+    bool detectFull(const cv::Mat& gray, std::vector<cv::Point2f>& corners, BoardGate& gate);
+    bool track(const cv::Mat& gray, std::vector<cv::Point2f>& corners);
+
+    Config cfg_;
+    QualityOptions options_;
+    std::vector<QualityLevel> levels_;
+    int level_ = 0;
+    int since_change_ = 0;  // frames at the current level
+    int below_ = 0;         // consecutive frames under the raise threshold
+    SubpixRefiner refiner_;
+    cv::Mat small_;
+    cv::Mat previous_gray_;
+    std::vector<cv::Point2f> previous_corners_;
+    int since_detect_ = 0;
+    int64_t frame_start_ = 0;
+    int64_t lap_start_ = 0;
+    std::array<double, static_cast<size_t>(FrameStage::Count)> frame_stage_ms_{};
+    QualityMetrics metrics_;
+};
+
+// Summary such as "Quality: level 2 ..., 31.2 ms average against a 33 ms
+// budget, ..." followed by the frames spent at each level
+void printQualityMetrics(std::ostream& out, const QualityOptions& options, const QualityMetrics& metrics);
+
+}  // namespace calib
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "calib/config.hpp"
+#include "calib/geometry.hpp"
+
+namespace calib {
+
+// Triangle mesh in object (board) coordinates
+struct Mesh {
+    std::vector<cv::Vec3f> vertices;
+    std::vector<cv::Vec3i> triangles;  // vertex indices, either winding
+    std::vector<cv::Vec3f> normals;    // per vertex, the mean of the adjacent face normals
+    std::vector<cv::Vec3b> colors;     // per vertex, BGR
+};
+
+// A mesh of one color, with its vertex normals
+Mesh makeMesh(std::vector<cv::Vec3f> vertices, std::vector<cv::Vec3i> triangles, const cv::Scalar& color);
+
+// Axis-aligned box between two corners
+Mesh boxMesh(const cv::Vec3f& low, const cv::Vec3f& high, const cv::Scalar& color);
+
+// UV sphere of 2 * rings * segments triangles
+Mesh sphereMesh(const cv::Vec3f& center, float radius, int rings, int segments, const cv::Scalar& color);
+
+enum class Shading { Flat, Gouraud };
+
+struct RasterOptions {
+    Shading shading = Shading::Flat;
+    float ambient = 0.35f;  // light on faces turned away from the light
+    float near = 1e-3f;     // triangles with a vertex nearer than this are dropped
+};
+
+// Shading from render_mode (flat or gouraud)
+RasterOptions rasterOptions(const Config& cfg);
+
+struct RasterStats {
+    int64_t triangles = 0;  // submitted since begin()
+    int64_t dropped = 0;    // behind the near plane, degenerate or off screen
+    int64_t tiles = 0;      // tiles rasterized by the last render()
+};
+
+// Tile-based software rasterizer for filled, depth-tested meshes, drawn
+// straight into the camera frame without a GPU or a window.
+//
+// draw() transforms the mesh by the board pose, projects its vertices with
+// the camera (distortion included), lights them with a fixed light from
+// behind the camera, and sorts each triangle into the kTileSize tiles its
+// bounding box touches. Triangle edges stay straight between the projected
+// vertices. render() rasterizes the tiles in parallel. Each tile runs its
+// triangles in submission order with a depth test on 1/z, which
+// interpolates linearly in screen space. Edge functions and depth are
+// evaluated for a row of pixels at a time with OpenCV's universal
+// intrinsics. Flat shading colors a triangle by its face normal; Gouraud
+// interpolates the lit vertex colors.
+//
+// The bins are kept until the next begin(), so render() can redraw the same
+// meshes onto a fresh copy of the frame.
+class Rasterizer {
+public:
+    static constexpr int kTileSize = 32;
+
+    explicit Rasterizer(const RasterOptions& options = RasterOptions());
+
+    // Start a frame of the given size
+    void begin(cv::Size size);
+
+    void draw(const Mesh& mesh, const Camera& camera, const Pose& pose);
+
+    // Rasterize everything drawn since begin() into the 8-bit BGR frame
+    void render(cv::Mat& frame);
+
+    const RasterStats& stats() const { return stats_; }
+    const RasterOptions& options() const { return options_; }
+
+private:
+    // Screen-space setup of one triangle: barycentric weight i of pixel
+    // (x, y) is wx[i] * x + wy[i] * y + w0[i]
+    struct Triangle {
+        float wx[3], wy[3], w0[3];
+        float inv_z[3];
+        cv::Vec3f color[3];
+        cv::Rect bounds;  // pixels, clipped to the frame
+    };
+
+    void rasterizeTile(int tile, cv::Mat& frame);
+
+    RasterOptions options_;
+    cv::Size size_;
+    cv::Size tiles_;                           // tile grid size
+    std::vector<Triangle> triangles_;
+    std::vector<std::vector<uint32_t>> bins_;  // triangle indices per tile, row-major
+    std::vector<int> busy_tiles_;              // tiles with a non-empty bin
+    cv::Mat depth_;                            // CV_32F, 1/z
+    std::vector<cv::Point2f> projected_;
+    std::vector<cv::Vec3f> camera_points_, lit_;
+    RasterStats stats_;
+};
+
+}  // namespace calib
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/config.hpp"
+
+namespace calib {
+
+enum class RobustLoss { None, Huber, Cauchy };
+
+struct RefineOptions {
+    int max_iterations = 50;
+    double function_tolerance = 1e-9;  // stop when the cost drops by less than this fraction
+    RobustLoss loss = RobustLoss::Huber;
+    double loss_scale = 1.0;  // pixels: residuals above this are down-weighted
+
+    // After convergence, views whose RMS error exceeds reject_factor times
+    // the median view RMS (and loss_scale) are dropped and the problem is
+    // solved again, up to max_reject_rounds times. 0 disables rejection.
+    double reject_factor = 3.0;
+    int max_reject_rounds = 3;
+
+    // Distortion coefficients refined (k1, k2, p1, p2, k3, ...), at most the
+    // model's; any further coefficients are held at their input values
+    int distortion_terms = 5;
+};
+
+// Refiner settings from the refine_* config keys
+RefineOptions refineOptions(const Config& cfg);
+
+struct RefineReport {
+    double initial_rms = 0.0;  // over all views, before refinement
+    double final_rms = 0.0;    // over the views kept
+    int iterations = 0;
+    double seconds = 0.0;
+    std::vector<double> view_rms;  // per view, in pixels
+    std::vector<bool> rejected;    // per view
+};
+
+// Bundle adjustment of a calibration: Levenberg-Marquardt over the
+// intrinsics and every view's pose, starting from `result` (normally the
+// output of calibrate()) and updating it in place.
+//
+// Jacobians come analytically from cv::projectPoints and are evaluated for
+// all views in parallel. The 6x6 pose blocks are eliminated with the Schur
+// complement, so each step only solves a system the size of the intrinsics
+// and the cost grows linearly with the number of views. A Huber or Cauchy
+// loss limits the pull of bad corners, and views that still fit badly are
+// rejected (see RefineOptions). Rejected views keep a pose re-fitted to the
+// final intrinsics so their residual is still reported.
+//
+// Only the pinhole distortion models are supported. Returns false for
+// Fisheye or if fewer than kMinCalibrationViews views remain; result is then
+// left unchanged.
+bool refineCalibration(const std::vector<std::vector<cv::Vec3f>>& object_points,
+                       const std::vector<std::vector<cv::Point2f>>& image_points, const RefineOptions& options,
+                       CalibrationResult& result, RefineReport& report);
+
+}  // namespace calib
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/config.hpp"
+
+namespace calib {
+
+// Wall-clock time of the named stages of a run, measured lap by lap
+class StageClock {
+public:
+    struct Stage {
+        std::string name;
+        double seconds = 0.0;
+    };
+
+    StageClock();
+
+    // Record the time since the previous lap (or construction) under name
+    void lap(const std::string& name);
+
+    const std::vector<Stage>& stages() const { return stages_; }
+
+private:
+    int64_t last_ticks_;
+    std::vector<Stage> stages_;
+};
+
+// Thresholds a calibration must meet; a value <= 0 disables its check
+struct ReportOptions {
+    int grid_columns = 16;        // coverage cells across the image
+    double max_rms = 1.0;         // pixels, over every corner
+    double max_view_rms = 2.0;    // pixels, for any view that was not rejected
+    double min_coverage = 0.5;    // fraction of coverage cells with a corner
+};
+
+// Report options from the report_* config keys
+ReportOptions reportOptions(const Config& cfg);
+
+struct CalibrationReport {
+    cv::Size image_size;
+    Intrinsics intrinsics;
+    double rms = 0.0;  // over every corner of the kept views
+
+    // Per view, in input order
+    std::vector<std::string> views;
+    std::vector<double> view_rms, view_max;
+    std::vector<bool> rejected;
+    std::vector<std::vector<cv::Point2f>> residuals;  // projected - detected, per corner
+
+    // RMS residual of each board corner over the kept views
+    std::vector<double> corner_rms;
+
+    // Detected corners binned over the sensor: counts (CV_32S) and the mean
+    // residual of the corners in each cell (CV_64F, NaN where empty)
+    cv::Mat coverage, cell_error;
+    double coverage_fraction = 0.0;
+
+    std::vector<StageClock::Stage> timings;
+
+    ReportOptions options;
+    std::vector<std::string> failures;  // quality gates that did not pass
+    bool passed() const { return failures.empty(); }
+};
+
+// Residuals of every view and corner under the calibration, computed in
+// parallel, plus the coverage heatmap and quality gate results. view_names
+// and rejected may be empty.
+CalibrationReport buildReport(const std::vector<std::vector<cv::Vec3f>>& object_points,
+                              const std::vector<std::vector<cv::Point2f>>& image_points,
+                              const CalibrationResult& result, cv::Size image_size,
+                              const std::vector<std::string>& view_names, const std::vector<bool>& rejected,
+                              const ReportOptions& options);
+
+// Machine-readable report for automated checks
+bool writeReportJson(const std::string& path, const CalibrationReport& report);
+
+// Self-contained HTML page (inline SVG charts, no external resources)
+bool writeReportHtml(const std::string& path, const CalibrationReport& report);
+
+// Both of the above, as <base>.json and <base>.html
+bool writeReport(const std::string& base, const CalibrationReport& report);
+
+// One-line summary and every failed gate
+void printReportSummary(std::ostream& out, const CalibrationReport& report);
+
+}  // namespace calib
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "calib/calibration.hpp"
+#include "calib/config.hpp"
+#include "calib/refine.hpp"
+
+namespace calib {
+
+// Board detections of a synchronized multi-camera capture. Each camera has
+// its own image directory; images with the same file name in different
+// directories belong to the same frame set.
+struct RigObservations {
+    std::vector<std::string> cameras;     // image directory per camera
+    std::vector<std::string> frame_sets;  // file names, sorted
+    std::vector<cv::Size> image_sizes;    // per camera
+    // corners[camera][frame set], empty where the board was not found or
+    // the camera has no image for that frame set
+    std::vector<std::vector<std::vector<cv::Point2f>>> corners;
+
+    size_t views(size_t camera) const;
+};
+
+// Load and detect every image of every camera, spread over all cores
+bool detectRig(const std::vector<std::string>& camera_dirs, const Config& cfg, RigObservations& observations);
+
+struct RigCamera {
+    Intrinsics intrinsics;
+    cv::Size image_size;
+    cv::Matx33d R = cv::Matx33d::eye();  // camera 0 -> this camera
+    cv::Vec3d t;
+    double rms = 0.0;  // reprojection error over this camera's views
+    size_t views = 0;
+};
+
+struct RigCalibration {
+    std::vector<std::string> names;
+    std::vector<RigCamera> cameras;
+    double rms = 0.0;  // over every observation
+    int iterations = 0;
+};
+
+// Calibrate all cameras and their poses relative to camera 0.
+//
+// Each camera is first calibrated on its own. Camera-to-camera extrinsics
+// are initialised with cv::stereoCalibrate between cameras that saw the
+// board in the same frame sets; cameras without shared views of camera 0
+// are chained through the camera they share the most frame sets with.
+// Finally, a joint bundle adjustment refines every camera's intrinsics and
+// extrinsics together with one board pose per frame set, using the same
+// Schur-complement Levenberg-Marquardt solver as refineCalibration.
+//
+// Every camera is calibrated with the given distortion model; like
+// refineCalibration, the rig supports the pinhole models only and rejects
+// Fisheye.
+bool calibrateRig(const RigObservations& observations, const std::vector<cv::Vec3f>& board_points,
+                  DistortionModel model, const RefineOptions& options, RigCalibration& rig);
+
+// Intrinsics and extrinsics of every camera as an OpenCV YAML/XML file
+bool saveRig(const std::string& path, const RigCalibration& rig);
+
+// Rectification of a stereo pair: rotations and projections from
+// cv::stereoRectify and the remap tables for both cameras
+struct StereoRectification {
+    int left = 0, right = 1;
+    cv::Mat R1, R2, P1, P2, Q;
+    cv::Mat left_map1, left_map2, right_map1, right_map2;  // for cv::remap
+};
+
+StereoRectification rectifyPair(const RigCalibration& rig, int left, int right);
+
+// Store with cv::FileStorage; use a .yml.gz name to keep the maps small
+bool saveRectification(const std::string& path, const StereoRectification& rectification);
+
+}  // namespace calib
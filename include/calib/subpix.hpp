@@ -0,0 +1,63 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "calib/config.hpp"
+
+namespace calib {
+
+struct SubpixOptions {
+    int window = 11;                 // half window size, as passed to cornerSubPix
+    int max_iter = 30;
+    double epsilon = 0.001;          // stop once a corner moves less than this (pixels)
+    int parallel_min_corners = 256;  // boards with this many corners are split over threads, 0 never
+    bool warm_start = true;          // start from the previous call's subpixel offsets
+};
+
+// Subpixel options from the subpix_* config keys
+SubpixOptions subpixOptions(const Config& cfg);
+
+// Drop-in replacement for cv::cornerSubPix on 8-bit images, refining a
+// whole board per call.
+//
+// It runs the same iteration as cornerSubPix (the gradient-weighted normal
+// equations over a Gaussian-weighted window, with the same termination and
+// the same fallback to the input point when a corner wanders off more than a
+// window) but without the per-corner setup: the window weights are computed
+// once, the bilinear resampling and gradient sums run over whole window rows
+// with OpenCV's universal intrinsics, and the scratch buffers are reused.
+// Each corner stops as soon as it has converged.
+//
+// With warm_start, a refiner that is fed consecutive frames of a tracked
+// board starts every corner from its input position plus the offset the
+// previous call applied to it, which usually saves most of the iterations.
+// The result is still checked against, and bounded by, the input position.
+class SubpixRefiner {
+public:
+    SubpixRefiner() : SubpixRefiner(SubpixOptions()) {}
+    explicit SubpixRefiner(const SubpixOptions& options);
+
+    // Refine the corners in place on an 8-bit single-channel image
+    void refine(const cv::Mat& gray, std::vector<cv::Point2f>& corners);
+
+    // Forget the offsets of the previous call (e.g. after losing the board)
+    void reset() { offsets_.clear(); }
+
+    // Iterations summed over the corners of the last refine()
+    int lastIterations() const { return last_iterations_; }
+
+    const SubpixOptions& options() const { return options_; }
+
+private:
+    SubpixOptions options_;
+    int size_;                       // full window width, 2 * window + 1
+    int padded_;                     // size_ rounded up to whole vectors
+    int stride_;                     // row stride of the resampled patch
+    std::vector<float> mask_;        // Gaussian weights, size_ rows of padded_ (zero padding)
+    std::vector<float> px_;          // column offsets from the centre, padded_
+    std::vector<cv::Point2f> offsets_;
+    int last_iterations_ = 0;
+};
+
+}  // namespace calib
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "calib/config.hpp"
+#include "calib/pose_channel.hpp"
+
+namespace calib {
+
+// One tracked board pose
+struct PoseSample {
+    double timestamp = 0.0;  // seconds since the start of the source
+    int64_t frame = -1;      // frame number in the source
+    cv::Vec3d rvec, tvec;
+    double error = 0.0;  // RMS reprojection error in pixels, NaN if unknown
+};
+
+// The sample as sent over a pose channel
+PoseMessage toPoseMessage(const PoseSample& sample);
+
+// Poses held column by column, as stored in the trajectory file
+struct TrajectoryColumns {
+    std::vector<double> timestamp;
+    std::vector<int64_t> frame;
+    std::vector<cv::Vec3d> rvec, tvec;
+    std::vector<double> error;
+
+    size_t size() const { return frame.size(); }
+    void clear();
+    void append(const PoseSample& sample);
+    PoseSample row(size_t i) const;
+};
+
+struct TrajectoryOptions {
+    uint32_t chunk_rows = 4096;  // poses per chunk, the unit of random access
+    bool float32 = false;        // store rvec, tvec and error as float32
+    // Store timestamps (at 1 us resolution) and frame numbers as
+    // variable-length deltas, usually one or two bytes per pose
+    bool delta = true;
+};
+
+// Writer options from the trajectory_* config keys
+TrajectoryOptions trajectoryOptions(const Config& cfg);
+
+// Trajectory file layout (little endian):
+//
+//   header  "CALTRAJ1", u32 version, u32 flags, u32 chunk_rows, u32 reserved
+//   chunk*  one column after another: timestamp, frame, rvec x/y/z,
+//           tvec x/y/z, error
+//   index   per chunk: u64 offset, u32 rows, u32 bytes, i64 first/last
+//           frame, f64 first/last timestamp
+//   footer  u64 index offset, u64 rows, u32 chunks, u32 reserved, "CALTRIDX"
+//
+// Frames and timestamps must not decrease, so the index can be binary
+// searched. Opening a file only reads the header, footer and index.
+
+// Appends poses and writes a chunk each time chunk_rows are buffered. The
+// index and footer are written by close(); a file that was never closed has
+// no index and cannot be opened.
+class TrajectoryWriter {
+public:
+    TrajectoryWriter() = default;
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    bool open(const std::string& path, const TrajectoryOptions& options = TrajectoryOptions());
+    bool append(const PoseSample& sample);
+    bool close();
+
+    bool isOpen() const { return file_.is_open(); }
+    uint64_t rows() const { return rows_; }
+
+private:
+    struct ChunkInfo {
+        uint64_t offset = 0;
+        uint32_t rows = 0, bytes = 0;
+        int64_t first_frame = 0, last_frame = 0;
+        double first_time = 0.0, last_time = 0.0;
+    };
+
+    bool flushChunk();
+
+    std::ofstream file_;
+    std::string path_;
+    TrajectoryOptions options_;
+    TrajectoryColumns pending_;
+    std::vector<ChunkInfo> index_;
+    uint64_t rows_ = 0;
+};
+
+// Random access to a trajectory file. Seeking by frame or time is a binary
+// search over the chunk index followed by one within the decoded chunk; the
+// most recently decoded chunk is cached.
+class TrajectoryReader {
+public:
+    bool open(const std::string& path);
+
+    uint64_t size() const { return rows_; }
+    size_t chunkCount() const { return index_.size(); }
+
+    // Decode every pose (one sequential read of the chunk area)
+    bool readAll(TrajectoryColumns& columns);
+
+    // Decode rows [begin, end)
+    bool readRows(uint64_t begin, uint64_t end, TrajectoryColumns& columns);
+
+    bool sample(uint64_t row, PoseSample& sample);
+
+    // Row of the first pose at or after the frame number / time, or size()
+    // if there is none
+    uint64_t findFrame(int64_t frame);
+    uint64_t findTime(double timestamp);
+
+private:
+    struct ChunkInfo {
+        uint64_t offset = 0, first_row = 0;
+        uint32_t rows = 0, bytes = 0;
+        int64_t first_frame = 0, last_frame = 0;
+        double first_time = 0.0, last_time = 0.0;
+    };
+
+    size_t chunkOfRow(uint64_t row) const;
+    bool loadChunk(size_t chunk);
+
+    std::ifstream file_;
+    std::string path_;
+    uint32_t flags_ = 0;
+    uint64_t rows_ = 0;
+    std::vector<ChunkInfo> index_;
+    size_t cached_chunk_ = SIZE_MAX;
+    TrajectoryColumns cache_;
+};
+
+}  // namespace calib
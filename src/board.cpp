@@ -0,0 +1,48 @@
+#include "calib/board.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+namespace calib {
+
+std::vector<cv::Vec3f> boardPoints(const Config& cfg) {
+    return boardPoints(cfg.boardSize(), cfg.square_size);
+}
+
+std::vector<cv::Vec3f> boardPoints(cv::Size board_size, double square_size) {
+    std::vector<cv::Vec3f> point_set;
+    point_set.reserve(static_cast<size_t>(board_size.width) * board_size.height);
+    for (int i = 0; i < board_size.height; i++) {
+        for (int j = 0; j < board_size.width; j++) {
+            point_set.push_back(cv::Vec3f(j * square_size, -i * square_size, 0));
+        }
+    }
+    return point_set;
+}
+
+bool isImageFile(const std::string& filename) {
+    std::string ext = std::filesystem::path(filename).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    static const std::vector<std::string> extensions = {".jpg", ".jpeg", ".png", ".bmp", ".tiff"};
+    return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+std::vector<std::string> listImages(const std::string& directory) {
+    std::vector<std::string> images;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::string image_path = entry.path().string();
+        if (entry.is_regular_file() && isImageFile(image_path)) {
+            images.push_back(image_path);
+        }
+    }
+    if (ec) {
+        std::cerr << "Error: Could not read directory " << directory << ": " << ec.message() << std::endl;
+    }
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+}  // namespace calib
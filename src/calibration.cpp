@@ -0,0 +1,106 @@
+#include "calib/calibration.hpp"
+
+#include <opencv2/calib3d.hpp>
+
+namespace calib {
+
+namespace {
+
+const DistortionModel kModels[] = {DistortionModel::None, DistortionModel::Radial2, DistortionModel::RadTan5,
+                                   DistortionModel::Rational8, DistortionModel::Fisheye};
+
+}  // namespace
+
+int distortionCoefficients(DistortionModel model) {
+    switch (model) {
+        case DistortionModel::None: return 0;
+        case DistortionModel::Radial2: return 2;
+        case DistortionModel::RadTan5: return 5;
+        case DistortionModel::Rational8: return 8;
+        case DistortionModel::Fisheye: return 4;
+    }
+    return 0;
+}
+
+const char* distortionModelName(DistortionModel model) {
+    switch (model) {
+        case DistortionModel::None: return "none";
+        case DistortionModel::Radial2: return "radial2";
+        case DistortionModel::RadTan5: return "radtan5";
+        case DistortionModel::Rational8: return "rational8";
+        case DistortionModel::Fisheye: return "fisheye";
+    }
+    return "";
+}
+
+bool parseDistortionModel(const std::string& name, DistortionModel& model) {
+    for (DistortionModel candidate : kModels) {
+        if (name == distortionModelName(candidate)) {
+            model = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+DistortionModel distortionModel(const Config& cfg) {
+    DistortionModel model = DistortionModel::RadTan5;
+    parseDistortionModel(cfg.distortion_model, model);
+    return model;
+}
+
+Intrinsics initialIntrinsics(cv::Size image_size, DistortionModel model) {
+    Intrinsics intrinsics;
+    intrinsics.camera_matrix = cv::Mat::eye(3, 3, CV_64F);
+    intrinsics.camera_matrix.at<double>(0, 2) = image_size.width / 2.0;
+    intrinsics.camera_matrix.at<double>(1, 2) = image_size.height / 2.0;
+    const int n = distortionCoefficients(model);
+    intrinsics.dist_coeffs = n > 0 ? cv::Mat::zeros(n, 1, CV_64F) : cv::Mat();
+    intrinsics.model = model;
+    return intrinsics;
+}
+
+CalibrationResult calibrate(const std::vector<std::vector<cv::Vec3f>>& object_points,
+                            const std::vector<std::vector<cv::Point2f>>& image_points,
+                            cv::Size image_size, const Intrinsics& initial) {
+    CalibrationResult result;
+    result.intrinsics.camera_matrix = initial.camera_matrix.clone();
+    result.intrinsics.model = initial.model;
+
+    if (initial.model == DistortionModel::Fisheye) {
+        cv::Mat dist = cv::Mat::zeros(4, 1, CV_64F);
+        result.reprojection_error = cv::fisheye::calibrate(
+            object_points, image_points, image_size, result.intrinsics.camera_matrix, dist, result.rvecs,
+            result.tvecs, cv::fisheye::CALIB_RECOMPUTE_EXTRINSIC | cv::fisheye::CALIB_FIX_SKEW);
+        result.intrinsics.dist_coeffs = dist;
+        return result;
+    }
+
+    // calibrateCamera estimates 5 or 8 coefficients; the smaller models fix
+    // the terms they do not have at zero
+    int flags = 0;
+    cv::Mat dist = cv::Mat::zeros(5, 1, CV_64F);
+    switch (initial.model) {
+        case DistortionModel::None:
+            flags = cv::CALIB_FIX_K1 | cv::CALIB_FIX_K2 | cv::CALIB_FIX_K3 | cv::CALIB_ZERO_TANGENT_DIST;
+            break;
+        case DistortionModel::Radial2:
+            flags = cv::CALIB_FIX_K3 | cv::CALIB_ZERO_TANGENT_DIST;
+            break;
+        case DistortionModel::Rational8:
+            flags = cv::CALIB_RATIONAL_MODEL;
+            dist = cv::Mat::zeros(8, 1, CV_64F);
+            break;
+        default:
+            break;
+    }
+    result.reprojection_error = cv::calibrateCamera(object_points, image_points, image_size,
+                                                    result.intrinsics.camera_matrix, dist, result.rvecs,
+                                                    result.tvecs, flags);
+    const int n = distortionCoefficients(initial.model);
+    result.intrinsics.dist_coeffs = n > 0 ? dist.reshape(1, static_cast<int>(dist.total())).rowRange(0, n).clone()
+                                          : cv::Mat();
+    return result;
+}
+
+}  // namespace calib
@@ -0,0 +1,249 @@
+#include "calib/capture.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace calib {
+
+namespace {
+
+// Scales of the signature terms that make up a distance of 1
+constexpr double kCenterScale = 0.1;
+constexpr double kLogScaleScale = 0.2;
+constexpr double kAngleScale = 15.0;
+constexpr double kTiltScale = 0.1;
+
+// Value below which the given fraction of the 8-bit histogram lies
+int histogramPercentile(const int* histogram, int total, double fraction) {
+    const int target = static_cast<int>(fraction * total);
+    int sum = 0;
+    for (int v = 0; v < 256; ++v) {
+        sum += histogram[v];
+        if (sum > target) return v;
+    }
+    return 255;
+}
+
+}  // namespace
+
+CaptureOptions captureOptions(const Config& cfg) {
+    CaptureOptions options;
+    options.grid_columns = cfg.report_grid;
+    options.coverage_target = cfg.capture_coverage;
+    options.min_views = cfg.capture_min_views;
+    options.max_views = cfg.capture_max_views;
+    options.min_novelty = cfg.capture_min_novelty;
+    options.min_new_cells = cfg.capture_min_new_cells;
+    options.min_sharpness = cfg.capture_min_sharpness;
+    options.max_motion = cfg.capture_max_motion;
+    return options;
+}
+
+ViewSignature viewSignature(const std::vector<cv::Point2f>& corners, cv::Size pattern_size, cv::Size image_size) {
+    const int w = pattern_size.width, n = static_cast<int>(corners.size());
+    cv::Point2d c0 = corners[0], c1 = corners[w - 1], c2 = corners[n - 1], c3 = corners[n - w];
+    // findChessboardCorners may return the board rotated by 180 degrees;
+    // order it so the first row runs left to right
+    if (c1.x < c0.x) {
+        std::swap(c0, c2);
+        std::swap(c1, c3);
+    }
+
+    ViewSignature s;
+    const cv::Point2d center = (c0 + c1 + c2 + c3) * 0.25;
+    s.center = cv::Point2d(center.x / image_size.width, center.y / image_size.height);
+    const double area = 0.5 * std::abs((c0.x - c2.x) * (c1.y - c3.y) - (c1.x - c3.x) * (c0.y - c2.y));
+    const double diagonal = std::hypot(image_size.width, image_size.height);
+    s.log_scale = std::log(std::max(std::sqrt(area), 1.0) / diagonal);
+    const cv::Point2d row = c1 - c0;
+    s.angle = std::atan2(row.y, row.x) * 180.0 / CV_PI;
+    auto length = [](const cv::Point2d& a, const cv::Point2d& b) { return std::max(cv::norm(a - b), 1e-6); };
+    s.tilt_x = std::log(length(c0, c1) / length(c3, c2));
+    s.tilt_y = std::log(length(c0, c3) / length(c1, c2));
+    return s;
+}
+
+double viewDistance(const ViewSignature& a, const ViewSignature& b) {
+    double roll = std::fmod(std::abs(a.angle - b.angle), 180.0);
+    roll = std::min(roll, 180.0 - roll);
+    return cv::norm(a.center - b.center) / kCenterScale + std::abs(a.log_scale - b.log_scale) / kLogScaleScale +
+           roll / kAngleScale + (std::abs(a.tilt_x - b.tilt_x) + std::abs(a.tilt_y - b.tilt_y)) / kTiltScale;
+}
+
+double edgeSharpness(const cv::Mat& gray, const cv::Rect& roi) {
+    const cv::Rect r = roi & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (r.width < 4 || r.height < 4) return 0.0;
+    const cv::Mat patch = gray(r);
+
+    int histogram[256] = {0};
+    for (int y = 0; y < patch.rows; ++y) {
+        const uchar* p = patch.ptr<uchar>(y);
+        for (int x = 0; x < patch.cols; ++x) histogram[p[x]]++;
+    }
+    const int total = static_cast<int>(patch.total());
+    const int contrast = histogramPercentile(histogram, total, 0.98) - histogramPercentile(histogram, total, 0.02);
+    if (contrast <= 0) return 0.0;
+
+    // Sobel / 8 is the central difference of a smoothed image: a step of
+    // height C gives C / 2
+    cv::Mat gx, gy, magnitude;
+    cv::Sobel(patch, gx, CV_32F, 1, 0, 3, 1.0 / 8);
+    cv::Sobel(patch, gy, CV_32F, 0, 1, 3, 1.0 / 8);
+    cv::magnitude(gx, gy, magnitude);
+    const float* m = magnitude.ptr<float>();
+    std::vector<float> values(m, m + magnitude.total());
+    auto percentile = values.begin() + static_cast<std::ptrdiff_t>(0.99 * (values.size() - 1));
+    std::nth_element(values.begin(), percentile, values.end());
+    return *percentile / contrast;
+}
+
+CaptureAssistant::CaptureAssistant(cv::Size pattern_size, const CaptureOptions& options)
+    : pattern_size_(pattern_size), options_(options) {}
+
+void CaptureAssistant::resizeGrid(cv::Size image_size) {
+    if (image_size == image_size_) return;
+    image_size_ = image_size;
+    const int cols = std::max(1, options_.grid_columns);
+    const int rows = std::max(1, static_cast<int>(std::lround(cols * static_cast<double>(image_size.height) /
+                                                               std::max(image_size.width, 1))));
+    grid_ = cv::Mat::zeros(rows, cols, CV_32S);
+    for (const auto& view : views_) {
+        for (const auto& p : view) grid_.at<int>(cell(p))++;
+    }
+}
+
+cv::Point CaptureAssistant::cell(cv::Point2f p) const {
+    const int cx = static_cast<int>(p.x * grid_.cols / image_size_.width);
+    const int cy = static_cast<int>(p.y * grid_.rows / image_size_.height);
+    return cv::Point(std::min(grid_.cols - 1, std::max(0, cx)), std::min(grid_.rows - 1, std::max(0, cy)));
+}
+
+CaptureAssistant::Verdict CaptureAssistant::offer(const cv::Mat& gray, const std::vector<cv::Point2f>& corners) {
+    if (done()) return Verdict::Done;
+    if (static_cast<int>(corners.size()) != pattern_size_.area()) {
+        previous_.clear();
+        return Verdict::NoBoard;
+    }
+    resizeGrid(gray.size());
+
+    // A board that is still moving is likely motion blurred; the first
+    // frame of a board has nothing to compare with
+    if (options_.max_motion > 0) {
+        const bool known = previous_.size() == corners.size();
+        double motion = 0.0;
+        for (size_t i = 0; known && i < corners.size(); ++i) motion += cv::norm(corners[i] - previous_[i]);
+        previous_ = corners;
+        if (!known || motion / corners.size() > options_.max_motion) return Verdict::Moving;
+    }
+
+    // Something new: a different pose or corners where there were none
+    const ViewSignature signature = viewSignature(corners, pattern_size_, gray.size());
+    last_novelty_ = std::numeric_limits<double>::infinity();
+    for (const auto& s : signatures_) last_novelty_ = std::min(last_novelty_, viewDistance(signature, s));
+    int new_cells = 0;
+    std::vector<cv::Point> seen;
+    for (const auto& p : corners) {
+        const cv::Point c = cell(p);
+        if (grid_.at<int>(c) == 0 && std::find(seen.begin(), seen.end(), c) == seen.end()) {
+            seen.push_back(c);
+            new_cells++;
+        }
+    }
+    if (last_novelty_ < options_.min_novelty && new_cells < options_.min_new_cells) return Verdict::Redundant;
+
+    if (options_.min_sharpness > 0) {
+        last_sharpness_ = edgeSharpness(gray, cv::boundingRect(corners));
+        if (last_sharpness_ < options_.min_sharpness) return Verdict::Blurred;
+    }
+
+    accept(corners, gray.size());
+    return Verdict::Accepted;
+}
+
+void CaptureAssistant::accept(const std::vector<cv::Point2f>& corners, cv::Size image_size) {
+    resizeGrid(image_size);
+    views_.push_back(corners);
+    signatures_.push_back(viewSignature(corners, pattern_size_, image_size));
+    for (const auto& p : corners) grid_.at<int>(cell(p))++;
+}
+
+double CaptureAssistant::coverage() const {
+    if (grid_.empty()) return 0.0;
+    return static_cast<double>(cv::countNonZero(grid_)) / grid_.total();
+}
+
+bool CaptureAssistant::done() const {
+    const int n = static_cast<int>(views_.size());
+    return n >= options_.max_views || (n >= options_.min_views && coverage() >= options_.coverage_target);
+}
+
+const char* verdictName(CaptureAssistant::Verdict verdict) {
+    switch (verdict) {
+        case CaptureAssistant::Verdict::Accepted: return "accepted";
+        case CaptureAssistant::Verdict::NoBoard: return "no board";
+        case CaptureAssistant::Verdict::Moving: return "hold still";
+        case CaptureAssistant::Verdict::Redundant: return "move to a new pose";
+        case CaptureAssistant::Verdict::Blurred: return "blurred";
+        case CaptureAssistant::Verdict::Done: return "done";
+    }
+    return "";
+}
+
+AsyncImageWriter::AsyncImageWriter(size_t max_pending)
+    : max_pending_(std::max<size_t>(max_pending, 1)), thread_(&AsyncImageWriter::run, this) {}
+
+AsyncImageWriter::~AsyncImageWriter() {
+    close();
+}
+
+void AsyncImageWriter::write(const std::string& path, const cv::Mat& image) {
+    cv::Mat copy = image.clone();
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&] { return stop_ || queue_.size() < max_pending_; });
+    if (stop_) return;
+    queue_.emplace_back(path, std::move(copy));
+    changed_.notify_all();
+}
+
+void AsyncImageWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+int AsyncImageWriter::written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+int AsyncImageWriter::failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+void AsyncImageWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        changed_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+        // Drain the queue even when stopping
+        if (queue_.empty()) return;
+        std::pair<std::string, cv::Mat> job = std::move(queue_.front());
+        queue_.pop_front();
+        changed_.notify_all();
+
+        lock.unlock();
+        bool ok = cv::imwrite(job.first, job.second);
+        if (!ok) std::cerr << "Error: Could not write " << job.first << std::endl;
+        lock.lock();
+        ok ? written_++ : failed_++;
+    }
+}
+
+}  // namespace calib
@@ -0,0 +1,301 @@
+#include "calib/config.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace calib {
+
+namespace {
+
+std::string trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+bool parseBool(const std::string& value, bool& out) {
+    std::string v = value;
+    std::transform(v.begin(), v.end(), v.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (v == "1" || v == "true" || v == "yes" || v == "on") { out = true; return true; }
+    if (v == "0" || v == "false" || v == "no" || v == "off") { out = false; return true; }
+    return false;
+}
+
+bool parseInt(const std::string& value, int& out) {
+    try {
+        size_t used = 0;
+        out = std::stoi(value, &used);
+        return used == value.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool parseDouble(const std::string& value, double& out) {
+    try {
+        size_t used = 0;
+        out = std::stod(value, &used);
+        return used == value.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Accept one of a fixed set of names
+bool parseChoice(const std::string& value, std::initializer_list<const char*> choices, std::string& out) {
+    for (const char* choice : choices) {
+        if (value == choice) {
+            out = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Comma separated items, trimmed, empty items dropped
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        item = trim(item);
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// Accept a comma separated list drawn from a fixed set of names
+bool parseChoices(const std::string& value, std::initializer_list<const char*> choices, std::string& out) {
+    std::string item;
+    for (const std::string& name : splitList(value)) {
+        if (!parseChoice(name, choices, item)) return false;
+    }
+    out = value;
+    return true;
+}
+
+// "WxH" or "WxH:square_size"
+bool parseBoardSpec(const std::string& item, double default_square, BoardSpec& spec) {
+    const size_t x = item.find('x');
+    const size_t colon = item.find(':');
+    if (x == std::string::npos) return false;
+    const std::string height = item.substr(x + 1, colon == std::string::npos ? std::string::npos : colon - x - 1);
+    spec.square_size = default_square;
+    if (!parseInt(item.substr(0, x), spec.size.width) || !parseInt(height, spec.size.height)) return false;
+    if (colon != std::string::npos && !parseDouble(item.substr(colon + 1), spec.square_size)) return false;
+    // findChessboardCorners needs at least 2 x 3 inner corners
+    return std::min(spec.size.width, spec.size.height) >= 2 && std::max(spec.size.width, spec.size.height) >= 3 &&
+           spec.square_size > 0;
+}
+
+bool parseBoardSpecs(const std::string& value, double default_square, std::vector<BoardSpec>& specs) {
+    specs.clear();
+    for (const std::string& item : splitList(value)) {
+        BoardSpec spec;
+        if (!parseBoardSpec(item, default_square, spec)) return false;
+        specs.push_back(spec);
+    }
+    return true;
+}
+
+// Accept a comma separated list of board specs
+bool parseBoards(const std::string& value, std::string& out) {
+    std::vector<BoardSpec> specs;
+    if (!parseBoardSpecs(value, 1.0, specs)) return false;
+    out = value;
+    return true;
+}
+
+}  // namespace
+
+int Config::chessboardFlags() const {
+    int flags = 0;
+    if (adaptive_thresh) flags |= cv::CALIB_CB_ADAPTIVE_THRESH;
+    if (normalize_image) flags |= cv::CALIB_CB_NORMALIZE_IMAGE;
+    if (fast_check) flags |= cv::CALIB_CB_FAST_CHECK;
+    return flags;
+}
+
+std::vector<BoardSpec> Config::boardSpecs() const {
+    std::vector<BoardSpec> specs;
+    if (!parseBoardSpecs(boards, square_size, specs) || specs.empty()) {
+        specs.assign(1, BoardSpec{boardSize(), square_size});
+    }
+    return specs;
+}
+
+std::vector<std::string> Config::rigCameraDirs() const {
+    return splitList(rig_cameras);
+}
+
+std::vector<std::string> Config::overlayLayers() const {
+    return splitList(overlay_layers);
+}
+
+bool applySetting(Config& cfg, const std::string& key, const std::string& value) {
+    bool ok = true;
+    if (key == "board_width") ok = parseInt(value, cfg.board_width) && cfg.board_width > 1;
+    else if (key == "board_height") ok = parseInt(value, cfg.board_height) && cfg.board_height > 1;
+    else if (key == "square_size") ok = parseDouble(value, cfg.square_size) && cfg.square_size > 0;
+    else if (key == "boards") ok = parseBoards(value, cfg.boards);
+    else if (key == "boards_search_width") ok = parseInt(value, cfg.boards_search_width) && cfg.boards_search_width >= 0;
+    else if (key == "boards_track_margin") ok = parseDouble(value, cfg.boards_track_margin) && cfg.boards_track_margin >= 0;
+    else if (key == "adaptive_thresh") ok = parseBool(value, cfg.adaptive_thresh);
+    else if (key == "normalize_image") ok = parseBool(value, cfg.normalize_image);
+    else if (key == "fast_check") ok = parseBool(value, cfg.fast_check);
+    else if (key == "gate") ok = parseBool(value, cfg.gate);
+    else if (key == "gate_width") ok = parseInt(value, cfg.gate_width) && cfg.gate_width >= 32;
+    else if (key == "gate_force_every") ok = parseInt(value, cfg.gate_force_every) && cfg.gate_force_every >= 0;
+    else if (key == "subpix_window") ok = parseInt(value, cfg.subpix_window) && cfg.subpix_window > 0;
+    else if (key == "subpix_max_iter") ok = parseInt(value, cfg.subpix_max_iter) && cfg.subpix_max_iter > 0;
+    else if (key == "subpix_epsilon") ok = parseDouble(value, cfg.subpix_epsilon) && cfg.subpix_epsilon > 0;
+    else if (key == "subpix_batched") ok = parseBool(value, cfg.subpix_batched);
+    else if (key == "subpix_warm_start") ok = parseBool(value, cfg.subpix_warm_start);
+    else if (key == "subpix_parallel_corners") ok = parseInt(value, cfg.subpix_parallel_corners) && cfg.subpix_parallel_corners >= 0;
+    else if (key == "threads") ok = parseInt(value, cfg.threads);
+    else if (key == "camera_index") ok = parseInt(value, cfg.camera_index);
+    else if (key == "image_dir") cfg.image_dir = value;
+    else if (key == "calibration_file") cfg.calibration_file = value;
+    else if (key == "detection_cache") cfg.detection_cache = value;
+    else if (key == "detection_cache_gray") ok = parseBool(value, cfg.detection_cache_gray);
+    else if (key == "input") cfg.input = value;
+    else if (key == "start_frame") ok = parseInt(value, cfg.start_frame) && cfg.start_frame >= 0;
+    else if (key == "end_frame") ok = parseInt(value, cfg.end_frame) && cfg.end_frame >= -1;
+    else if (key == "frame_step") ok = parseInt(value, cfg.frame_step) && cfg.frame_step > 0;
+    else if (key == "prefetch") ok = parseInt(value, cfg.prefetch) && cfg.prefetch > 0;
+    else if (key == "decode_threads") ok = parseInt(value, cfg.decode_threads) && cfg.decode_threads > 0;
+    else if (key == "input_fps") ok = parseDouble(value, cfg.input_fps) && cfg.input_fps > 0;
+    else if (key == "hw_decode") ok = parseBool(value, cfg.hw_decode);
+    else if (key == "display") ok = parseBool(value, cfg.display);
+    else if (key == "distortion_model") ok = parseChoice(value, {"none", "radial2", "radtan5", "rational8", "fisheye"}, cfg.distortion_model);
+    else if (key == "refine") ok = parseBool(value, cfg.refine);
+    else if (key == "refine_max_iter") ok = parseInt(value, cfg.refine_max_iter) && cfg.refine_max_iter > 0;
+    else if (key == "refine_loss") ok = parseChoice(value, {"none", "huber", "cauchy"}, cfg.refine_loss);
+    else if (key == "refine_loss_scale") ok = parseDouble(value, cfg.refine_loss_scale) && cfg.refine_loss_scale > 0;
+    else if (key == "refine_reject_factor") ok = parseDouble(value, cfg.refine_reject_factor) && cfg.refine_reject_factor >= 0;
+    else if (key == "report_file") cfg.report_file = value;
+    else if (key == "report_grid") ok = parseInt(value, cfg.report_grid) && cfg.report_grid > 0;
+    else if (key == "report_max_rms") ok = parseDouble(value, cfg.report_max_rms) && cfg.report_max_rms >= 0;
+    else if (key == "report_max_view_rms") ok = parseDouble(value, cfg.report_max_view_rms) && cfg.report_max_view_rms >= 0;
+    else if (key == "report_min_coverage") ok = parseDouble(value, cfg.report_min_coverage) && cfg.report_min_coverage >= 0 && cfg.report_min_coverage <= 1;
+    else if (key == "report_enforce") ok = parseBool(value, cfg.report_enforce);
+    else if (key == "capture_auto") ok = parseBool(value, cfg.capture_auto);
+    else if (key == "capture_dir") cfg.capture_dir = value;
+    else if (key == "capture_coverage") ok = parseDouble(value, cfg.capture_coverage) && cfg.capture_coverage >= 0 && cfg.capture_coverage <= 1;
+    else if (key == "capture_min_views") ok = parseInt(value, cfg.capture_min_views) && cfg.capture_min_views > 0;
+    else if (key == "capture_max_views") ok = parseInt(value, cfg.capture_max_views) && cfg.capture_max_views > 0;
+    else if (key == "capture_min_novelty") ok = parseDouble(value, cfg.capture_min_novelty) && cfg.capture_min_novelty >= 0;
+    else if (key == "capture_min_new_cells") ok = parseInt(value, cfg.capture_min_new_cells) && cfg.capture_min_new_cells >= 0;
+    else if (key == "capture_min_sharpness") ok = parseDouble(value, cfg.capture_min_sharpness) && cfg.capture_min_sharpness >= 0;
+    else if (key == "capture_max_motion") ok = parseDouble(value, cfg.capture_max_motion) && cfg.capture_max_motion >= 0;
+    else if (key == "rig_cameras") cfg.rig_cameras = value;
+    else if (key == "rig_file") cfg.rig_file = value;
+    else if (key == "rig_rectify") ok = parseBool(value, cfg.rig_rectify);
+    else if (key == "pose_solver") ok = parseChoice(value, {"iterative", "ippe", "sqpnp"}, cfg.pose_solver);
+    else if (key == "pose_ambiguity_ratio") ok = parseDouble(value, cfg.pose_ambiguity_ratio) && cfg.pose_ambiguity_ratio >= 1;
+    else if (key == "pose_refine") ok = parseBool(value, cfg.pose_refine);
+    else if (key == "quality_adaptive") ok = parseBool(value, cfg.quality_adaptive);
+    else if (key == "quality_budget_ms") ok = parseDouble(value, cfg.quality_budget_ms) && cfg.quality_budget_ms > 0;
+    else if (key == "quality_raise_below") ok = parseDouble(value, cfg.quality_raise_below) && cfg.quality_raise_below > 0 && cfg.quality_raise_below < 1;
+    else if (key == "quality_hold_frames") ok = parseInt(value, cfg.quality_hold_frames) && cfg.quality_hold_frames > 0;
+    else if (key == "trajectory_file") cfg.trajectory_file = value;
+    else if (key == "trajectory_chunk_rows") ok = parseInt(value, cfg.trajectory_chunk_rows) && cfg.trajectory_chunk_rows > 0;
+    else if (key == "trajectory_float32") ok = parseBool(value, cfg.trajectory_float32);
+    else if (key == "trajectory_delta") ok = parseBool(value, cfg.trajectory_delta);
+    else if (key == "pose_channel") cfg.pose_channel = value;
+    else if (key == "pose_channel_capacity") ok = parseInt(value, cfg.pose_channel_capacity) && cfg.pose_channel_capacity > 0;
+    else if (key == "overlay_layers") ok = parseChoices(value, {"corners", "axes", "projected", "objects"}, cfg.overlay_layers);
+    else if (key == "overlay_opacity") ok = parseDouble(value, cfg.overlay_opacity) && cfg.overlay_opacity >= 0 && cfg.overlay_opacity <= 1;
+    else if (key == "render_mode") ok = parseChoice(value, {"wireframe", "flat", "gouraud"}, cfg.render_mode);
+    else if (key == "frame_channel") cfg.frame_channel = value;
+    else if (key == "frame_channel_slots") ok = parseInt(value, cfg.frame_channel_slots) && cfg.frame_channel_slots > 0;
+    else if (key == "record_output") cfg.record_output = value;
+    else {
+        std::cerr << "Error: Unknown config key '" << key << "'" << std::endl;
+        return false;
+    }
+    if (!ok) {
+        std::cerr << "Error: Invalid value '" << value << "' for config key '" << key << "'" << std::endl;
+    }
+    return ok;
+}
+
+bool loadConfigFile(const std::string& path, Config& cfg) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open config file " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "Error: " << path << ":" << line_number << ": expected 'key = value'" << std::endl;
+            return false;
+        }
+        if (!applySetting(cfg, trim(line.substr(0, eq)), trim(line.substr(eq + 1)))) {
+            std::cerr << "  at " << path << ":" << line_number << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadConfig(int argc, char** argv, Config& cfg) {
+    std::string config_path = "calib.cfg";
+    bool explicit_path = false;
+    std::vector<std::pair<std::string, std::string>> overrides;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            std::cerr << "Error: Unexpected argument '" << arg << "'" << std::endl;
+            return false;
+        }
+        std::string key = arg.substr(2), value;
+        size_t eq = key.find('=');
+        if (eq != std::string::npos) {
+            value = key.substr(eq + 1);
+            key = key.substr(0, eq);
+        } else if (i + 1 < argc) {
+            value = argv[++i];
+        } else {
+            std::cerr << "Error: Missing value for --" << key << std::endl;
+            return false;
+        }
+        std::replace(key.begin(), key.end(), '-', '_');
+        if (key == "config") {
+            config_path = value;
+            explicit_path = true;
+        } else {
+            overrides.emplace_back(key, value);
+        }
+    }
+
+    if (explicit_path || std::ifstream(config_path).good()) {
+        if (!loadConfigFile(config_path, cfg)) return false;
+    }
+    for (const auto& kv : overrides) {
+        if (!applySetting(cfg, kv.first, kv.second)) return false;
+    }
+
+    if (cfg.threads >= 0) {
+        cv::setNumThreads(cfg.threads);
+    }
+    return true;
+}
+
+}  // namespace calib
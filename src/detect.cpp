@@ -0,0 +1,111 @@
+#include "calib/detect.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+
+namespace calib {
+
+void toGray(const cv::Mat& frame, cv::Mat& gray) {
+    if (frame.channels() == 1) {
+        gray = frame;
+    } else {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    }
+}
+
+bool findBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners) {
+    return cv::findChessboardCorners(gray, cfg.boardSize(), corners, cfg.chessboardFlags());
+}
+
+void refineCorners(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners) {
+    if (cfg.subpix_batched) {
+        SubpixRefiner refiner(subpixOptions(cfg));
+        refiner.refine(gray, corners);
+    } else {
+        cv::cornerSubPix(gray, corners, cfg.subpixWinSize(), cv::Size(-1, -1), cfg.subpixCriteria());
+    }
+}
+
+bool detectBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners) {
+    if (!findBoard(gray, cfg, corners)) {
+        return false;
+    }
+    refineCorners(gray, cfg, corners);
+    return true;
+}
+
+BoardGate::BoardGate(const Config& cfg)
+    : enabled_(cfg.gate), board_size_(cfg.boardSize()), width_(cfg.gate_width), force_every_(cfg.gate_force_every) {}
+
+bool BoardGate::admit(const cv::Mat& gray) {
+    stats_.frames++;
+    forced_ = false;
+    if (!enabled_ || last_found_) {
+        return true;
+    }
+
+    const cv::Mat* probe = &gray;
+    if (gray.cols > width_) {
+        double scale = static_cast<double>(width_) / gray.cols;
+        cv::resize(gray, small_, cv::Size(), scale, scale, cv::INTER_AREA);
+        probe = &small_;
+    }
+    if (cv::checkChessboard(*probe, board_size_)) {
+        since_forced_ = 0;
+        return true;
+    }
+
+    if (force_every_ > 0 && ++since_forced_ >= force_every_) {
+        since_forced_ = 0;
+        forced_ = true;
+        stats_.forced++;
+        return true;
+    }
+    stats_.gated++;
+    return false;
+}
+
+void BoardGate::report(bool found) {
+    if (forced_ && found) {
+        stats_.missed++;
+    }
+    last_found_ = found;
+}
+
+bool detectBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners, BoardGate& gate) {
+    if (!gate.admit(gray)) {
+        corners.clear();
+        return false;
+    }
+    bool found = detectBoard(gray, cfg, corners);
+    gate.report(found);
+    return found;
+}
+
+bool detectBoard(const cv::Mat& gray, const Config& cfg, std::vector<cv::Point2f>& corners, BoardGate& gate,
+                 SubpixRefiner& refiner) {
+    if (!gate.admit(gray)) {
+        corners.clear();
+        refiner.reset();
+        return false;
+    }
+    bool found = findBoard(gray, cfg, corners);
+    if (!found) {
+        refiner.reset();
+    } else if (cfg.subpix_batched) {
+        refiner.refine(gray, corners);
+    } else {
+        refineCorners(gray, cfg, corners);
+    }
+    gate.report(found);
+    return found;
+}
+
+void printGateStats(std::ostream& out, const GateStats& stats) {
+    double skipped = stats.frames > 0 ? 100.0 * stats.gated / stats.frames : 0.0;
+    out << "Board gate: skipped " << stats.gated << " of " << stats.frames << " frames (" << skipped << "%), "
+        << stats.forced << " forced detections found " << stats.missed << " missed boards\n";
+}
+
+}  // namespace calib
@@ -0,0 +1,321 @@
+#include "calib/detection_cache.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace calib {
+
+namespace {
+
+constexpr char kFileMagic[8] = {'C', 'A', 'L', 'D', 'E', 'T', 'C', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr const char* kCacheFile = "detections.bin";
+
+// Little-endian byte buffer helpers, as in the trajectory format
+template <typename T>
+void put(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool get(const char*& p, const char* end, T& value) {
+    if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) return false;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool readFile(const std::string& path, std::vector<uchar>& bytes) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+    bytes.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size())));
+}
+
+uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Final avalanche of MurmurHash3
+uint64_t fmix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+}  // namespace
+
+uint64_t contentHash(const void* data, size_t size) {
+    // Eight bytes per step with MurmurHash3's mixing: fast enough that
+    // hashing a file costs little next to reading it
+    constexpr uint64_t c1 = 0x87c37b91114253d5ull, c2 = 0x4cf5ad432745937full;
+    const uchar* p = static_cast<const uchar*>(data);
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (size * c1);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t k;
+        std::memcpy(&k, p + i, sizeof(k));
+        h ^= rotl(k * c1, 31) * c2;
+        h = rotl(h, 27) * 5 + 0x52dce729;
+    }
+    uint64_t tail = 0;
+    for (size_t j = 0; i + j < size; ++j) tail |= static_cast<uint64_t>(p[i + j]) << (8 * j);
+    h ^= rotl(tail * c1, 31) * c2;
+    return fmix(h ^ size);
+}
+
+uint64_t detectionParamsHash(const Config& cfg) {
+    std::ostringstream key;
+    key.precision(17);
+    key << "board " << cfg.board_width << "x" << cfg.board_height << " flags " << cfg.chessboardFlags() << " subpix "
+        << cfg.subpix_window << " " << cfg.subpix_max_iter << " " << cfg.subpix_epsilon << " " << cfg.subpix_batched;
+    const std::string s = key.str();
+    return contentHash(s.data(), s.size());
+}
+
+DetectionCache::~DetectionCache() {
+    flush();
+}
+
+bool DetectionCache::open(const std::string& directory, const Config& cfg) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "Error: Could not create " << directory << ": " << ec.message() << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    params_ = detectionParamsHash(cfg);
+    store_gray_ = cfg.detection_cache_gray;
+    files_.clear();
+    records_.clear();
+    stats_ = CacheStats();
+    dirty_ = false;
+    return load();
+}
+
+bool DetectionCache::load() {
+    const std::string path = directory_ + "/" + kCacheFile;
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return true;
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const char* p = data.data();
+    const char* end = p + data.size();
+
+    uint32_t version = 0, file_count = 0, record_count = 0;
+    bool ok = data.size() >= sizeof(kFileMagic) && std::memcmp(p, kFileMagic, sizeof(kFileMagic)) == 0;
+    if (ok) p += sizeof(kFileMagic);
+    ok = ok && get(p, end, version) && version == kVersion && get(p, end, file_count);
+    for (uint32_t i = 0; ok && i < file_count; ++i) {
+        uint32_t length = 0;
+        FileEntry entry;
+        ok = get(p, end, length) && end - p >= static_cast<std::ptrdiff_t>(length);
+        if (!ok) break;
+        std::string name(p, length);
+        p += length;
+        ok = get(p, end, entry.size) && get(p, end, entry.mtime) && get(p, end, entry.hash);
+        if (ok) files_[name] = entry;
+    }
+    ok = ok && get(p, end, record_count);
+    for (uint32_t i = 0; ok && i < record_count; ++i) {
+        uint64_t hash = 0, params = 0;
+        uint32_t n = 0;
+        Record record;
+        ok = get(p, end, hash) && get(p, end, params) && get(p, end, record.image_size.width) &&
+             get(p, end, record.image_size.height) && get(p, end, n) &&
+             end - p >= static_cast<std::ptrdiff_t>(n * 2 * sizeof(float));
+        if (!ok) break;
+        record.corners.resize(n);
+        std::memcpy(record.corners.data(), p, n * 2 * sizeof(float));
+        p += n * 2 * sizeof(float);
+        records_[hash][params] = std::move(record);
+    }
+    if (!ok) {
+        std::cerr << "Error: Ignoring unreadable detection cache " << path << std::endl;
+        files_.clear();
+        records_.clear();
+    }
+    return true;
+}
+
+bool DetectionCache::lookupFile(const std::string& path, uint64_t size, int64_t mtime, uint64_t& hash) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    if (it == files_.end() || it->second.size != size || it->second.mtime != mtime) return false;
+    hash = it->second.hash;
+    return true;
+}
+
+std::string DetectionCache::grayPath(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.gray", static_cast<unsigned long long>(hash));
+    return directory_ + "/" + name;
+}
+
+bool DetectionCache::detect(const std::string& path, const Config& cfg, Detection& detection, BoardGate* gate,
+                            cv::Mat* image) {
+    std::vector<uchar> bytes;
+    uint64_t hash = 0;
+    if (isOpen()) {
+        // Known by size and time, or else by content
+        std::error_code ec;
+        const uint64_t size = std::filesystem::file_size(path, ec);
+        const int64_t mtime = ec ? 0 : std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+        if (ec) return false;
+        if (!lookupFile(path, size, mtime, hash)) {
+            if (!readFile(path, bytes)) return false;
+            hash = contentHash(bytes.data(), bytes.size());
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_[path] = FileEntry{size, mtime, hash};
+            stats_.hashed++;
+            dirty_ = true;
+        }
+
+        bool hit = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto by_content = records_.find(hash);
+            if (by_content != records_.end()) {
+                auto record = by_content->second.find(params_);
+                if (record != by_content->second.end()) {
+                    detection.image_size = record->second.image_size;
+                    detection.corners = record->second.corners;
+                    stats_.hits++;
+                    hit = true;
+                }
+            }
+        }
+        if (hit) {
+            if (image) *image = bytes.empty() ? cv::imread(path) : cv::imdecode(bytes, cv::IMREAD_COLOR);
+            return true;
+        }
+    }
+
+    // Decode (from the bytes already read when hashing) and detect
+    cv::Mat frame;
+    if (!isOpen()) {
+        frame = cv::imread(path);
+    } else if (!bytes.empty() || readFile(path, bytes)) {
+        frame = cv::imdecode(bytes, cv::IMREAD_COLOR);
+    }
+    if (frame.empty()) return false;
+    cv::Mat gray;
+    toGray(frame, gray);
+    detection.image_size = gray.size();
+    const int64_t gated_before = gate ? gate->stats().gated : 0;
+    const bool found =
+        gate ? detectBoard(gray, cfg, detection.corners, *gate) : detectBoard(gray, cfg, detection.corners);
+    if (!found) detection.corners.clear();
+    if (image) *image = frame;
+
+    if (isOpen()) {
+        // A gate rejection depends on the gate's state, not only on the image
+        const bool gated = gate && gate->stats().gated > gated_before;
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.misses++;
+        if (!gated) {
+            records_[hash][params_] = Record{detection.image_size, detection.corners};
+            dirty_ = true;
+        }
+    }
+    if (isOpen() && store_gray_) {
+        std::ofstream out(grayPath(hash), std::ios::binary);
+        const int32_t rows = gray.rows, cols = gray.cols;
+        out.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+        out.write(reinterpret_cast<const char*>(&cols), sizeof(cols));
+        for (int y = 0; y < gray.rows; ++y) out.write(gray.ptr<char>(y), gray.cols);
+    }
+    return true;
+}
+
+bool DetectionCache::loadGray(const std::string& path, cv::Mat& gray) {
+    uint64_t hash = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(path);
+        if (!isOpen() || it == files_.end()) return false;
+        hash = it->second.hash;
+    }
+    std::ifstream in(grayPath(hash), std::ios::binary);
+    int32_t rows = 0, cols = 0;
+    if (!in.read(reinterpret_cast<char*>(&rows), sizeof(rows)) || !in.read(reinterpret_cast<char*>(&cols), sizeof(cols)) ||
+        rows <= 0 || cols <= 0) {
+        return false;
+    }
+    gray.create(rows, cols, CV_8U);
+    return static_cast<bool>(in.read(gray.ptr<char>(), static_cast<std::streamsize>(gray.total())));
+}
+
+bool DetectionCache::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!isOpen() || !dirty_) return true;
+
+    std::string data(kFileMagic, sizeof(kFileMagic));
+    put(data, kVersion);
+    put(data, static_cast<uint32_t>(files_.size()));
+    for (const auto& [name, entry] : files_) {
+        put(data, static_cast<uint32_t>(name.size()));
+        data.append(name);
+        put(data, entry.size);
+        put(data, entry.mtime);
+        put(data, entry.hash);
+    }
+    uint32_t record_count = 0;
+    for (const auto& by_content : records_) record_count += static_cast<uint32_t>(by_content.second.size());
+    put(data, record_count);
+    for (const auto& [hash, by_params] : records_) {
+        for (const auto& [params, record] : by_params) {
+            put(data, hash);
+            put(data, params);
+            put(data, static_cast<int32_t>(record.image_size.width));
+            put(data, static_cast<int32_t>(record.image_size.height));
+            put(data, static_cast<uint32_t>(record.corners.size()));
+            data.append(reinterpret_cast<const char*>(record.corners.data()), record.corners.size() * 2 * sizeof(float));
+        }
+    }
+
+    // Write a temporary file and rename it over the old one, so an
+    // interrupted run never leaves a truncated cache
+    const std::string path = directory_ + "/" + kCacheFile;
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            std::cerr << "Error: Could not write " << temporary << std::endl;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::cerr << "Error: Could not write " << path << ": " << ec.message() << std::endl;
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+CacheStats DetectionCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void printCacheStats(std::ostream& out, const CacheStats& stats) {
+    out << "Detection cache: " << stats.hits << " hits, " << stats.misses << " misses (" << stats.hashed
+        << " files rehashed)\n";
+}
+
+}  // namespace calib
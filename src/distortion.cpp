@@ -0,0 +1,151 @@
+#include "calib/distortion.hpp"
+
+#include <algorithm>
+
+namespace calib {
+
+namespace {
+
+// Undistortion iterates the inverse of the lens model until the estimate
+// moves less than this (normalized units, squared) or kMaxIterations is hit
+constexpr double kTolerance = 1e-24;
+constexpr int kMaxIterations = 20;
+
+// The iteration of cv::undistortPoints for the radial-tangential models,
+// with radial(r2) the model's radial factor
+template <typename Radial>
+cv::Point2d undistortRadTan(const double* k, cv::Point2d p, Radial radial) {
+    cv::Point2d u = p;
+    for (int i = 0; i < kMaxIterations; ++i) {
+        const double r2 = u.x * u.x + u.y * u.y, xy = u.x * u.y;
+        const double dx = 2 * k[2] * xy + k[3] * (r2 + 2 * u.x * u.x);
+        const double dy = k[2] * (r2 + 2 * u.y * u.y) + 2 * k[3] * xy;
+        const cv::Point2d next((p.x - dx) / radial(r2), (p.y - dy) / radial(r2));
+        const cv::Point2d step = next - u;
+        u = next;
+        if (step.dot(step) < kTolerance) break;
+    }
+    return u;
+}
+
+}  // namespace
+
+cv::Point2d Lens<DistortionModel::Radial2>::undistort(const double* k, cv::Point2d p) {
+    cv::Point2d u = p;
+    for (int i = 0; i < kMaxIterations; ++i) {
+        const double r2 = u.x * u.x + u.y * u.y;
+        const cv::Point2d next = p * (1.0 / (1 + r2 * (k[0] + r2 * k[1])));
+        const cv::Point2d step = next - u;
+        u = next;
+        if (step.dot(step) < kTolerance) break;
+    }
+    return u;
+}
+
+cv::Point2d Lens<DistortionModel::RadTan5>::undistort(const double* k, cv::Point2d p) {
+    return undistortRadTan(k, p, [k](double r2) { return 1 + r2 * (k[0] + r2 * (k[1] + r2 * k[4])); });
+}
+
+cv::Point2d Lens<DistortionModel::Rational8>::undistort(const double* k, cv::Point2d p) {
+    return undistortRadTan(k, p, [k](double r2) {
+        return (1 + r2 * (k[0] + r2 * (k[1] + r2 * k[4]))) / (1 + r2 * (k[5] + r2 * (k[6] + r2 * k[7])));
+    });
+}
+
+cv::Point2d Lens<DistortionModel::Fisheye>::undistort(const double* k, cv::Point2d p) {
+    const double theta_d = std::sqrt(p.x * p.x + p.y * p.y);
+    if (theta_d < 1e-12) return p;
+    // Newton's method on theta_d = theta (1 + k1 theta^2 + ... + k4 theta^8)
+    double theta = theta_d;
+    for (int i = 0; i < kMaxIterations; ++i) {
+        const double t2 = theta * theta;
+        const double f = theta * (1 + t2 * (k[0] + t2 * (k[1] + t2 * (k[2] + t2 * k[3])))) - theta_d;
+        const double df = 1 + t2 * (3 * k[0] + t2 * (5 * k[1] + t2 * (7 * k[2] + t2 * 9 * k[3])));
+        const double step = f / df;
+        theta -= step;
+        if (step * step < kTolerance) break;
+    }
+    return p * (std::tan(theta) / theta_d);
+}
+
+std::array<double, 8> lensCoefficients(const Intrinsics& intrinsics) {
+    std::array<double, 8> k{};
+    cv::Mat dist;
+    if (!intrinsics.dist_coeffs.empty()) intrinsics.dist_coeffs.convertTo(dist, CV_64F);
+    const int n = std::min(static_cast<int>(dist.total()), static_cast<int>(k.size()));
+    for (int i = 0; i < n; ++i) k[i] = dist.ptr<double>()[i];
+    return k;
+}
+
+cv::Mat pinholeCoefficients(const Intrinsics& intrinsics) {
+    switch (intrinsics.model) {
+        case DistortionModel::None:
+        case DistortionModel::Fisheye:
+            return cv::Mat();
+        case DistortionModel::Radial2: {
+            const std::array<double, 8> k = lensCoefficients(intrinsics);
+            return (cv::Mat_<double>(4, 1) << k[0], k[1], 0, 0);
+        }
+        default:
+            return intrinsics.dist_coeffs;
+    }
+}
+
+cv::Mat pinholeCoefficients(const Camera& camera) {
+    // Radial2 keeps zero p1, p2 in the padded coefficients
+    switch (camera.model) {
+        case DistortionModel::None:
+        case DistortionModel::Fisheye:
+            return cv::Mat();
+        case DistortionModel::Radial2:
+            return cv::Mat(4, 1, CV_64F, const_cast<double*>(camera.k.val));
+        default:
+            return cv::Mat(distortionCoefficients(camera.model), 1, CV_64F, const_cast<double*>(camera.k.val));
+    }
+}
+
+void undistortPoints(const std::vector<cv::Point2f>& pixels, const Intrinsics& intrinsics,
+                     std::vector<cv::Point2f>& normalized) {
+    undistortPoints(pixels, toCamera(intrinsics), normalized);
+}
+
+void undistortPoints(const std::vector<cv::Point2f>& pixels, const Camera& camera,
+                     std::vector<cv::Point2f>& normalized) {
+    const cv::Matx33d K_inv = camera.K.inv();
+    normalized.resize(pixels.size());
+    withLens(camera.model, [&](auto lens) {
+        using L = decltype(lens);
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            const cv::Vec3d d = K_inv * cv::Vec3d(pixels[i].x, pixels[i].y, 1.0);
+            const cv::Point2d u = L::undistort(camera.k.val, cv::Point2d(d[0], d[1]));
+            normalized[i] = cv::Point2f(static_cast<float>(u.x), static_cast<float>(u.y));
+        }
+    });
+}
+
+void undistortMaps(const Intrinsics& intrinsics, cv::Size size, const cv::Mat& new_camera_matrix, cv::Mat& map_x,
+                   cv::Mat& map_y) {
+    const cv::Matx33d K(intrinsics.camera_matrix);
+    const cv::Matx33d P_inv =
+        (new_camera_matrix.empty() ? K : cv::Matx33d(cv::Mat_<double>(new_camera_matrix))).inv();
+    const std::array<double, 8> k = lensCoefficients(intrinsics);
+    map_x.create(size, CV_32F);
+    map_y.create(size, CV_32F);
+    withLens(intrinsics.model, [&](auto lens) {
+        using L = decltype(lens);
+        cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range& rows) {
+            for (int y = rows.start; y < rows.end; ++y) {
+                float* mx = map_x.ptr<float>(y);
+                float* my = map_y.ptr<float>(y);
+                for (int x = 0; x < size.width; ++x) {
+                    const cv::Vec3d n = P_inv * cv::Vec3d(x, y, 1.0);
+                    const cv::Point2d d = L::distort(k.data(), cv::Point2d(n[0] / n[2], n[1] / n[2]));
+                    mx[x] = static_cast<float>(K(0, 0) * d.x + K(0, 1) * d.y + K(0, 2));
+                    my[x] = static_cast<float>(K(1, 1) * d.y + K(1, 2));
+                }
+            }
+        });
+    });
+}
+
+}  // namespace calib
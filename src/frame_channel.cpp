@@ -0,0 +1,245 @@
+#include "calib/frame_channel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#include "shared_memory.hpp"
+
+namespace calib {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x31524d464c4143ULL;  // "CALFMR1"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kAlignment = 64;
+
+constexpr double kSpinSeconds = 50e-6;
+constexpr auto kSleepStep = std::chrono::microseconds(200);
+
+uint64_t toBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+// Slot header, followed by the pixels. version works as in the pose channel:
+// odd while sequence (version - 1) / 2 is being written, even once committed.
+struct alignas(kAlignment) FrameSlot {
+    std::atomic<uint64_t> version{0};
+    std::atomic<int64_t> frame{-1};
+    std::atomic<uint64_t> timestamp{0};     // double bits
+    std::atomic<uint64_t> published_at{0};  // double bits
+    std::atomic<int32_t> rows{0}, cols{0}, type{0};
+};
+
+struct alignas(kAlignment) FrameRing {
+    std::atomic<uint64_t> magic{0};
+    uint32_t version = kVersion;
+    uint32_t slots = 0;
+    uint64_t slot_bytes = 0;  // pixel bytes per slot, a multiple of kAlignment
+    alignas(kAlignment) std::atomic<uint64_t> published{0};
+
+    size_t stride() const { return sizeof(FrameSlot) + slot_bytes; }
+    FrameSlot& slot(uint64_t sequence) {
+        return *reinterpret_cast<FrameSlot*>(reinterpret_cast<char*>(this + 1) + (sequence % slots) * stride());
+    }
+    const FrameSlot& slot(uint64_t sequence) const {
+        return *reinterpret_cast<const FrameSlot*>(reinterpret_cast<const char*>(this + 1) +
+                                                   (sequence % slots) * stride());
+    }
+    static uchar* pixels(const FrameSlot& slot) {
+        return const_cast<uchar*>(reinterpret_cast<const uchar*>(&slot + 1));
+    }
+};
+
+// ---------------------------------------------------------------------------
+// FramePublisher
+// ---------------------------------------------------------------------------
+FramePublisher::~FramePublisher() {
+    close();
+}
+
+bool FramePublisher::open(const std::string& name, uint32_t slots, size_t max_frame_bytes) {
+    close();
+    if (slots == 0 || max_frame_bytes == 0) {
+        std::cerr << "Error: Frame channel needs at least one slot and a non-zero frame size" << std::endl;
+        return false;
+    }
+    const size_t slot_bytes = (max_frame_bytes + kAlignment - 1) / kAlignment * kAlignment;
+    const size_t bytes = sizeof(FrameRing) + slots * (sizeof(FrameSlot) + slot_bytes);
+    void* memory = shm::create(name, bytes, "frame channel");
+    if (!memory) {
+        return false;
+    }
+
+    ring_ = new (memory) FrameRing();
+    ring_->slots = slots;
+    ring_->slot_bytes = slot_bytes;
+    for (uint32_t i = 0; i < slots; ++i) {
+        new (&ring_->slot(i)) FrameSlot();
+    }
+    ring_->magic.store(kMagic, std::memory_order_release);
+
+    name_ = name;
+    bytes_ = bytes;
+    next_ = 0;
+    rejected_ = 0;
+    reserved_ = false;
+    return true;
+}
+
+void FramePublisher::close() {
+    if (!ring_) return;
+    shm::unmap(ring_, bytes_);
+    shm_unlink(name_.c_str());
+    ring_ = nullptr;
+    bytes_ = 0;
+}
+
+cv::Mat FramePublisher::reserve(cv::Size size, int type) {
+    reserved_ = false;
+    if (!ring_) return cv::Mat();
+    if (static_cast<size_t>(size.area()) * CV_ELEM_SIZE(type) > ring_->slot_bytes) {
+        rejected_++;
+        return cv::Mat();
+    }
+    FrameSlot& slot = ring_->slot(next_);
+    slot.version.store(2 * next_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.rows.store(size.height, std::memory_order_relaxed);
+    slot.cols.store(size.width, std::memory_order_relaxed);
+    slot.type.store(type, std::memory_order_relaxed);
+    reserved_ = true;
+    return cv::Mat(size, type, FrameRing::pixels(slot));
+}
+
+void FramePublisher::commit(int64_t frame, double timestamp) {
+    if (!reserved_) return;
+    reserved_ = false;
+    FrameSlot& slot = ring_->slot(next_);
+    slot.frame.store(frame, std::memory_order_relaxed);
+    slot.timestamp.store(toBits(timestamp), std::memory_order_relaxed);
+    slot.published_at.store(toBits(monotonicSeconds()), std::memory_order_relaxed);
+    slot.version.store(2 * next_ + 2, std::memory_order_release);
+    ring_->published.store(++next_, std::memory_order_release);
+}
+
+bool FramePublisher::publish(const cv::Mat& image, int64_t frame, double timestamp) {
+    cv::Mat target = reserve(image.size(), image.type());
+    if (target.empty()) {
+        return false;
+    }
+    image.copyTo(target);
+    commit(frame, timestamp);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// FrameSubscriber
+// ---------------------------------------------------------------------------
+FrameSubscriber::~FrameSubscriber() {
+    close();
+}
+
+bool FrameSubscriber::open(const std::string& name) {
+    close();
+    size_t bytes = 0;
+    const void* memory = shm::open(name, sizeof(FrameRing), bytes, "frame channel");
+    if (!memory) {
+        return false;
+    }
+    const FrameRing* ring = static_cast<const FrameRing*>(memory);
+    if (ring->magic.load(std::memory_order_acquire) != kMagic || ring->version != kVersion ||
+        bytes < sizeof(FrameRing) + ring->slots * ring->stride()) {
+        std::cerr << "Error: " << name << " is not a frame channel" << std::endl;
+        shm::unmap(memory, bytes);
+        return false;
+    }
+    ring_ = ring;
+    bytes_ = bytes;
+    cursor_ = ring_->published.load(std::memory_order_acquire);
+    lost_ = 0;
+    return true;
+}
+
+void FrameSubscriber::close() {
+    if (!ring_) return;
+    shm::unmap(ring_, bytes_);
+    ring_ = nullptr;
+    bytes_ = 0;
+}
+
+bool FrameSubscriber::acquire(uint64_t sequence, SharedFrame& frame) const {
+    const FrameSlot& slot = ring_->slot(sequence);
+    const uint64_t complete = 2 * sequence + 2;
+    if (slot.version.load(std::memory_order_acquire) != complete) {
+        return false;
+    }
+    const int rows = slot.rows.load(std::memory_order_relaxed);
+    const int cols = slot.cols.load(std::memory_order_relaxed);
+    const int type = slot.type.load(std::memory_order_relaxed);
+    frame.frame = slot.frame.load(std::memory_order_relaxed);
+    frame.timestamp = fromBits(slot.timestamp.load(std::memory_order_relaxed));
+    frame.published_at = fromBits(slot.published_at.load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != complete) {
+        return false;
+    }
+    frame.sequence = sequence;
+    frame.image = cv::Mat(rows, cols, type, FrameRing::pixels(slot));
+    return true;
+}
+
+bool FrameSubscriber::valid(const SharedFrame& frame) const {
+    if (!ring_) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return ring_->slot(frame.sequence).version.load(std::memory_order_relaxed) == 2 * frame.sequence + 2;
+}
+
+bool FrameSubscriber::latest(SharedFrame& frame) const {
+    if (!ring_) return false;
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        uint64_t published = ring_->published.load(std::memory_order_acquire);
+        if (published == 0) return false;
+        if (acquire(published - 1, frame)) return true;
+    }
+    return false;
+}
+
+bool FrameSubscriber::next(SharedFrame& frame) {
+    if (!ring_) return false;
+    const uint64_t published = ring_->published.load(std::memory_order_acquire);
+    if (published - cursor_ > ring_->slots) {
+        lost_ += published - cursor_ - ring_->slots;
+        cursor_ = published - ring_->slots;
+    }
+    while (cursor_ < published) {
+        if (acquire(cursor_++, frame)) return true;
+        lost_++;
+    }
+    return false;
+}
+
+bool FrameSubscriber::wait(SharedFrame& frame, double timeout_seconds) {
+    const double start = monotonicSeconds();
+    for (;;) {
+        if (next(frame)) return true;
+        double elapsed = monotonicSeconds() - start;
+        if (elapsed >= timeout_seconds) return false;
+        if (elapsed >= kSpinSeconds) std::this_thread::sleep_for(kSleepStep);
+    }
+}
+
+}  // namespace calib
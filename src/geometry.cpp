@@ -0,0 +1,58 @@
+#include "calib/geometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "calib/distortion.hpp"
+
+namespace calib {
+
+namespace {
+
+cv::Vec3d toVec3d(const cv::Mat& m) {
+    CV_Assert(m.total() * m.channels() == 3);
+    if (m.depth() == CV_64F && m.isContinuous()) return cv::Vec3d(m.ptr<double>());
+    cv::Mat d;
+    m.convertTo(d, CV_64F);
+    return cv::Vec3d(d.ptr<double>());
+}
+
+}  // namespace
+
+cv::Matx33d Pose::rotation() const {
+    // Rodrigues' formula, as cv::Rodrigues but without its Mat temporaries
+    const double theta = cv::norm(rvec);
+    if (theta < 1e-12) return cv::Matx33d::eye();
+    const cv::Vec3d u = rvec * (1.0 / theta);
+    const double c = std::cos(theta), s = std::sin(theta), c1 = 1.0 - c;
+    return cv::Matx33d(c + c1 * u[0] * u[0], c1 * u[0] * u[1] - s * u[2], c1 * u[0] * u[2] + s * u[1],
+                       c1 * u[1] * u[0] + s * u[2], c + c1 * u[1] * u[1], c1 * u[1] * u[2] - s * u[0],
+                       c1 * u[2] * u[0] - s * u[1], c1 * u[2] * u[1] + s * u[0], c + c1 * u[2] * u[2]);
+}
+
+Pose toPose(const cv::Mat& rvec, const cv::Mat& tvec) {
+    Pose pose;
+    pose.rvec = toVec3d(rvec);
+    pose.tvec = toVec3d(tvec);
+    return pose;
+}
+
+Camera toCamera(const Intrinsics& intrinsics) {
+    Camera camera;
+    camera.K = cv::Matx33d(intrinsics.camera_matrix);
+    const std::array<double, 8> k = lensCoefficients(intrinsics);
+    std::copy(k.begin(), k.end(), camera.k.val);
+    camera.model = intrinsics.model;
+    return camera;
+}
+
+Intrinsics toIntrinsics(const Camera& camera) {
+    Intrinsics intrinsics;
+    intrinsics.camera_matrix = cv::Mat(camera.K, true);
+    const int n = distortionCoefficients(camera.model);
+    if (n > 0) intrinsics.dist_coeffs = cv::Mat(n, 1, CV_64F, const_cast<double*>(camera.k.val)).clone();
+    intrinsics.model = camera.model;
+    return intrinsics;
+}
+
+}  // namespace calib
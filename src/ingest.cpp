@@ -0,0 +1,257 @@
+#include "calib/ingest.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <regex>
+#include <utility>
+
+#include "calib/board.hpp"
+
+namespace calib {
+
+FrameSource::~FrameSource() {
+    close();
+}
+
+bool FrameSource::open(const Config& cfg) {
+    close();
+    stop_ = false;
+    next_read_ = next_claim_ = 0;
+    total_ = -1;
+    dropped_ = 0;
+
+    if (cfg.input.empty()) {
+        kind_ = Kind::Camera;
+        slots_.assign(1, Slot());
+        start_ = 0;
+        end_ = -1;
+        step_ = 1;
+        if (!cap_.open(cfg.camera_index)) {
+            return false;
+        }
+        double fps = cap_.get(cv::CAP_PROP_FPS);
+        fps_ = fps > 0 ? fps : cfg.input_fps;
+        workers_.emplace_back(&FrameSource::captureLoop, this);
+        return true;
+    }
+
+    slots_.assign(static_cast<size_t>(std::max(1, cfg.prefetch)), Slot());
+    start_ = std::max(0, cfg.start_frame);
+    end_ = cfg.end_frame;
+    step_ = std::max(1, cfg.frame_step);
+
+    if (std::filesystem::is_directory(cfg.input) || cfg.input.find('%') != std::string::npos) {
+        kind_ = Kind::Sequence;
+        if (!openSequence(cfg)) {
+            return false;
+        }
+        int threads = std::max(1, cfg.decode_threads);
+        for (int i = 0; i < threads; ++i) {
+            workers_.emplace_back(&FrameSource::sequenceLoop, this);
+        }
+        return true;
+    }
+
+    kind_ = Kind::Video;
+    if (!openVideo(cfg)) {
+        return false;
+    }
+    workers_.emplace_back(&FrameSource::captureLoop, this);
+    return true;
+}
+
+bool FrameSource::openSequence(const Config& cfg) {
+    namespace fs = std::filesystem;
+    files_.clear();
+    if (fs::is_directory(cfg.input)) {
+        files_ = listImages(cfg.input);
+    } else {
+        // Only a single integer conversion is allowed in the pattern
+        static const std::regex pattern_format("^[^%]*%0?[0-9]*d[^%]*$");
+        if (!std::regex_match(cfg.input, pattern_format)) {
+            std::cerr << "Error: Image sequence pattern must contain one %d conversion: " << cfg.input << std::endl;
+            return false;
+        }
+        auto name = [&](int i) {
+            char buf[4096];
+            std::snprintf(buf, sizeof(buf), cfg.input.c_str(), i);
+            return std::string(buf);
+        };
+        // Sequences are numbered from 0 or 1
+        int first = fs::exists(name(0)) ? 0 : 1;
+        for (int i = first; fs::exists(name(i)); ++i) {
+            files_.push_back(name(i));
+        }
+    }
+    if (files_.empty()) {
+        std::cerr << "Error: No images found for " << cfg.input << std::endl;
+        return false;
+    }
+
+    int64_t end = end_ < 0 ? static_cast<int64_t>(files_.size()) : std::min<int64_t>(end_, files_.size());
+    total_ = end > start_ ? (end - start_ + step_ - 1) / step_ : 0;
+    fps_ = cfg.input_fps;
+    return true;
+}
+
+bool FrameSource::openVideo(const Config& cfg) {
+    std::vector<int> params = {
+        cv::CAP_PROP_HW_ACCELERATION, cfg.hw_decode ? cv::VIDEO_ACCELERATION_ANY : cv::VIDEO_ACCELERATION_NONE,
+    };
+    if (!cap_.open(cfg.input, cv::CAP_ANY, params)) {
+        std::cerr << "Error: Could not open video " << cfg.input << std::endl;
+        return false;
+    }
+    double fps = cap_.get(cv::CAP_PROP_FPS);
+    fps_ = fps > 0 ? fps : cfg.input_fps;
+
+    // Seek to the first frame of the range. Backends that cannot seek are
+    // advanced by grabbing, which still avoids the retrieve/convert step.
+    if (start_ > 0 && !cap_.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(start_))) {
+        for (int64_t i = 0; i < start_; ++i) {
+            if (!cap_.grab()) {
+                std::cerr << "Error: " << cfg.input << " has fewer than " << start_ << " frames" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void FrameSource::store(int64_t seq, Frame frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t capacity = static_cast<int64_t>(slots_.size());
+    if (kind_ == Kind::Camera && seq >= next_read_ + capacity) {
+        // The consumer is behind a live camera: drop the oldest frames
+        int64_t oldest_kept = seq - capacity + 1;
+        dropped_ += oldest_kept - next_read_;
+        next_read_ = oldest_kept;
+    }
+    Slot& slot = slots_[static_cast<size_t>(seq % capacity)];
+    slot.frame = std::move(frame);
+    slot.seq = seq;
+    produced_.notify_all();
+}
+
+void FrameSource::captureLoop() {
+    const bool live = kind_ == Kind::Camera;
+    const int64_t capacity = static_cast<int64_t>(slots_.size());
+    const auto started = std::chrono::steady_clock::now();
+    int64_t index = start_;
+    int64_t seq = 0;
+
+    while (end_ < 0 || index < end_) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!live) {
+                consumed_.wait(lock, [&] { return stop_ || seq < next_read_ + capacity; });
+            }
+            if (stop_) break;
+        }
+
+        Frame frame;
+        if (!cap_.grab() || !cap_.retrieve(frame.image) || frame.image.empty()) {
+            break;
+        }
+        frame.index = index;
+        if (live) {
+            frame.timestamp = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        } else {
+            double msec = cap_.get(cv::CAP_PROP_POS_MSEC);
+            frame.timestamp = msec > 0 ? msec / 1000.0 : index / fps_;
+        }
+        store(seq++, std::move(frame));
+
+        // Frames between samples are grabbed but never retrieved
+        bool eof = false;
+        for (int64_t k = 1; k < step_ && (end_ < 0 || index + k < end_); ++k) {
+            if (!cap_.grab()) {
+                eof = true;
+                break;
+            }
+        }
+        index += step_;
+        if (eof) break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    total_ = seq;
+    produced_.notify_all();
+}
+
+void FrameSource::sequenceLoop() {
+    const int64_t capacity = static_cast<int64_t>(slots_.size());
+    while (true) {
+        int64_t seq;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (stop_ || next_claim_ >= total_) return;
+            seq = next_claim_++;
+            // Stay within the prefetch window so the slot for seq is free
+            consumed_.wait(lock, [&] { return stop_ || seq < next_read_ + capacity; });
+            if (stop_) return;
+        }
+
+        Frame frame;
+        frame.index = start_ + seq * step_;
+        frame.timestamp = frame.index / fps_;
+        const std::string& path = files_[static_cast<size_t>(frame.index)];
+        frame.image = cv::imread(path);
+        if (frame.image.empty()) {
+            std::cerr << "Error: Could not load image at " << path << std::endl;
+        }
+        store(seq, std::move(frame));
+    }
+}
+
+bool FrameSource::read(Frame& frame) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (slots_.empty()) return false;
+    const int64_t capacity = static_cast<int64_t>(slots_.size());
+    auto slotFor = [&](int64_t seq) -> Slot& { return slots_[static_cast<size_t>(seq % capacity)]; };
+
+    while (true) {
+        produced_.wait(lock, [&] {
+            return stop_ || slotFor(next_read_).seq == next_read_ || (total_ >= 0 && next_read_ >= total_);
+        });
+        Slot& slot = slotFor(next_read_);
+        if (slot.seq != next_read_) {
+            return false;
+        }
+        frame = std::move(slot.frame);
+        slot.seq = -1;
+        next_read_++;
+        consumed_.notify_all();
+        // Unreadable images were reported by the decoder; move on to the next one
+        if (!frame.image.empty()) {
+            return true;
+        }
+    }
+}
+
+void FrameSource::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    produced_.notify_all();
+    consumed_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    cap_.release();
+    files_.clear();
+    slots_.clear();
+}
+
+int64_t FrameSource::droppedFrames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+}  // namespace calib
@@ -0,0 +1,170 @@
+#include "calib/io.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace calib {
+
+namespace {
+
+// Append every number on a line, ignoring the brackets and separators of
+// OpenCV's matrix print format
+void parseNumbers(std::string line, std::vector<double>& values) {
+    std::replace_if(line.begin(), line.end(), [](char c) { return c == '[' || c == ']' || c == ',' || c == ';'; }, ' ');
+    std::istringstream in(line);
+    double value;
+    while (in >> value) {
+        values.push_back(value);
+    }
+}
+
+}  // namespace
+
+bool loadCalibration(const std::string& path, Intrinsics& intrinsics) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<double> camera_values, dist_values, ignored;
+    std::vector<double>* section = &ignored;
+    std::string model_name;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.find("Distortion model:") != std::string::npos) {
+            std::istringstream in(line.substr(line.find(':') + 1));
+            in >> model_name;
+            section = &ignored;
+        } else if (line.find("Camera matrix:") != std::string::npos) {
+            section = &camera_values;
+        } else if (line.find("Distortion coefficients:") != std::string::npos) {
+            section = &dist_values;
+        } else if (line.find(':') != std::string::npos) {
+            section = &ignored;
+        } else {
+            parseNumbers(line, *section);
+        }
+    }
+
+    if (camera_values.size() != 9) {
+        std::cerr << "Error: " << path << " does not contain a 3x3 camera matrix" << std::endl;
+        return false;
+    }
+
+    // Files without a model line predate them: infer it from the coefficients
+    DistortionModel model = DistortionModel::RadTan5;
+    if (!model_name.empty()) {
+        if (!parseDistortionModel(model_name, model)) {
+            std::cerr << "Error: " << path << " has unknown distortion model " << model_name << std::endl;
+            return false;
+        }
+    } else if (dist_values.empty()) {
+        model = DistortionModel::None;
+    } else if (dist_values.size() == 2) {
+        model = DistortionModel::Radial2;
+    } else if (dist_values.size() == 8) {
+        model = DistortionModel::Rational8;
+    } else if (dist_values.size() == 4) {
+        dist_values.push_back(0.0);  // k1, k2, p1, p2 without k3
+    }
+    if (static_cast<int>(dist_values.size()) != distortionCoefficients(model)) {
+        std::cerr << "Error: " << path << " has " << dist_values.size() << " distortion coefficients, the "
+                  << distortionModelName(model) << " model has " << distortionCoefficients(model) << std::endl;
+        return false;
+    }
+    intrinsics.camera_matrix = cv::Mat(camera_values, true).reshape(1, 3);
+    intrinsics.dist_coeffs = dist_values.empty() ? cv::Mat() : cv::Mat(dist_values, true);
+    intrinsics.model = model;
+    return true;
+}
+
+bool saveCalibration(const std::string& path, const Intrinsics& intrinsics, double reprojection_error) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    file << "Distortion model: " << distortionModelName(intrinsics.model) << "\n";
+    file << "Camera matrix:\n" << intrinsics.camera_matrix << "\n";
+    file << "Distortion coefficients:\n" << intrinsics.dist_coeffs << "\n";
+    file << "Reprojection error:\n" << reprojection_error << "\n";
+    return true;
+}
+
+bool saveViewPoses(const std::string& path, const std::vector<cv::Mat>& rvecs, const std::vector<cv::Mat>& tvecs) {
+    std::ofstream rt_file(path);
+    if (!rt_file.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < rvecs.size(); ++i) {
+        rt_file << "Image " << i + 1 << ":\n";
+        rt_file << "Rotation vector:\n" << rvecs[i] << "\n";
+        rt_file << "Translation vector:\n" << tvecs[i] << "\n";
+    }
+    return true;
+}
+
+void writePose(std::ostream& out, const cv::Mat& rvec, const cv::Mat& tvec) {
+    out << "Rotation vector: " << rvec.t() << "\n";
+    out << "Translation vector: " << tvec.t() << "\n";
+}
+
+void writePose(std::ostream& out, const Pose& pose) {
+    out << "Rotation vector: " << pose.rvec.t() << "\n";
+    out << "Translation vector: " << pose.tvec.t() << "\n";
+}
+
+bool loadPoseLog(const std::string& path, std::vector<int64_t>& frames, std::vector<cv::Vec3d>& rvecs,
+                 std::vector<cv::Vec3d>& tvecs) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+
+    frames.clear();
+    rvecs.clear();
+    tvecs.clear();
+    std::vector<double> rotation, translation, ignored;
+    std::vector<double>* section = &ignored;
+    int64_t image_number = -1;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            std::string label = line.substr(0, colon);
+            if (label.find("Rotation vector") != std::string::npos) {
+                section = &rotation;
+                rotation.clear();
+            } else if (label.find("Translation vector") != std::string::npos) {
+                section = &translation;
+                translation.clear();
+            } else {
+                section = &ignored;
+                if (label.rfind("Image ", 0) == 0) {
+                    image_number = std::atoll(label.c_str() + 6);
+                }
+            }
+            line = line.substr(colon + 1);
+        }
+        parseNumbers(line, *section);
+
+        if (rotation.size() == 3 && translation.size() == 3) {
+            frames.push_back(image_number >= 0 ? image_number : static_cast<int64_t>(frames.size()));
+            rvecs.emplace_back(rotation[0], rotation[1], rotation[2]);
+            tvecs.emplace_back(translation[0], translation[1], translation[2]);
+            rotation.clear();
+            translation.clear();
+            section = &ignored;
+            image_number = -1;
+        }
+    }
+    return true;
+}
+
+}  // namespace calib
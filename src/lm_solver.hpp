@@ -0,0 +1,132 @@
+#pragma once
+
+// Building blocks shared by the bundle adjusters (refine.cpp, rig.cpp):
+// robust loss, Schur-complement solve of the block-structured normal
+// equations and the Levenberg-Marquardt loop around them.
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "calib/refine.hpp"
+
+namespace calib {
+namespace lm {
+
+constexpr double kMaxLambda = 1e12;
+
+// Robust loss on the squared pixel distance of a corner
+inline double robustCost(double s2, const RefineOptions& options) {
+    const double d = options.loss_scale;
+    switch (options.loss) {
+        case RobustLoss::Huber: {
+            double s = std::sqrt(s2);
+            return s <= d ? s2 : 2.0 * d * s - d * d;
+        }
+        case RobustLoss::Cauchy:
+            return d * d * std::log1p(s2 / (d * d));
+        default:
+            return s2;
+    }
+}
+
+// IRLS weight, the derivative of robustCost with respect to s2
+inline double robustWeight(double s2, const RefineOptions& options) {
+    const double d = options.loss_scale;
+    switch (options.loss) {
+        case RobustLoss::Huber: {
+            double s = std::sqrt(s2);
+            return s <= d ? 1.0 : d / s;
+        }
+        case RobustLoss::Cauchy:
+            return 1.0 / (1.0 + s2 / (d * d));
+        default:
+            return 1.0;
+    }
+}
+
+// Normal equations with the 6-dof pose blocks kept separate from the
+// parameters shared between poses (intrinsics, camera extrinsics):
+//   [ U    W_i ] [dc  ]   [-g_c  ]
+//   [ W_i' V_i ] [dp_i] = [-g_p_i]
+struct NormalEquations {
+    cv::Mat U, g_c;                  // shared x shared, shared x 1
+    std::vector<cv::Mat> V, W, g_p;  // per pose: 6x6, shared x 6, 6x1
+};
+
+// Marquardt damping: scale the diagonal by 1 + lambda
+inline cv::Mat damped(const cv::Mat& M, double lambda) {
+    cv::Mat D = M.clone();
+    for (int i = 0; i < D.rows; ++i) {
+        double& d = D.at<double>(i, i);
+        d += lambda * std::max(d, 1e-12);
+    }
+    return D;
+}
+
+// Solve the damped system by eliminating the pose blocks, leaving a dense
+// system the size of the shared parameters
+inline bool solveSchur(const NormalEquations& eq, double lambda, cv::Mat& dc, std::vector<cv::Mat>& dp) {
+    const size_t n_poses = eq.V.size();
+    std::vector<cv::Mat> V_inv(n_poses);
+    cv::Mat S = damped(eq.U, lambda);
+    cv::Mat rhs = -eq.g_c;
+    for (size_t a = 0; a < n_poses; ++a) {
+        if (cv::invert(damped(eq.V[a], lambda), V_inv[a], cv::DECOMP_CHOLESKY) == 0) {
+            return false;
+        }
+        cv::Mat WV = eq.W[a] * V_inv[a];
+        S -= WV * eq.W[a].t();
+        rhs += WV * eq.g_p[a];
+    }
+    if (!cv::solve(S, rhs, dc, cv::DECOMP_CHOLESKY) && !cv::solve(S, rhs, dc, cv::DECOMP_SVD)) {
+        return false;
+    }
+    dp.resize(n_poses);
+    for (size_t a = 0; a < n_poses; ++a) {
+        dp[a] = V_inv[a] * (-eq.g_p[a] - eq.W[a].t() * dc);
+    }
+    return true;
+}
+
+// Levenberg-Marquardt driver. cost(state) returns the robust cost,
+// linearize(state, eq) fills the normal equations and apply(state, dc, dp)
+// returns the updated state. Returns the number of iterations taken.
+template <typename State, typename Cost, typename Linearize, typename Apply>
+int levenbergMarquardt(State& state, const RefineOptions& options, Cost cost, Linearize linearize, Apply apply) {
+    double current = cost(state);
+    double lambda = 1e-4;
+    NormalEquations eq;
+    cv::Mat dc;
+    std::vector<cv::Mat> dp;
+
+    int iteration = 0;
+    while (iteration < options.max_iterations) {
+        iteration++;
+        linearize(state, eq);
+
+        bool improved = false;
+        double previous = current;
+        for (; lambda < kMaxLambda; lambda *= 10) {
+            if (!solveSchur(eq, lambda, dc, dp)) continue;
+            State candidate = apply(state, dc, dp);
+            double candidate_cost = cost(candidate);
+            if (candidate_cost < current) {
+                state = std::move(candidate);
+                current = candidate_cost;
+                lambda = std::max(lambda / 10, 1e-12);
+                improved = true;
+                break;
+            }
+        }
+        if (!improved || previous - current <= options.function_tolerance * previous) {
+            break;
+        }
+    }
+    return iteration;
+}
+
+}  // namespace lm
+}  // namespace calib
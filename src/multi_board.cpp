@@ -0,0 +1,225 @@
+#include "calib/multi_board.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <numeric>
+
+#include "calib/board.hpp"
+
+namespace calib {
+
+namespace {
+
+// Gray level masked boards are filled with; a flat region has no quads
+const cv::Scalar kMaskFill = cv::Scalar::all(128);
+
+// Extra pixels of search image around a tracked region
+constexpr int kRegionPadding = 8;
+
+void refine(const cv::Mat& gray, const Config& cfg, SubpixRefiner& refiner, std::vector<cv::Point2f>& corners) {
+    if (cfg.subpix_batched) {
+        refiner.refine(gray, corners);
+    } else {
+        cv::cornerSubPix(gray, corners, cfg.subpixWinSize(), cv::Size(-1, -1), cfg.subpixCriteria());
+    }
+}
+
+// True if two detections of a board size lie on the same board: their
+// centres are closer than one square. The corner order is not compared, as
+// a board may be found turned by 180 degrees.
+bool sameBoard(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b) {
+    if (a.size() != b.size() || a.size() < 2) return false;
+    cv::Point2f center_a(0, 0), center_b(0, 0);
+    for (size_t i = 0; i < a.size(); ++i) {
+        center_a += a[i];
+        center_b += b[i];
+    }
+    return cv::norm(center_a - center_b) / a.size() < cv::norm(a[1] - a[0]);
+}
+
+}  // namespace
+
+MultiBoardDetector::MultiBoardDetector(const Config& cfg) : cfg_(cfg), specs_(cfg.boardSpecs()) {
+    const SubpixOptions subpix = subpixOptions(cfg);
+    const PoseOptions pose = poseOptions(cfg);
+    for (const BoardSpec& spec : specs_) {
+        targets_.push_back(Target{spec, boardPoints(spec.size, spec.square_size), SubpixRefiner(subpix),
+                                  PoseTracker(pose), {}, 0});
+    }
+    search_order_.resize(specs_.size());
+    std::iota(search_order_.begin(), search_order_.end(), 0);
+    std::stable_sort(search_order_.begin(), search_order_.end(),
+                     [&](int a, int b) { return specs_[a].size.area() > specs_[b].size.area(); });
+}
+
+void MultiBoardDetector::toFullResolution(std::vector<cv::Point2f>& corners, cv::Point offset) const {
+    const float inverse = static_cast<float>(1.0 / scale_);
+    const cv::Point2f shift(offset.x + 0.5f, offset.y + 0.5f);
+    for (cv::Point2f& c : corners) c = (c + shift) * inverse - cv::Point2f(0.5f, 0.5f);
+}
+
+bool MultiBoardDetector::findInRegion(Target& target, std::vector<cv::Point2f>& corners) const {
+    // Bounds of the previous corners on the search image, grown by the margin
+    cv::Rect2f bounds = cv::boundingRect(target.previous);
+    bounds = cv::Rect2f(bounds.tl() * scale_, bounds.br() * scale_);
+    const float grow =
+        static_cast<float>(cfg_.boards_track_margin * std::max(bounds.width, bounds.height) + kRegionPadding);
+    const cv::Rect region =
+        cv::Rect(cv::Point(cvFloor(bounds.x - grow), cvFloor(bounds.y - grow)),
+                 cv::Point(cvCeil(bounds.br().x + grow), cvCeil(bounds.br().y + grow))) &
+        cv::Rect(0, 0, search_.cols, search_.rows);
+    if (region.width < 16 || region.height < 16) return false;
+    if (!cv::findChessboardCorners(search_(region), target.spec.size, corners, cfg_.chessboardFlags())) return false;
+    toFullResolution(corners, region.tl());
+    return true;
+}
+
+bool MultiBoardDetector::search(Target& target, std::vector<cv::Point2f>& corners) {
+    if (cfg_.gate) {
+        // The probe is taken from the masked search image, so boards that
+        // were already found do not pass it
+        if (!probe_ready_) {
+            if (search_.cols > cfg_.gate_width) {
+                const double scale = static_cast<double>(cfg_.gate_width) / search_.cols;
+                cv::resize(search_, probe_, cv::Size(), scale, scale, cv::INTER_AREA);
+            } else {
+                search_.copyTo(probe_);
+            }
+            probe_ready_ = true;
+        }
+        if (!cv::checkChessboard(probe_, target.spec.size) &&
+            (cfg_.gate_force_every == 0 || ++target.since_search < cfg_.gate_force_every)) {
+            stats_.gated++;
+            return false;
+        }
+    }
+    target.since_search = 0;
+    stats_.searches++;
+    if (!cv::findChessboardCorners(search_, target.spec.size, corners, cfg_.chessboardFlags())) return false;
+    toFullResolution(corners, cv::Point(0, 0));
+    return true;
+}
+
+void MultiBoardDetector::maskOut(const std::vector<cv::Point2f>& corners, cv::Size board_size) {
+    // The outer corners, pushed out by a square and a half beyond the
+    // outermost inner corners so the board's border squares are covered
+    const int w = board_size.width, h = board_size.height;
+    const cv::Point2f outer[4] = {corners[0], corners[w - 1], corners[w * h - 1], corners[(h - 1) * w]};
+    const cv::Point2f center = (outer[0] + outer[1] + outer[2] + outer[3]) * 0.25f;
+    const float grow = 1.0f + 3.0f / static_cast<float>(std::max(1, std::min(w, h) - 1));
+    std::vector<cv::Point> polygon(4);
+    for (int i = 0; i < 4; ++i) {
+        const cv::Point2f p = (center + (outer[i] - center) * grow) * static_cast<float>(scale_);
+        polygon[i] = cv::Point(cvRound(p.x), cvRound(p.y));
+    }
+    cv::fillConvexPoly(search_, polygon, kMaskFill);
+    probe_ready_ = false;
+}
+
+void MultiBoardDetector::detect(const cv::Mat& gray, std::vector<BoardDetection>& detections) {
+    stats_.frames++;
+    detections.clear();
+    const size_t n = targets_.size();
+
+    // The search image is masked as boards are found, so it is always a copy
+    // when there is more than one board
+    if (cfg_.boards_search_width > 0 && gray.cols > cfg_.boards_search_width) {
+        scale_ = static_cast<double>(cfg_.boards_search_width) / gray.cols;
+        cv::resize(gray, search_, cv::Size(), scale_, scale_, cv::INTER_AREA);
+    } else if (n > 1) {
+        scale_ = 1.0;
+        gray.copyTo(search_);
+    } else {
+        scale_ = 1.0;
+        search_ = gray;
+    }
+    probe_ready_ = false;
+
+    // Tracked boards in their regions, in parallel
+    std::vector<std::vector<cv::Point2f>> corners(n);
+    std::vector<char> found(n, 0), tracked(n, 0);
+    std::vector<int> tracking;
+    for (size_t i = 0; i < n; ++i) {
+        if (!targets_[i].previous.empty()) tracking.push_back(static_cast<int>(i));
+    }
+    cv::parallel_for_(cv::Range(0, static_cast<int>(tracking.size())), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; ++k) {
+            const int i = tracking[k];
+            if (findInRegion(targets_[i], corners[i])) {
+                refine(gray, cfg_, targets_[i].refiner, corners[i]);
+                found[i] = tracked[i] = 1;
+            }
+        }
+    });
+
+    // Overlapping regions of same-sized boards can find one board twice;
+    // the lower index keeps it
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = i + 1; j < n && found[i]; ++j) {
+            if (found[j] && specs_[i].size == specs_[j].size && sameBoard(corners[i], corners[j])) {
+                found[j] = tracked[j] = 0;
+            }
+        }
+    }
+    if (n > 1) {
+        for (size_t i = 0; i < n; ++i) {
+            if (found[i]) maskOut(corners[i], specs_[i].size);
+        }
+    }
+
+    // The remaining boards in the whole image, largest first
+    for (int i : search_order_) {
+        if (found[i]) continue;
+        if (search(targets_[i], corners[i])) {
+            refine(gray, cfg_, targets_[i].refiner, corners[i]);
+            found[i] = 1;
+            if (n > 1) maskOut(corners[i], specs_[i].size);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        Target& target = targets_[i];
+        if (!found[i]) {
+            target.previous.clear();
+            target.refiner.reset();
+            target.pose_tracker.reset();
+            continue;
+        }
+        target.previous = corners[i];
+        BoardDetection detection;
+        detection.board = static_cast<int>(i);
+        detection.corners = std::move(corners[i]);
+        detection.tracked = tracked[i] != 0;
+        detections.push_back(std::move(detection));
+        stats_.found++;
+        stats_.tracked += tracked[i];
+    }
+}
+
+void MultiBoardDetector::solvePoses(const Camera& camera, std::vector<BoardDetection>& detections) {
+    cv::parallel_for_(cv::Range(0, static_cast<int>(detections.size())), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; ++k) {
+            BoardDetection& detection = detections[k];
+            Target& target = targets_[detection.board];
+            detection.posed = target.pose_tracker.solve(target.points, detection.corners, camera, detection.pose);
+            detection.error =
+                detection.posed ? reprojectionError(target.points, detection.corners, camera, detection.pose) : 0.0;
+        }
+    });
+}
+
+void MultiBoardDetector::reset() {
+    for (Target& target : targets_) {
+        target.previous.clear();
+        target.refiner.reset();
+        target.pose_tracker.reset();
+    }
+}
+
+void printMultiBoardStats(std::ostream& out, const MultiBoardStats& stats, size_t boards) {
+    out << "Multi-board: " << boards << " boards, " << stats.found << " found in " << stats.frames << " frames ("
+        << stats.tracked << " tracked), " << stats.searches << " searches, " << stats.gated << " gated\n";
+}
+
+}  // namespace calib
@@ -0,0 +1,262 @@
+#include "calib/overlay.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "calib/projection.hpp"
+
+namespace calib {
+
+namespace {
+
+// Primitives are rasterized with 4 fractional bits, as drawChessboardCorners does
+constexpr int kShift = 4;
+constexpr float kScale = 1 << kShift;
+
+cv::Point fixedPoint(cv::Point2f p) {
+    return cv::Point(cvRound(p.x * kScale), cvRound(p.y * kScale));
+}
+
+// Room around a primitive's geometry for its width and anti-aliasing
+int margin(int thickness) {
+    return std::max(thickness, 1) / 2 + 2;
+}
+
+// a * b / 255, rounded, for 8-bit a and b
+inline int mulDiv255(int a, int b) {
+    int p = a * b + 128;
+    return (p + (p >> 8)) >> 8;
+}
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+inline cv::v_uint8 mulDiv255(const cv::v_uint8& a, const cv::v_uint8& b) {
+    cv::v_uint16 a0, a1, b0, b1;
+    cv::v_expand(a, a0, a1);
+    cv::v_expand(b, b0, b1);
+    const cv::v_uint16 half = cv::vx_setall_u16(128);
+    cv::v_uint16 p0 = cv::v_add(cv::v_mul_wrap(a0, b0), half);
+    cv::v_uint16 p1 = cv::v_add(cv::v_mul_wrap(a1, b1), half);
+    p0 = cv::v_shr<8>(cv::v_add(p0, cv::v_shr<8>(p0)));
+    p1 = cv::v_shr<8>(cv::v_add(p1, cv::v_shr<8>(p1)));
+    return cv::v_pack(p0, p1);
+}
+#endif
+
+// Marker colours of cv::drawChessboardCorners, one per board row
+const cv::Scalar kRowColors[] = {
+    cv::Scalar(0, 0, 255), cv::Scalar(0, 128, 255), cv::Scalar(0, 200, 200), cv::Scalar(0, 255, 0),
+    cv::Scalar(200, 200, 0), cv::Scalar(255, 0, 0), cv::Scalar(255, 0, 255),
+};
+
+}  // namespace
+
+void blendPremultiplied(const cv::Mat& overlay, cv::Mat& dst) {
+    CV_Assert(overlay.type() == CV_8UC4 && dst.type() == CV_8UC3 && overlay.size() == dst.size());
+    for (int y = 0; y < dst.rows; ++y) {
+        const uchar* o = overlay.ptr<uchar>(y);
+        uchar* d = dst.ptr<uchar>(y);
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+        const cv::v_uint8 full = cv::vx_setall_u8(255);
+        for (; x <= dst.cols - lanes; x += lanes) {
+            cv::v_uint8 ob, og, orr, oa, db, dg, dr;
+            cv::v_load_deinterleave(o + 4 * x, ob, og, orr, oa);
+            cv::v_load_deinterleave(d + 3 * x, db, dg, dr);
+            const cv::v_uint8 inv = cv::v_sub(full, oa);
+            // Saturating adds: premultiplied colour never exceeds alpha
+            db = cv::v_add(ob, mulDiv255(db, inv));
+            dg = cv::v_add(og, mulDiv255(dg, inv));
+            dr = cv::v_add(orr, mulDiv255(dr, inv));
+            cv::v_store_interleave(d + 3 * x, db, dg, dr);
+        }
+#endif
+        for (; x < dst.cols; ++x) {
+            const int inv = 255 - o[4 * x + 3];
+            for (int c = 0; c < 3; ++c) {
+                d[3 * x + c] = cv::saturate_cast<uchar>(o[4 * x + c] + mulDiv255(d[3 * x + c], inv));
+            }
+        }
+    }
+}
+
+bool Overlay::Primitive::operator==(const Primitive& other) const {
+    return kind == other.kind && layer == other.layer && a == other.a && b == other.b && color == other.color &&
+           thickness == other.thickness;
+}
+
+Overlay::Overlay() {
+    visible_.fill(true);
+    drawn_visible_ = visible_;
+}
+
+Overlay::Overlay(const Config& cfg) {
+    visible_.fill(false);
+    static const char* const kNames[] = {"corners", "axes", "projected", "objects"};
+    for (const std::string& name : cfg.overlayLayers()) {
+        for (size_t i = 0; i < visible_.size(); ++i) {
+            if (name == kNames[i]) visible_[i] = true;
+        }
+    }
+    drawn_visible_ = visible_;
+    opacity_ = cfg.overlay_opacity;
+}
+
+void Overlay::setVisible(OverlayLayer layer, bool visible) {
+    visible_[static_cast<size_t>(layer)] = visible;
+}
+
+bool Overlay::handleKey(int key) {
+    const int index = (key & 0xff) - '1';
+    if (index < 0 || index >= static_cast<int>(OverlayLayer::Count)) {
+        return false;
+    }
+    toggle(static_cast<OverlayLayer>(index));
+    return true;
+}
+
+void Overlay::begin() {
+    primitives_.clear();
+}
+
+void Overlay::line(OverlayLayer layer, cv::Point2f a, cv::Point2f b, const cv::Scalar& color, int thickness) {
+    const cv::Scalar premultiplied(color[0] * opacity_, color[1] * opacity_, color[2] * opacity_, 255 * opacity_);
+    primitives_.push_back(Primitive{Primitive::Kind::Line, layer, a, b, premultiplied, thickness});
+}
+
+void Overlay::circle(OverlayLayer layer, cv::Point2f center, float radius, const cv::Scalar& color, int thickness) {
+    const cv::Scalar premultiplied(color[0] * opacity_, color[1] * opacity_, color[2] * opacity_, 255 * opacity_);
+    primitives_.push_back(
+        Primitive{Primitive::Kind::Circle, layer, center, cv::Point2f(radius, 0), premultiplied, thickness});
+}
+
+void Overlay::chessboardCorners(cv::Size pattern_size, const std::vector<cv::Point2f>& corners, bool found) {
+    const float r = 4;
+    auto marker = [&](cv::Point2f pt, const cv::Scalar& color) {
+        line(OverlayLayer::Corners, pt - cv::Point2f(r, r), pt + cv::Point2f(r, r), color, 1);
+        line(OverlayLayer::Corners, pt + cv::Point2f(-r, r), pt + cv::Point2f(r, -r), color, 1);
+        circle(OverlayLayer::Corners, pt, r + 1, color, 1);
+    };
+    if (!found || static_cast<int>(corners.size()) != pattern_size.area()) {
+        for (const auto& pt : corners) marker(pt, cv::Scalar(0, 0, 255));
+        return;
+    }
+    const size_t n_colors = sizeof(kRowColors) / sizeof(kRowColors[0]);
+    for (int y = 0, i = 0; y < pattern_size.height; ++y) {
+        const cv::Scalar& color = kRowColors[y % n_colors];
+        for (int x = 0; x < pattern_size.width; ++x, ++i) {
+            if (i != 0) line(OverlayLayer::Corners, corners[i - 1], corners[i], color, 1);
+            marker(corners[i], color);
+        }
+    }
+}
+
+void Overlay::axes(const Intrinsics& intrinsics, const cv::Mat& rvec, const cv::Mat& tvec, float length,
+                   int thickness) {
+    axes(toCamera(intrinsics), toPose(rvec, tvec), length, thickness);
+}
+
+void Overlay::projectedCorners(const std::vector<cv::Vec3f>& object_points, const Intrinsics& intrinsics,
+                               const cv::Mat& rvec, const cv::Mat& tvec, const cv::Scalar& color) {
+    projectedCorners(object_points, toCamera(intrinsics), toPose(rvec, tvec), color);
+}
+
+void Overlay::axes(const Camera& camera, const Pose& pose, float length, int thickness) {
+    const std::array<cv::Point3f, 4> axes_points = {cv::Point3f(0, 0, 0), cv::Point3f(length, 0, 0),
+                                                    cv::Point3f(0, length, 0), cv::Point3f(0, 0, -length)};
+    std::array<cv::Point2f, 4> image_points;
+    projectPoints(axes_points, pose, camera, image_points.data());
+    line(OverlayLayer::Axes, image_points[0], image_points[1], cv::Scalar(0, 0, 255), thickness);
+    line(OverlayLayer::Axes, image_points[0], image_points[2], cv::Scalar(0, 255, 0), thickness);
+    line(OverlayLayer::Axes, image_points[0], image_points[3], cv::Scalar(255, 0, 0), thickness);
+}
+
+void Overlay::projectedCorners(PointSpan object_points, const Camera& camera, const Pose& pose,
+                               const cv::Scalar& color) {
+    projectPoints(object_points, pose, camera, projected_);
+    for (const auto& corner : projected_) {
+        circle(OverlayLayer::Projected, corner, 5, color, -1);
+    }
+}
+
+void Overlay::markTiles(const cv::Rect& bounds) {
+    const cv::Rect clipped = bounds & cv::Rect(0, 0, buffer_.cols, buffer_.rows);
+    if (clipped.empty()) return;
+    const int x0 = clipped.x / kTileSize, x1 = (clipped.br().x - 1) / kTileSize;
+    const int y0 = clipped.y / kTileSize, y1 = (clipped.br().y - 1) / kTileSize;
+    for (int ty = y0; ty <= y1; ++ty) {
+        std::fill(dirty_tiles_.begin() + ty * tiles_.width + x0, dirty_tiles_.begin() + ty * tiles_.width + x1 + 1, 1);
+    }
+}
+
+void Overlay::redraw() {
+    // Clear only what the previous drawing touched
+    for (const cv::Rect& rect : dirty_rects_) {
+        buffer_(rect).setTo(cv::Scalar::all(0));
+    }
+    std::fill(dirty_tiles_.begin(), dirty_tiles_.end(), 0);
+
+    for (const Primitive& p : primitives_) {
+        if (!visible(p.layer)) continue;
+        const int m = margin(p.thickness);
+        if (p.kind == Primitive::Kind::Line) {
+            cv::line(buffer_, fixedPoint(p.a), fixedPoint(p.b), p.color, p.thickness, cv::LINE_AA, kShift);
+            const int x0 = cvFloor(std::min(p.a.x, p.b.x)), y0 = cvFloor(std::min(p.a.y, p.b.y));
+            const int x1 = cvCeil(std::max(p.a.x, p.b.x)), y1 = cvCeil(std::max(p.a.y, p.b.y));
+            markTiles(cv::Rect(cv::Point(x0 - m, y0 - m), cv::Point(x1 + m + 1, y1 + m + 1)));
+        } else {
+            const float radius = p.b.x;
+            cv::circle(buffer_, fixedPoint(p.a), cvRound(radius * kScale), p.color, p.thickness, cv::LINE_AA, kShift);
+            const int extent = cvCeil(radius) + m;
+            const cv::Point center(cvRound(p.a.x), cvRound(p.a.y));
+            markTiles(cv::Rect(center - cv::Point(extent, extent), center + cv::Point(extent + 1, extent + 1)));
+        }
+    }
+    drawn_ = primitives_;
+    drawn_visible_ = visible_;
+}
+
+void Overlay::composite(cv::Mat& frame) {
+    if (frame.size() != buffer_.size()) {
+        buffer_ = cv::Mat::zeros(frame.size(), CV_8UC4);
+        tiles_ = cv::Size((frame.cols + kTileSize - 1) / kTileSize, (frame.rows + kTileSize - 1) / kTileSize);
+        dirty_tiles_.assign(static_cast<size_t>(tiles_.area()), 0);
+        dirty_rects_.clear();
+        force_redraw_ = true;
+    }
+
+    redrawn_ = force_redraw_ || visible_ != drawn_visible_ || primitives_.size() != drawn_.size() ||
+               !std::equal(primitives_.begin(), primitives_.end(), drawn_.begin());
+    if (redrawn_) {
+        redraw();
+        force_redraw_ = false;
+
+        // Runs of dirty tiles along each tile row
+        dirty_rects_.clear();
+        const cv::Rect frame_rect(0, 0, frame.cols, frame.rows);
+        for (int ty = 0; ty < tiles_.height; ++ty) {
+            const uint8_t* row = &dirty_tiles_[static_cast<size_t>(ty * tiles_.width)];
+            for (int tx = 0; tx < tiles_.width;) {
+                if (!row[tx]) {
+                    ++tx;
+                    continue;
+                }
+                int end = tx;
+                while (end < tiles_.width && row[end]) ++end;
+                dirty_rects_.push_back(
+                    cv::Rect(tx * kTileSize, ty * kTileSize, (end - tx) * kTileSize, kTileSize) & frame_rect);
+                tx = end;
+            }
+        }
+    }
+
+    for (const cv::Rect& rect : dirty_rects_) {
+        cv::Mat target = frame(rect);
+        blendPremultiplied(buffer_(rect), target);
+    }
+}
+
+}  // namespace calib
@@ -0,0 +1,184 @@
+#include "calib/pose.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <string>
+
+#include "calib/distortion.hpp"
+#include "calib/projection.hpp"
+
+namespace calib {
+
+namespace {
+
+// Points reprojected at a time by reprojectionError, in a stack buffer
+constexpr size_t kProjectBlock = 64;
+
+struct SolverInfo {
+    PoseSolver solver;
+    const char* name;
+    int flags;
+};
+
+constexpr SolverInfo kSolvers[] = {
+    {PoseSolver::Iterative, "iterative", cv::SOLVEPNP_ITERATIVE},
+    {PoseSolver::Ippe, "ippe", cv::SOLVEPNP_IPPE},
+    {PoseSolver::Sqpnp, "sqpnp", cv::SOLVEPNP_SQPNP},
+};
+
+const SolverInfo& solverInfo(PoseSolver solver) {
+    for (const SolverInfo& info : kSolvers) {
+        if (info.solver == solver) return info;
+    }
+    return kSolvers[0];
+}
+
+// IPPE takes any plane, but the plane of a single point set is only
+// well defined for the board, which lies on z = 0
+bool onBoardPlane(PointSpan object_points) {
+    for (size_t i = 0; i < object_points.size(); ++i) {
+        if (object_points[i][2] != 0.0f) return false;
+    }
+    return true;
+}
+
+// solvePnPGeneric reports errors in the depth of its inputs
+double errorAt(const cv::Mat& errors, int i) {
+    return errors.depth() == CV_64F ? errors.at<double>(i) : errors.at<float>(i);
+}
+
+// Angle in radians of the rotation between two poses
+double rotationBetween(const Pose& a, const Pose& b) {
+    const double c = (cv::trace(a.rotation().t() * b.rotation()) - 1.0) / 2.0;
+    return std::acos(std::min(1.0, std::max(-1.0, c)));
+}
+
+}  // namespace
+
+const char* poseSolverName(PoseSolver solver) {
+    return solverInfo(solver).name;
+}
+
+bool parsePoseSolver(const std::string& name, PoseSolver& solver) {
+    for (const SolverInfo& info : kSolvers) {
+        if (name == info.name) {
+            solver = info.solver;
+            return true;
+        }
+    }
+    return false;
+}
+
+PoseOptions poseOptions(const Config& cfg) {
+    PoseOptions options;
+    parsePoseSolver(cfg.pose_solver, options.solver);
+    options.ambiguity_ratio = cfg.pose_ambiguity_ratio;
+    options.refine = cfg.pose_refine;
+    return options;
+}
+
+bool solvePose(const std::vector<cv::Vec3f>& object_points, const std::vector<cv::Point2f>& corners,
+               const Intrinsics& intrinsics, cv::Mat& rvec, cv::Mat& tvec) {
+    Pose pose;
+    if (!solvePose(object_points, corners, toCamera(intrinsics), pose)) return false;
+    cv::Mat(pose.rvec).copyTo(rvec);
+    cv::Mat(pose.tvec).copyTo(tvec);
+    return true;
+}
+
+bool solvePose(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera, Pose& pose) {
+    return solvePose(object_points, corners, camera, pose, PoseOptions());
+}
+
+bool solvePose(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera, Pose& pose,
+               const PoseOptions& options) {
+    PoseTracker tracker(options);
+    return tracker.solve(object_points, corners, camera, pose);
+}
+
+PoseTracker::PoseTracker(const PoseOptions& options) : options_(options) {}
+
+bool PoseTracker::solve(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera,
+                        Pose& pose) {
+    if (object_points.size() < 4 || object_points.size() != corners.size()) {
+        stats_.failed++;
+        return false;
+    }
+
+    // solvePnP has no fisheye model: solve on the undistorted points
+    const std::vector<cv::Point2f>* points = &corners;
+    cv::Matx33d K = camera.K;
+    cv::Mat dist = pinholeCoefficients(camera);
+    if (camera.model == DistortionModel::Fisheye) {
+        undistortPoints(corners, camera, normalized_);
+        points = &normalized_;
+        K = cv::Matx33d::eye();
+    }
+
+    PoseSolver solver = options_.solver;
+    if (solver == PoseSolver::Ippe && !onBoardPlane(object_points)) solver = PoseSolver::Iterative;
+    const bool guess = solver == PoseSolver::Iterative && has_previous_;
+    cv::Vec3d rvec_guess = previous_.rvec, tvec_guess = previous_.tvec;
+    const int n = cv::solvePnPGeneric(object_points.mat(), *points, K, dist, rvecs_, tvecs_, guess,
+                                      solverInfo(solver).flags, rvec_guess, tvec_guess, errors_);
+    if (n <= 0) {
+        stats_.failed++;
+        return false;
+    }
+
+    // The two IPPE poses mirror each other about the line of sight. When
+    // their errors are too close to tell them apart, keep to the pose the
+    // board had a frame ago.
+    int best = 0;
+    if (n == 2) {
+        const double e0 = errorAt(errors_, 0), e1 = errorAt(errors_, 1);
+        best = e1 < e0 ? 1 : 0;
+        const int other = 1 - best;
+        if (std::max(e0, e1) <= options_.ambiguity_ratio * std::min(e0, e1)) {
+            stats_.ambiguous++;
+            if (has_previous_ && rotationBetween(toPose(rvecs_[other], tvecs_[other]), previous_) <
+                                     rotationBetween(toPose(rvecs_[best], tvecs_[best]), previous_)) {
+                best = other;
+                stats_.flipped++;
+            }
+        }
+    }
+    pose = toPose(rvecs_[best], tvecs_[best]);
+    if (options_.refine) cv::solvePnPRefineLM(object_points.mat(), *points, K, dist, pose.rvec, pose.tvec);
+
+    previous_ = pose;
+    has_previous_ = true;
+    stats_.solved++;
+    return true;
+}
+
+void printPoseStats(std::ostream& out, const PoseOptions& options, const PoseStats& stats) {
+    out << "Pose solver " << poseSolverName(options.solver) << ": " << stats.solved << " poses, " << stats.failed
+        << " failed, " << stats.ambiguous << " ambiguous, " << stats.flipped << " resolved by the previous pose\n";
+}
+
+double reprojectionError(const std::vector<cv::Vec3f>& object_points, const std::vector<cv::Point2f>& corners,
+                         const Intrinsics& intrinsics, const cv::Mat& rvec, const cv::Mat& tvec) {
+    return reprojectionError(object_points, corners, toCamera(intrinsics), toPose(rvec, tvec));
+}
+
+double reprojectionError(PointSpan object_points, const std::vector<cv::Point2f>& corners, const Camera& camera,
+                         const Pose& pose) {
+    if (corners.empty()) return 0.0;
+    CV_Assert(object_points.size() == corners.size());
+    std::array<cv::Point2f, kProjectBlock> projected;
+    double sum = 0.0;
+    for (size_t first = 0; first < corners.size(); first += kProjectBlock) {
+        const size_t count = std::min(kProjectBlock, corners.size() - first);
+        projectPoints(object_points.subspan(first, count), pose, camera, projected.data());
+        for (size_t i = 0; i < count; ++i) {
+            const cv::Point2f d = corners[first + i] - projected[i];
+            sum += static_cast<double>(d.x) * d.x + static_cast<double>(d.y) * d.y;
+        }
+    }
+    return std::sqrt(sum / static_cast<double>(corners.size()));
+}
+
+}  // namespace calib
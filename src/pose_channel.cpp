@@ -0,0 +1,218 @@
+#include "calib/pose_channel.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <new>
+#include <type_traits>
+
+#include "shared_memory.hpp"
+
+namespace calib {
+
+namespace {
+
+constexpr uint64_t kMagic = 0x31534f504c4143ULL;  // "CALPOS1"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kWords = sizeof(PoseMessage) / sizeof(uint64_t);
+static_assert(std::is_trivially_copyable<PoseMessage>::value, "PoseMessage is copied word by word");
+static_assert(sizeof(PoseMessage) % sizeof(uint64_t) == 0, "PoseMessage must be a whole number of words");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+// Spin this long in wait() before falling back to short sleeps
+constexpr double kSpinSeconds = 50e-6;
+constexpr auto kSleepStep = std::chrono::microseconds(100);
+
+}  // namespace
+
+// One ring slot: a sequence lock around the message. version is odd while
+// the publisher writes sequence (version - 1) / 2 and even once it is done.
+// The payload is stored as relaxed atomic words so a reader racing with the
+// publisher only ever sees a torn copy, which the version check rejects.
+struct alignas(64) PoseSlot {
+    std::atomic<uint64_t> version{0};
+    std::atomic<uint64_t> words[kWords];
+};
+
+// Shared-memory layout: this header followed by `capacity` slots. magic is
+// stored last so a reader never sees a half-initialised channel.
+struct alignas(64) PoseRing {
+    std::atomic<uint64_t> magic{0};
+    uint32_t version = kVersion;
+    uint32_t capacity = 0;
+    alignas(64) std::atomic<uint64_t> published{0};  // number of poses published
+
+    PoseSlot* slots() { return reinterpret_cast<PoseSlot*>(this + 1); }
+    const PoseSlot* slots() const { return reinterpret_cast<const PoseSlot*>(this + 1); }
+};
+
+double monotonicSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+PosePublisher::~PosePublisher() {
+    close();
+}
+
+bool PosePublisher::open(const std::string& name, uint32_t capacity) {
+    close();
+    if (capacity == 0) {
+        std::cerr << "Error: Pose channel needs a capacity of at least 1" << std::endl;
+        return false;
+    }
+
+    const size_t bytes = sizeof(PoseRing) + capacity * sizeof(PoseSlot);
+    void* memory = shm::create(name, bytes, "pose channel");
+    if (!memory) {
+        return false;
+    }
+
+    ring_ = new (memory) PoseRing();
+    ring_->capacity = capacity;
+    PoseSlot* slots = ring_->slots();
+    for (uint32_t i = 0; i < capacity; ++i) {
+        new (&slots[i]) PoseSlot();
+    }
+    ring_->magic.store(kMagic, std::memory_order_release);
+
+    name_ = name;
+    bytes_ = bytes;
+    next_ = 0;
+    return true;
+}
+
+void PosePublisher::publish(PoseMessage message) {
+    if (!ring_) return;
+    message.sequence = next_++;
+    message.published_at = monotonicSeconds();
+    uint64_t words[kWords];
+    std::memcpy(words, &message, sizeof(message));
+
+    PoseSlot& slot = ring_->slots()[message.sequence % ring_->capacity];
+    slot.version.store(2 * message.sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.version.store(2 * message.sequence + 2, std::memory_order_release);
+    ring_->published.store(next_, std::memory_order_release);
+}
+
+void PosePublisher::close() {
+    if (!ring_) return;
+    shm::unmap(ring_, bytes_);
+    shm_unlink(name_.c_str());
+    ring_ = nullptr;
+    bytes_ = 0;
+}
+
+PoseSubscriber::~PoseSubscriber() {
+    close();
+}
+
+bool PoseSubscriber::open(const std::string& name) {
+    close();
+    size_t bytes = 0;
+    const void* memory = shm::open(name, sizeof(PoseRing), bytes, "pose channel");
+    if (!memory) {
+        return false;
+    }
+
+    const PoseRing* ring = static_cast<const PoseRing*>(memory);
+    if (ring->magic.load(std::memory_order_acquire) != kMagic || ring->version != kVersion ||
+        bytes < sizeof(PoseRing) + ring->capacity * sizeof(PoseSlot)) {
+        std::cerr << "Error: " << name << " is not a pose channel" << std::endl;
+        shm::unmap(memory, bytes);
+        return false;
+    }
+
+    ring_ = ring;
+    bytes_ = bytes;
+    cursor_ = ring_->published.load(std::memory_order_acquire);
+    lost_ = 0;
+    return true;
+}
+
+void PoseSubscriber::close() {
+    unsubscribe();
+    if (!ring_) return;
+    shm::unmap(ring_, bytes_);
+    ring_ = nullptr;
+    bytes_ = 0;
+}
+
+bool PoseSubscriber::read(uint64_t sequence, PoseMessage& message) const {
+    const PoseSlot& slot = ring_->slots()[sequence % ring_->capacity];
+    const uint64_t complete = 2 * sequence + 2;
+    if (slot.version.load(std::memory_order_acquire) != complete) {
+        return false;
+    }
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; ++i) {
+        words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.version.load(std::memory_order_relaxed) != complete) {
+        return false;  // overwritten while we copied it
+    }
+    std::memcpy(&message, words, sizeof(message));
+    return true;
+}
+
+bool PoseSubscriber::latest(PoseMessage& message) const {
+    if (!ring_) return false;
+    // A failed read means a newer pose replaced the slot, so look again
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        uint64_t published = ring_->published.load(std::memory_order_acquire);
+        if (published == 0) return false;
+        if (read(published - 1, message)) return true;
+    }
+    return false;
+}
+
+bool PoseSubscriber::next(PoseMessage& message) {
+    if (!ring_) return false;
+    const uint64_t published = ring_->published.load(std::memory_order_acquire);
+    if (published - cursor_ > ring_->capacity) {
+        lost_ += published - cursor_ - ring_->capacity;
+        cursor_ = published - ring_->capacity;
+    }
+    while (cursor_ < published) {
+        if (read(cursor_++, message)) return true;
+        lost_++;
+    }
+    return false;
+}
+
+bool PoseSubscriber::wait(PoseMessage& message, double timeout_seconds) {
+    const double start = monotonicSeconds();
+    for (;;) {
+        if (next(message)) return true;
+        double elapsed = monotonicSeconds() - start;
+        if (elapsed >= timeout_seconds) return false;
+        if (elapsed >= kSpinSeconds) std::this_thread::sleep_for(kSleepStep);
+    }
+}
+
+void PoseSubscriber::subscribe(std::function<void(const PoseMessage&)> callback) {
+    unsubscribe();
+    if (!ring_) return;
+    stop_ = false;
+    worker_ = std::thread([this, callback = std::move(callback)]() {
+        PoseMessage message;
+        while (!stop_.load(std::memory_order_relaxed)) {
+            if (wait(message, 0.05)) callback(message);
+        }
+    });
+}
+
+void PoseSubscriber::unsubscribe() {
+    if (!worker_.joinable()) return;
+    stop_ = true;
+    worker_.join();
+}
+
+}  // namespace calib
@@ -0,0 +1,65 @@
+#include "calib/projection.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <array>
+
+#include "calib/distortion.hpp"
+
+namespace calib {
+
+void projectPoints(PointSpan object_points, const Pose& pose, const Camera& camera, cv::Point2f* image_points) {
+    const cv::Matx33d R = pose.rotation();
+    const cv::Matx33d& K = camera.K;
+    // Pinhole projection followed by the lens model, with the loop
+    // instantiated per model
+    withLens(camera.model, [&](auto lens) {
+        using L = decltype(lens);
+        for (size_t i = 0; i < object_points.size(); ++i) {
+            const cv::Vec3f& p = object_points[i];
+            const cv::Vec3d X = R * cv::Vec3d(p[0], p[1], p[2]) + pose.tvec;
+            const double inv_z = X[2] != 0 ? 1.0 / X[2] : 1.0;
+            const cv::Point2d d = L::distort(camera.k.val, cv::Point2d(X[0] * inv_z, X[1] * inv_z));
+            image_points[i] = cv::Point2f(static_cast<float>(K(0, 0) * d.x + K(0, 1) * d.y + K(0, 2)),
+                                          static_cast<float>(K(1, 1) * d.y + K(1, 2)));
+        }
+    });
+}
+
+void projectPoints(PointSpan object_points, const Pose& pose, const Camera& camera,
+                   std::vector<cv::Point2f>& image_points) {
+    image_points.resize(object_points.size());
+    projectPoints(object_points, pose, camera, image_points.data());
+}
+
+void projectPoints(const std::vector<cv::Point3f>& object_points, const cv::Mat& rvec, const cv::Mat& tvec,
+                   const Intrinsics& intrinsics, std::vector<cv::Point2f>& image_points) {
+    projectPoints(object_points, toPose(rvec, tvec), toCamera(intrinsics), image_points);
+}
+
+void projectPoints(const std::vector<cv::Vec3f>& object_points, const cv::Mat& rvec, const cv::Mat& tvec,
+                   const Intrinsics& intrinsics, std::vector<cv::Point2f>& image_points) {
+    projectPoints(object_points, toPose(rvec, tvec), toCamera(intrinsics), image_points);
+}
+
+void drawAxes(cv::Mat& frame, const Intrinsics& intrinsics, const cv::Mat& rvec, const cv::Mat& tvec,
+              float length, int thickness) {
+    const std::array<cv::Point3f, 4> axes_points = {cv::Point3f(0, 0, 0), cv::Point3f(length, 0, 0),
+                                                    cv::Point3f(0, length, 0), cv::Point3f(0, 0, -length)};
+    std::array<cv::Point2f, 4> image_points;
+    projectPoints(axes_points, toPose(rvec, tvec), toCamera(intrinsics), image_points.data());
+
+    cv::line(frame, image_points[0], image_points[1], cv::Scalar(0, 0, 255), thickness);
+    cv::line(frame, image_points[0], image_points[2], cv::Scalar(0, 255, 0), thickness);
+    cv::line(frame, image_points[0], image_points[3], cv::Scalar(255, 0, 0), thickness);
+}
+
+void drawProjectedCorners(cv::Mat& frame, const std::vector<cv::Vec3f>& object_points, const Intrinsics& intrinsics,
+                          const cv::Mat& rvec, const cv::Mat& tvec, const cv::Scalar& color) {
+    std::vector<cv::Point2f> projected_corners;
+    projectPoints(object_points, rvec, tvec, intrinsics, projected_corners);
+    for (const auto& corner : projected_corners) {
+        cv::circle(frame, corner, 5, color, -1);
+    }
+}
+
+}  // namespace calib
@@ -0,0 +1,200 @@
+#include "calib/quality.hpp"
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace calib {
+
+namespace {
+
+constexpr const char* kStageNames[] = {"detect", "pose", "draw", "output"};
+static_assert(sizeof(kStageNames) / sizeof(kStageNames[0]) == static_cast<size_t>(FrameStage::Count),
+              "every frame stage needs a name");
+
+// Optical flow window and pyramid levels for tracking corners between
+// detections
+const cv::Size kFlowWindow(21, 21);
+constexpr int kFlowLevels = 3;
+
+double ticksToMs(int64_t ticks) {
+    return ticks * 1000.0 / cv::getTickFrequency();
+}
+
+}  // namespace
+
+std::vector<QualityLevel> qualityLevels(const Config& cfg) {
+    const int window = cfg.subpix_window, iterations = cfg.subpix_max_iter;
+    return {
+        {1.0, window, iterations, 1, true},
+        {1.0, std::min(window, 7), std::min(iterations, 15), 1, true},
+        {0.75, std::min(window, 5), std::min(iterations, 10), 1, false},
+        {0.5, std::min(window, 5), std::min(iterations, 10), 2, false},
+        {0.5, std::min(window, 3), std::min(iterations, 5), 3, false},
+    };
+}
+
+QualityOptions qualityOptions(const Config& cfg) {
+    QualityOptions options;
+    options.adaptive = cfg.quality_adaptive;
+    options.budget_ms = cfg.quality_budget_ms;
+    options.raise_below = cfg.quality_raise_below;
+    options.hold_frames = cfg.quality_hold_frames;
+    return options;
+}
+
+const char* frameStageName(FrameStage stage) {
+    return kStageNames[static_cast<size_t>(stage)];
+}
+
+QualityController::QualityController(const Config& cfg)
+    : cfg_(cfg), options_(qualityOptions(cfg)), levels_(qualityLevels(cfg)), refiner_(subpixOptions(cfg)) {
+    metrics_.frames_at_level.assign(levels_.size(), 0);
+    lap_start_ = frame_start_ = cv::getTickCount();
+}
+
+void QualityController::setLevel(int level) {
+    level_ = level;
+    since_change_ = 0;
+    below_ = 0;
+    metrics_.level = level;
+    SubpixOptions subpix = subpixOptions(cfg_);
+    subpix.window = levels_[level].subpix_window;
+    subpix.max_iter = levels_[level].subpix_max_iter;
+    refiner_ = SubpixRefiner(subpix);
+}
+
+bool QualityController::detectFull(const cv::Mat& gray, std::vector<cv::Point2f>& corners, BoardGate& gate) {
+    if (!gate.admit(gray)) {
+        corners.clear();
+        return false;
+    }
+    const QualityLevel& current = level();
+    bool found;
+    if (current.detect_scale < 1.0) {
+        // Corners of the downscaled frame, mapped back to pixel centres of
+        // the full frame
+        const double scale = current.detect_scale;
+        cv::resize(gray, small_, cv::Size(), scale, scale, cv::INTER_AREA);
+        found = findBoard(small_, cfg_, corners);
+        const float inverse = static_cast<float>(1.0 / scale);
+        for (cv::Point2f& c : corners) c = (c + cv::Point2f(0.5f, 0.5f)) * inverse - cv::Point2f(0.5f, 0.5f);
+    } else {
+        found = findBoard(gray, cfg_, corners);
+    }
+    gate.report(found);
+    return found;
+}
+
+bool QualityController::track(const cv::Mat& gray, std::vector<cv::Point2f>& corners) {
+    if (previous_gray_.size() != gray.size()) return false;
+    std::vector<uchar> status;
+    std::vector<float> error;
+    cv::calcOpticalFlowPyrLK(previous_gray_, gray, previous_corners_, corners, status, error, kFlowWindow,
+                             kFlowLevels);
+    const cv::Rect2f bounds(0.f, 0.f, static_cast<float>(gray.cols), static_cast<float>(gray.rows));
+    for (size_t i = 0; i < corners.size(); ++i) {
+        if (!status[i] || !bounds.contains(corners[i])) return false;
+    }
+    return true;
+}
+
+bool QualityController::detect(const cv::Mat& gray, std::vector<cv::Point2f>& corners, BoardGate& gate) {
+    bool found = false;
+    if (!previous_corners_.empty() && since_detect_ + 1 < level().detect_every && track(gray, corners)) {
+        since_detect_++;
+        metrics_.tracked++;
+        found = true;
+    } else {
+        found = detectFull(gray, corners, gate);
+        since_detect_ = 0;
+        metrics_.detected++;
+    }
+
+    if (!found) {
+        corners.clear();
+        previous_corners_.clear();
+        refiner_.reset();
+    } else {
+        const QualityLevel& current = level();
+        if (cfg_.subpix_batched) {
+            refiner_.refine(gray, corners);
+        } else {
+            const cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER,
+                                            current.subpix_max_iter, cfg_.subpix_epsilon);
+            cv::cornerSubPix(gray, corners, cv::Size(current.subpix_window, current.subpix_window), cv::Size(-1, -1),
+                             criteria);
+        }
+        // Only a level that tracks needs the frame again
+        if (current.detect_every > 1) {
+            gray.copyTo(previous_gray_);
+            previous_corners_ = corners;
+        } else {
+            previous_corners_.clear();
+        }
+    }
+    lap(FrameStage::Detect);
+    return found;
+}
+
+void QualityController::beginFrame() {
+    lap_start_ = frame_start_ = cv::getTickCount();
+    frame_stage_ms_.fill(0.0);
+}
+
+void QualityController::lap(FrameStage stage) {
+    const int64_t now = cv::getTickCount();
+    frame_stage_ms_[static_cast<size_t>(stage)] += ticksToMs(now - lap_start_);
+    lap_start_ = now;
+}
+
+void QualityController::endFrame() {
+    const double ms = ticksToMs(cv::getTickCount() - frame_start_);
+    const double weight = metrics_.frames == 0 ? 1.0 : options_.smoothing;
+    metrics_.frames++;
+    metrics_.last_ms = ms;
+    metrics_.latency_ms += weight * (ms - metrics_.latency_ms);
+    for (size_t i = 0; i < frame_stage_ms_.size(); ++i) {
+        metrics_.stage_ms[i] += weight * (frame_stage_ms_[i] - metrics_.stage_ms[i]);
+    }
+    if (ms > options_.budget_ms) metrics_.over_budget++;
+    metrics_.frames_at_level[level_]++;
+    since_change_++;
+    if (!options_.adaptive) return;
+
+    // Lower as soon as the average has had time to reflect the current
+    // level; raise only after a sustained stretch well under the budget
+    const int settle = static_cast<int>(std::ceil(1.0 / options_.smoothing));
+    const int last = static_cast<int>(levels_.size()) - 1;
+    if (metrics_.latency_ms > options_.budget_ms) {
+        below_ = 0;
+        if (since_change_ >= settle && level_ < last) {
+            setLevel(level_ + 1);
+            metrics_.lowered++;
+        }
+    } else if (metrics_.latency_ms < options_.raise_below * options_.budget_ms) {
+        if (++below_ >= options_.hold_frames && level_ > 0) {
+            setLevel(level_ - 1);
+            metrics_.raised++;
+        }
+    } else {
+        below_ = 0;
+    }
+}
+
+void printQualityMetrics(std::ostream& out, const QualityOptions& options, const QualityMetrics& metrics) {
+    out << "Quality: " << (options.adaptive ? "adaptive" : "fixed") << ", level " << metrics.level << " at exit, "
+        << metrics.latency_ms << " ms average against a " << options.budget_ms << " ms budget, "
+        << metrics.over_budget << " of " << metrics.frames << " frames over; " << metrics.detected << " detected, "
+        << metrics.tracked << " tracked; lowered " << metrics.lowered << " times, raised " << metrics.raised
+        << " times\n  stages:";
+    for (size_t i = 0; i < metrics.stage_ms.size(); ++i) {
+        out << " " << kStageNames[i] << " " << metrics.stage_ms[i] << " ms";
+    }
+    out << "\n  frames per level:";
+    for (int64_t frames : metrics.frames_at_level) out << " " << frames;
+    out << "\n";
+}
+
+}  // namespace calib
@@ -0,0 +1,279 @@
+#include "calib/raster.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "calib/projection.hpp"
+
+namespace calib {
+
+namespace {
+
+// Direction towards the light in camera coordinates: above and to the left
+// of the camera, so faces turned towards the camera are lit
+const cv::Vec3f kLight = cv::normalize(cv::Vec3f(-0.3f, -0.5f, -1.0f));
+
+float lighting(const cv::Vec3f& normal, float ambient) {
+    // Both sides of a face are lit, so the winding does not matter
+    return ambient + (1.0f - ambient) * std::abs(normal.dot(kLight));
+}
+
+cv::Vec3b toVec3b(const cv::Scalar& color) {
+    return cv::Vec3b(cv::saturate_cast<uchar>(color[0]), cv::saturate_cast<uchar>(color[1]),
+                     cv::saturate_cast<uchar>(color[2]));
+}
+
+}  // namespace
+
+Mesh makeMesh(std::vector<cv::Vec3f> vertices, std::vector<cv::Vec3i> triangles, const cv::Scalar& color) {
+    Mesh mesh;
+    mesh.vertices = std::move(vertices);
+    mesh.triangles = std::move(triangles);
+    mesh.normals.assign(mesh.vertices.size(), cv::Vec3f(0, 0, 0));
+    mesh.colors.assign(mesh.vertices.size(), toVec3b(color));
+
+    // Area-weighted face normals, summed per vertex
+    for (const cv::Vec3i& t : mesh.triangles) {
+        const cv::Vec3f& a = mesh.vertices[t[0]];
+        const cv::Vec3f n = (mesh.vertices[t[1]] - a).cross(mesh.vertices[t[2]] - a);
+        for (int i = 0; i < 3; ++i) mesh.normals[t[i]] += n;
+    }
+    for (cv::Vec3f& n : mesh.normals) {
+        const float length = static_cast<float>(cv::norm(n));
+        if (length > 0) n *= 1.0f / length;
+    }
+    return mesh;
+}
+
+Mesh boxMesh(const cv::Vec3f& low, const cv::Vec3f& high, const cv::Scalar& color) {
+    // Four vertices per face so that every face keeps its own normal
+    std::vector<cv::Vec3f> vertices;
+    std::vector<cv::Vec3i> triangles;
+    for (int axis = 0; axis < 3; ++axis) {
+        const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        for (int side = 0; side < 2; ++side) {
+            const int first = static_cast<int>(vertices.size());
+            for (int corner = 0; corner < 4; ++corner) {
+                cv::Vec3f p;
+                p[axis] = side ? high[axis] : low[axis];
+                p[u] = (corner == 1 || corner == 2) ? high[u] : low[u];
+                p[v] = (corner >= 2) ? high[v] : low[v];
+                vertices.push_back(p);
+            }
+            triangles.emplace_back(first, first + 1, first + 2);
+            triangles.emplace_back(first, first + 2, first + 3);
+        }
+    }
+    return makeMesh(std::move(vertices), std::move(triangles), color);
+}
+
+Mesh sphereMesh(const cv::Vec3f& center, float radius, int rings, int segments, const cv::Scalar& color) {
+    std::vector<cv::Vec3f> vertices;
+    std::vector<cv::Vec3i> triangles;
+    for (int r = 0; r <= rings; ++r) {
+        const double theta = CV_PI * r / rings;
+        for (int s = 0; s <= segments; ++s) {
+            const double phi = 2.0 * CV_PI * s / segments;
+            vertices.push_back(center + radius * cv::Vec3f(static_cast<float>(std::sin(theta) * std::cos(phi)),
+                                                           static_cast<float>(std::sin(theta) * std::sin(phi)),
+                                                           static_cast<float>(std::cos(theta))));
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            const int a = r * (segments + 1) + s, b = a + segments + 1;
+            triangles.emplace_back(a, b, a + 1);
+            triangles.emplace_back(a + 1, b, b + 1);
+        }
+    }
+    return makeMesh(std::move(vertices), std::move(triangles), color);
+}
+
+RasterOptions rasterOptions(const Config& cfg) {
+    RasterOptions options;
+    options.shading = cfg.render_mode == "gouraud" ? Shading::Gouraud : Shading::Flat;
+    return options;
+}
+
+Rasterizer::Rasterizer(const RasterOptions& options) : options_(options) {}
+
+void Rasterizer::begin(cv::Size size) {
+    if (size != size_) {
+        size_ = size;
+        tiles_ = cv::Size((size.width + kTileSize - 1) / kTileSize, (size.height + kTileSize - 1) / kTileSize);
+        bins_.assign(static_cast<size_t>(tiles_.area()), {});
+        depth_.create(size, CV_32F);
+    }
+    for (int tile : busy_tiles_) bins_[tile].clear();
+    busy_tiles_.clear();
+    triangles_.clear();
+    stats_ = RasterStats();
+}
+
+void Rasterizer::draw(const Mesh& mesh, const Camera& camera, const Pose& pose) {
+    stats_.triangles += static_cast<int64_t>(mesh.triangles.size());
+    const cv::Matx33f R = pose.rotation();
+    const cv::Vec3f t = pose.tvec;
+    const size_t n = mesh.vertices.size();
+    camera_points_.resize(n);
+    for (size_t i = 0; i < n; ++i) camera_points_[i] = R * mesh.vertices[i] + t;
+    projectPoints(mesh.vertices, pose, camera, projected_);
+    if (options_.shading == Shading::Gouraud) {
+        lit_.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            lit_[i] = cv::Vec3f(mesh.colors[i]) * lighting(R * mesh.normals[i], options_.ambient);
+        }
+    }
+
+    const cv::Rect frame(0, 0, size_.width, size_.height);
+    for (const cv::Vec3i& index : mesh.triangles) {
+        const cv::Point2f p[3] = {projected_[index[0]], projected_[index[1]], projected_[index[2]]};
+        const cv::Vec3f c[3] = {camera_points_[index[0]], camera_points_[index[1]], camera_points_[index[2]]};
+        const double area = static_cast<double>(p[1].x - p[0].x) * (p[2].y - p[0].y) -
+                            static_cast<double>(p[1].y - p[0].y) * (p[2].x - p[0].x);
+        if (std::min({c[0][2], c[1][2], c[2][2]}) < options_.near || std::abs(area) < 1e-6) {
+            stats_.dropped++;
+            continue;
+        }
+        const float x0 = std::min({p[0].x, p[1].x, p[2].x}), x1 = std::max({p[0].x, p[1].x, p[2].x});
+        const float y0 = std::min({p[0].y, p[1].y, p[2].y}), y1 = std::max({p[0].y, p[1].y, p[2].y});
+        if (!(x1 >= 0 && y1 >= 0 && x0 < size_.width && y0 < size_.height)) {
+            stats_.dropped++;
+            continue;
+        }
+        Triangle tri;
+        tri.bounds = cv::Rect(cv::Point(cvCeil(x0), cvCeil(y0)), cv::Point(cvFloor(x1) + 1, cvFloor(y1) + 1)) & frame;
+        if (tri.bounds.empty()) {
+            stats_.dropped++;
+            continue;
+        }
+
+        // Barycentric weights relative to the top-left pixel of the bounds,
+        // which keeps them accurate far from the image origin
+        const double ox = tri.bounds.x, oy = tri.bounds.y;
+        for (int i = 0; i < 3; ++i) {
+            const cv::Point2f& a = p[(i + 1) % 3];
+            const cv::Point2f& b = p[(i + 2) % 3];
+            tri.wx[i] = static_cast<float>((a.y - b.y) / area);
+            tri.wy[i] = static_cast<float>((b.x - a.x) / area);
+            tri.w0[i] = static_cast<float>(((a.x - ox) * (b.y - oy) - (a.y - oy) * (b.x - ox)) / area);
+            tri.inv_z[i] = 1.0f / c[i][2];
+        }
+        if (options_.shading == Shading::Gouraud) {
+            for (int i = 0; i < 3; ++i) tri.color[i] = lit_[index[i]];
+        } else {
+            const cv::Vec3f normal = cv::normalize((c[1] - c[0]).cross(c[2] - c[0]));
+            const cv::Vec3f base = (cv::Vec3f(mesh.colors[index[0]]) + cv::Vec3f(mesh.colors[index[1]]) +
+                                    cv::Vec3f(mesh.colors[index[2]])) *
+                                   (1.0f / 3.0f);
+            tri.color[0] = tri.color[1] = tri.color[2] = base * lighting(normal, options_.ambient);
+        }
+
+        const uint32_t id = static_cast<uint32_t>(triangles_.size());
+        triangles_.push_back(tri);
+        for (int ty = tri.bounds.y / kTileSize; ty <= (tri.bounds.br().y - 1) / kTileSize; ++ty) {
+            for (int tx = tri.bounds.x / kTileSize; tx <= (tri.bounds.br().x - 1) / kTileSize; ++tx) {
+                std::vector<uint32_t>& bin = bins_[ty * tiles_.width + tx];
+                if (bin.empty()) busy_tiles_.push_back(ty * tiles_.width + tx);
+                bin.push_back(id);
+            }
+        }
+    }
+}
+
+void Rasterizer::render(cv::Mat& frame) {
+    CV_Assert(frame.type() == CV_8UC3 && frame.size() == size_);
+    stats_.tiles = static_cast<int64_t>(busy_tiles_.size());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(busy_tiles_.size())), [&](const cv::Range& range) {
+        for (int k = range.start; k < range.end; ++k) rasterizeTile(busy_tiles_[k], frame);
+    });
+}
+
+void Rasterizer::rasterizeTile(int tile, cv::Mat& frame) {
+    const cv::Rect rect = cv::Rect((tile % tiles_.width) * kTileSize, (tile / tiles_.width) * kTileSize, kTileSize,
+                                   kTileSize) &
+                          cv::Rect(0, 0, size_.width, size_.height);
+    depth_(rect).setTo(0.0f);  // 1/z of a point infinitely far away
+    const bool gouraud = options_.shading == Shading::Gouraud;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    float steps[cv::VTraits<cv::v_float32>::max_nlanes];
+    for (int i = 0; i < lanes; ++i) steps[i] = static_cast<float>(i);
+    const cv::v_float32 v_steps = cv::vx_load(steps);
+    const cv::v_float32 v_zero = cv::vx_setzero_f32(), v_one = cv::vx_setall_f32(1.0f);
+    float l0s[cv::VTraits<cv::v_float32>::max_nlanes], l1s[cv::VTraits<cv::v_float32>::max_nlanes];
+    float hits[cv::VTraits<cv::v_float32>::max_nlanes];
+#endif
+
+    for (uint32_t id : bins_[tile]) {
+        const Triangle& tri = triangles_[id];
+        const cv::Rect area = rect & tri.bounds;
+        if (area.empty()) continue;
+
+        // Write the interpolated color of one covered pixel
+        auto shade = [&](cv::Vec3b& pixel, float l0, float l1) {
+            if (!gouraud) {
+                pixel = cv::Vec3b(cv::saturate_cast<uchar>(tri.color[0][0]), cv::saturate_cast<uchar>(tri.color[0][1]),
+                                  cv::saturate_cast<uchar>(tri.color[0][2]));
+                return;
+            }
+            const float l2 = 1.0f - l0 - l1;
+            const cv::Vec3f c = tri.color[0] * l0 + tri.color[1] * l1 + tri.color[2] * l2;
+            pixel = cv::Vec3b(cv::saturate_cast<uchar>(c[0]), cv::saturate_cast<uchar>(c[1]),
+                              cv::saturate_cast<uchar>(c[2]));
+        };
+
+        for (int y = area.y; y < area.br().y; ++y) {
+            float* z_row = depth_.ptr<float>(y);
+            cv::Vec3b* out = frame.ptr<cv::Vec3b>(y);
+            const float ly = static_cast<float>(y - tri.bounds.y);
+            const float b0 = tri.wy[0] * ly + tri.w0[0];
+            const float b1 = tri.wy[1] * ly + tri.w0[1];
+            const float b2 = tri.wy[2] * ly + tri.w0[2];
+            int x = area.x;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+            const cv::v_float32 wx0 = cv::vx_setall_f32(tri.wx[0]), wx1 = cv::vx_setall_f32(tri.wx[1]);
+            const cv::v_float32 wx2 = cv::vx_setall_f32(tri.wx[2]);
+            const cv::v_float32 vb0 = cv::vx_setall_f32(b0), vb1 = cv::vx_setall_f32(b1), vb2 = cv::vx_setall_f32(b2);
+            const cv::v_float32 iz0 = cv::vx_setall_f32(tri.inv_z[0]), iz1 = cv::vx_setall_f32(tri.inv_z[1]);
+            const cv::v_float32 iz2 = cv::vx_setall_f32(tri.inv_z[2]);
+            for (; x + lanes <= area.br().x; x += lanes) {
+                const cv::v_float32 lx = cv::v_add(cv::vx_setall_f32(static_cast<float>(x - tri.bounds.x)), v_steps);
+                const cv::v_float32 l0 = cv::v_fma(lx, wx0, vb0);
+                const cv::v_float32 l1 = cv::v_fma(lx, wx1, vb1);
+                const cv::v_float32 l2 = cv::v_fma(lx, wx2, vb2);
+                const cv::v_float32 inside =
+                    cv::v_and(cv::v_and(cv::v_ge(l0, v_zero), cv::v_ge(l1, v_zero)), cv::v_ge(l2, v_zero));
+                if (!cv::v_check_any(inside)) continue;
+                const cv::v_float32 inv_z = cv::v_fma(l0, iz0, cv::v_fma(l1, iz1, cv::v_mul(l2, iz2)));
+                const cv::v_float32 old = cv::vx_load(z_row + x);
+                const cv::v_float32 pass = cv::v_and(inside, cv::v_gt(inv_z, old));
+                if (!cv::v_check_any(pass)) continue;
+                cv::v_store(z_row + x, cv::v_select(pass, inv_z, old));
+                cv::v_store(hits, cv::v_select(pass, v_one, v_zero));
+                cv::v_store(l0s, l0);
+                cv::v_store(l1s, l1);
+                for (int i = 0; i < lanes; ++i) {
+                    if (hits[i] != 0.0f) shade(out[x + i], l0s[i], l1s[i]);
+                }
+            }
+#endif
+
+            for (; x < area.br().x; ++x) {
+                const float lx = static_cast<float>(x - tri.bounds.x);
+                const float l0 = tri.wx[0] * lx + b0, l1 = tri.wx[1] * lx + b1, l2 = tri.wx[2] * lx + b2;
+                if (l0 < 0 || l1 < 0 || l2 < 0) continue;
+                const float inv_z = l0 * tri.inv_z[0] + l1 * tri.inv_z[1] + l2 * tri.inv_z[2];
+                if (inv_z <= z_row[x]) continue;
+                z_row[x] = inv_z;
+                shade(out[x], l0, l1);
+            }
+        }
+    }
+}
+
+}  // namespace calib
@@ -0,0 +1,257 @@
+#include "calib/refine.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+#include "calib/distortion.hpp"
+#include "lm_solver.hpp"
+
+namespace calib {
+
+namespace {
+
+constexpr int kPoseParams = 6;  // rvec, tvec
+constexpr int kFocalParams = 4;  // fx, fy, cx, cy
+
+struct State {
+    cv::Vec4d focal;  // fx, fy, cx, cy
+    cv::Mat dist;     // Nx1 CV_64F
+    std::vector<cv::Vec3d> rvecs, tvecs;
+
+    cv::Matx33d cameraMatrix() const { return cv::Matx33d(focal[0], 0, focal[2], 0, focal[1], focal[3], 0, 0, 1); }
+};
+
+// Robust cost and plain sum of squared residuals of every active view,
+// evaluated in parallel
+void evaluate(const std::vector<std::vector<cv::Vec3f>>& object_points,
+              const std::vector<std::vector<cv::Point2f>>& image_points, const State& state,
+              const std::vector<int>& views, const RefineOptions& options, std::vector<double>& cost,
+              std::vector<double>& squared) {
+    cost.assign(views.size(), 0.0);
+    squared.assign(views.size(), 0.0);
+    const cv::Matx33d K = state.cameraMatrix();
+    cv::parallel_for_(cv::Range(0, static_cast<int>(views.size())), [&](const cv::Range& range) {
+        std::vector<cv::Point2d> projected;
+        for (int a = range.start; a < range.end; ++a) {
+            const int v = views[a];
+            cv::projectPoints(object_points[v], state.rvecs[v], state.tvecs[v], K, state.dist, projected);
+            for (size_t j = 0; j < projected.size(); ++j) {
+                double dx = projected[j].x - image_points[v][j].x;
+                double dy = projected[j].y - image_points[v][j].y;
+                double s2 = dx * dx + dy * dy;
+                cost[a] += lm::robustCost(s2, options);
+                squared[a] += s2;
+            }
+        }
+    });
+}
+
+double total(const std::vector<double>& values) {
+    return std::accumulate(values.begin(), values.end(), 0.0);
+}
+
+// Build the normal equations at the current state. The per-view blocks come
+// from the analytic Jacobian of cv::projectPoints, whose columns are ordered
+// rvec, tvec, f, c, distortion, so the refined parameters are a prefix.
+void linearize(const std::vector<std::vector<cv::Vec3f>>& object_points,
+               const std::vector<std::vector<cv::Point2f>>& image_points, const State& state,
+               const std::vector<int>& views, const RefineOptions& options, int intrinsic_params,
+               lm::NormalEquations& lin) {
+    const int n_views = static_cast<int>(views.size());
+    const int used_cols = kPoseParams + intrinsic_params;
+    std::vector<cv::Mat> H(n_views), g(n_views);
+    const cv::Matx33d K = state.cameraMatrix();
+
+    cv::parallel_for_(cv::Range(0, n_views), [&](const cv::Range& range) {
+        std::vector<cv::Point2d> projected;
+        cv::Mat jacobian;
+        for (int a = range.start; a < range.end; ++a) {
+            const int v = views[a];
+            cv::projectPoints(object_points[v], state.rvecs[v], state.tvecs[v], K, state.dist, projected, jacobian);
+
+            // Rows scaled by the square root of the IRLS weight
+            cv::Mat A = jacobian.colRange(0, used_cols).clone();
+            cv::Mat r(A.rows, 1, CV_64F);
+            for (size_t j = 0; j < projected.size(); ++j) {
+                double dx = projected[j].x - image_points[v][j].x;
+                double dy = projected[j].y - image_points[v][j].y;
+                double sw = std::sqrt(lm::robustWeight(dx * dx + dy * dy, options));
+                const int row = static_cast<int>(2 * j);
+                double* ax = A.ptr<double>(row);
+                double* ay = A.ptr<double>(row + 1);
+                for (int k = 0; k < used_cols; ++k) {
+                    ax[k] *= sw;
+                    ay[k] *= sw;
+                }
+                r.at<double>(row) = dx * sw;
+                r.at<double>(row + 1) = dy * sw;
+            }
+            cv::mulTransposed(A, H[a], true);
+            g[a] = A.t() * r;
+        }
+    });
+
+    lin.U = cv::Mat::zeros(intrinsic_params, intrinsic_params, CV_64F);
+    lin.g_c = cv::Mat::zeros(intrinsic_params, 1, CV_64F);
+    lin.V.resize(n_views);
+    lin.W.resize(n_views);
+    lin.g_p.resize(n_views);
+    const cv::Range pose(0, kPoseParams), intr(kPoseParams, used_cols);
+    for (int a = 0; a < n_views; ++a) {
+        lin.U += H[a](intr, intr);
+        lin.g_c += g[a].rowRange(kPoseParams, used_cols);
+        lin.V[a] = H[a](pose, pose);
+        lin.W[a] = H[a](intr, pose);
+        lin.g_p[a] = g[a].rowRange(0, kPoseParams);
+    }
+}
+
+State applyStep(const State& state, const std::vector<int>& views, const cv::Mat& dc, const std::vector<cv::Mat>& dp) {
+    State next = state;
+    next.dist = state.dist.clone();
+    for (int i = 0; i < kFocalParams; ++i) {
+        next.focal[i] += dc.at<double>(i);
+    }
+    for (int i = kFocalParams; i < dc.rows; ++i) {
+        next.dist.at<double>(i - kFocalParams) += dc.at<double>(i);
+    }
+    for (size_t a = 0; a < views.size(); ++a) {
+        const int v = views[a];
+        for (int i = 0; i < 3; ++i) {
+            next.rvecs[v][i] += dp[a].at<double>(i);
+            next.tvecs[v][i] += dp[a].at<double>(i + 3);
+        }
+    }
+    return next;
+}
+
+}  // namespace
+
+RefineOptions refineOptions(const Config& cfg) {
+    RefineOptions options;
+    options.max_iterations = cfg.refine_max_iter;
+    options.loss = cfg.refine_loss == "huber"    ? RobustLoss::Huber
+                   : cfg.refine_loss == "cauchy" ? RobustLoss::Cauchy
+                                                 : RobustLoss::None;
+    options.loss_scale = cfg.refine_loss_scale;
+    options.reject_factor = cfg.refine_reject_factor;
+    return options;
+}
+
+bool refineCalibration(const std::vector<std::vector<cv::Vec3f>>& object_points,
+                       const std::vector<std::vector<cv::Point2f>>& image_points, const RefineOptions& options,
+                       CalibrationResult& result, RefineReport& report) {
+    const int64_t start_ticks = cv::getTickCount();
+    const int n_views = static_cast<int>(image_points.size());
+    if (object_points.size() != image_points.size() || result.rvecs.size() != image_points.size() ||
+        result.tvecs.size() != image_points.size()) {
+        std::cerr << "Error: Refinement needs one pose and one point set per view" << std::endl;
+        return false;
+    }
+
+    if (result.intrinsics.model == DistortionModel::Fisheye) {
+        std::cerr << "Error: Refinement supports the pinhole distortion models only" << std::endl;
+        return false;
+    }
+
+    State state;
+    const cv::Mat& K = result.intrinsics.camera_matrix;
+    state.focal = cv::Vec4d(K.at<double>(0, 0), K.at<double>(1, 1), K.at<double>(0, 2), K.at<double>(1, 2));
+    // Coefficients the model lacks are held at zero in OpenCV's layout
+    const int model_terms = distortionCoefficients(result.intrinsics.model);
+    cv::Mat dist = pinholeCoefficients(result.intrinsics);
+    if (dist.empty()) dist = cv::Mat::zeros(4, 1, CV_64F);
+    dist.convertTo(state.dist, CV_64F);
+    state.dist = state.dist.reshape(1, static_cast<int>(state.dist.total()));
+    for (int v = 0; v < n_views; ++v) {
+        state.rvecs.push_back(cv::Vec3d(result.rvecs[v].reshape(1, 3)));
+        state.tvecs.push_back(cv::Vec3d(result.tvecs[v].reshape(1, 3)));
+    }
+    const int intrinsic_params = kFocalParams + std::min(options.distortion_terms, model_terms);
+
+    std::vector<int> all_views(n_views);
+    std::iota(all_views.begin(), all_views.end(), 0);
+    size_t total_points = 0;
+    for (const auto& points : image_points) total_points += points.size();
+    std::vector<double> cost, squared;
+    evaluate(object_points, image_points, state, all_views, options, cost, squared);
+    report = RefineReport();
+    report.initial_rms = std::sqrt(total(squared) / std::max<size_t>(total_points, 1));
+    report.rejected.assign(n_views, false);
+
+    for (int round = 0;; ++round) {
+        std::vector<int> active;
+        for (int v = 0; v < n_views; ++v) {
+            if (!report.rejected[v]) active.push_back(v);
+        }
+        if (active.size() < kMinCalibrationViews) {
+            std::cerr << "Error: Only " << active.size() << " views left for refinement, at least "
+                      << kMinCalibrationViews << " are required" << std::endl;
+            return false;
+        }
+        report.iterations += lm::levenbergMarquardt(
+            state, options,
+            [&](const State& s) {
+                evaluate(object_points, image_points, s, active, options, cost, squared);
+                return total(cost);
+            },
+            [&](const State& s, lm::NormalEquations& eq) {
+                linearize(object_points, image_points, s, active, options, intrinsic_params, eq);
+            },
+            [&](const State& s, const cv::Mat& dc, const std::vector<cv::Mat>& dp) {
+                return applyStep(s, active, dc, dp);
+            });
+        if (options.reject_factor <= 0 || round >= options.max_reject_rounds) break;
+
+        // Drop views that fit much worse than the typical view
+        evaluate(object_points, image_points, state, active, options, cost, squared);
+        std::vector<double> rms(active.size());
+        for (size_t a = 0; a < active.size(); ++a) {
+            rms[a] = std::sqrt(squared[a] / image_points[active[a]].size());
+        }
+        std::vector<double> sorted = rms;
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        const double threshold = std::max(options.loss_scale, options.reject_factor * sorted[sorted.size() / 2]);
+        std::vector<int> outliers;
+        for (size_t a = 0; a < active.size(); ++a) {
+            if (rms[a] > threshold) outliers.push_back(active[a]);
+        }
+        if (outliers.empty() || active.size() - outliers.size() < kMinCalibrationViews) break;
+        for (int v : outliers) report.rejected[v] = true;
+    }
+
+    // Re-fit rejected views to the final intrinsics so they get a residual too
+    const cv::Matx33d K_final = state.cameraMatrix();
+    for (int v = 0; v < n_views; ++v) {
+        if (report.rejected[v]) {
+            cv::solvePnP(object_points[v], image_points[v], K_final, state.dist, state.rvecs[v], state.tvecs[v], true);
+        }
+    }
+    evaluate(object_points, image_points, state, all_views, options, cost, squared);
+    report.view_rms.resize(n_views);
+    double kept_squared = 0.0;
+    size_t kept_points = 0;
+    for (int v = 0; v < n_views; ++v) {
+        report.view_rms[v] = std::sqrt(squared[v] / std::max<size_t>(image_points[v].size(), 1));
+        if (!report.rejected[v]) {
+            kept_squared += squared[v];
+            kept_points += image_points[v].size();
+        }
+    }
+    report.final_rms = std::sqrt(kept_squared / std::max<size_t>(kept_points, 1));
+
+    result.intrinsics.camera_matrix = cv::Mat(K_final).clone();
+    result.intrinsics.dist_coeffs = model_terms > 0 ? state.dist.rowRange(0, model_terms).clone() : cv::Mat();
+    for (int v = 0; v < n_views; ++v) {
+        result.rvecs[v] = cv::Mat(state.rvecs[v]).clone();
+        result.tvecs[v] = cv::Mat(state.tvecs[v]).clone();
+    }
+    result.reprojection_error = report.final_rms;
+    report.seconds = (cv::getTickCount() - start_ticks) / cv::getTickFrequency();
+    return true;
+}
+
+}  // namespace calib
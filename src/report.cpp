@@ -0,0 +1,421 @@
+#include "calib/report.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "calib/projection.hpp"
+
+namespace calib {
+
+namespace {
+
+std::string escapeJson(const std::string& s) {
+    std::ostringstream out;
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    return out.str();
+}
+
+std::string escapeHtml(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+        }
+    }
+    return out;
+}
+
+// JSON has no NaN or infinity
+std::string number(double v) {
+    if (!std::isfinite(v)) return "null";
+    std::ostringstream out;
+    out << std::setprecision(10) << v;
+    return out.str();
+}
+
+// Fixed-point text for labels, leaving the stream's own format alone
+std::string fixed(double v, int digits) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(digits) << v;
+    return out.str();
+}
+
+template <typename T, typename F>
+void writeArray(std::ostream& out, const std::vector<T>& values, F format) {
+    out << "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        out << (i ? ", " : "") << format(values[i]);
+    }
+    out << "]";
+}
+
+void writeMatrix(std::ostream& out, const cv::Mat& m) {
+    cv::Mat values;
+    m.convertTo(values, CV_64F);
+    values = values.reshape(1, 1);
+    out << "[";
+    for (int i = 0; i < values.cols; ++i) {
+        out << (i ? ", " : "") << number(values.at<double>(i));
+    }
+    out << "]";
+}
+
+// Blue (low) to red (high) for heatmap cells, t in [0, 1]
+std::string heatColor(double t) {
+    t = std::min(std::max(t, 0.0), 1.0);
+    int r = static_cast<int>(255 * std::min(1.0, 2 * t));
+    int b = static_cast<int>(255 * std::min(1.0, 2 * (1 - t)));
+    int g = static_cast<int>(255 * (1 - std::abs(2 * t - 1)) * 0.8);
+    std::ostringstream out;
+    out << "rgb(" << r << "," << g << "," << b << ")";
+    return out.str();
+}
+
+// Heatmap of a grid of cells as an SVG, empty cells (NaN or zero count) grey
+void writeHeatmap(std::ostream& out, const cv::Mat& cells, double max_value, int width) {
+    const double cell = static_cast<double>(width) / cells.cols;
+    out << "<svg width=\"" << width << "\" height=\"" << static_cast<int>(cell * cells.rows) << "\">";
+    for (int y = 0; y < cells.rows; ++y) {
+        for (int x = 0; x < cells.cols; ++x) {
+            double v = cells.at<double>(y, x);
+            bool empty = !std::isfinite(v) || v <= 0;
+            out << "<rect x=\"" << x * cell << "\" y=\"" << y * cell << "\" width=\"" << cell << "\" height=\""
+                << cell << "\" fill=\"" << (empty ? std::string("#ddd") : heatColor(v / max_value))
+                << "\"><title>" << (empty ? std::string("none") : number(v)) << "</title></rect>";
+        }
+    }
+    out << "</svg>";
+}
+
+}  // namespace
+
+StageClock::StageClock() : last_ticks_(cv::getTickCount()) {}
+
+void StageClock::lap(const std::string& name) {
+    int64_t now = cv::getTickCount();
+    stages_.push_back({name, (now - last_ticks_) / cv::getTickFrequency()});
+    last_ticks_ = now;
+}
+
+ReportOptions reportOptions(const Config& cfg) {
+    ReportOptions options;
+    options.grid_columns = cfg.report_grid;
+    options.max_rms = cfg.report_max_rms;
+    options.max_view_rms = cfg.report_max_view_rms;
+    options.min_coverage = cfg.report_min_coverage;
+    return options;
+}
+
+CalibrationReport buildReport(const std::vector<std::vector<cv::Vec3f>>& object_points,
+                              const std::vector<std::vector<cv::Point2f>>& image_points,
+                              const CalibrationResult& result, cv::Size image_size,
+                              const std::vector<std::string>& view_names, const std::vector<bool>& rejected,
+                              const ReportOptions& options) {
+    const int n_views = static_cast<int>(image_points.size());
+    CalibrationReport report;
+    report.image_size = image_size;
+    report.intrinsics = result.intrinsics;
+    report.options = options;
+    report.views = view_names;
+    for (int v = static_cast<int>(report.views.size()); v < n_views; ++v) {
+        report.views.push_back("view " + std::to_string(v + 1));
+    }
+    report.rejected = rejected;
+    report.rejected.resize(n_views, false);
+    report.residuals.resize(n_views);
+    report.view_rms.assign(n_views, 0.0);
+    report.view_max.assign(n_views, 0.0);
+
+    cv::parallel_for_(cv::Range(0, n_views), [&](const cv::Range& range) {
+        std::vector<cv::Point2f> projected;
+        for (int v = range.start; v < range.end; ++v) {
+            projectPoints(object_points[v], result.rvecs[v], result.tvecs[v], result.intrinsics, projected);
+            std::vector<cv::Point2f>& residuals = report.residuals[v];
+            residuals.resize(projected.size());
+            double squared = 0.0, worst = 0.0;
+            for (size_t j = 0; j < projected.size(); ++j) {
+                residuals[j] = projected[j] - image_points[v][j];
+                double s2 = residuals[j].dot(residuals[j]);
+                squared += s2;
+                worst = std::max(worst, s2);
+            }
+            report.view_rms[v] = std::sqrt(squared / std::max<size_t>(projected.size(), 1));
+            report.view_max[v] = std::sqrt(worst);
+        }
+    });
+
+    // Per-corner residuals and the coverage grid, over the kept views
+    const int cols = std::max(1, options.grid_columns);
+    const int rows = std::max(1, static_cast<int>(std::lround(cols * static_cast<double>(image_size.height) /
+                                                               std::max(image_size.width, 1))));
+    report.coverage = cv::Mat::zeros(rows, cols, CV_32S);
+    cv::Mat error_sum = cv::Mat::zeros(rows, cols, CV_64F);
+    std::vector<double> corner_squared;
+    std::vector<int> corner_count;
+    double total_squared = 0.0;
+    size_t total_points = 0;
+    for (int v = 0; v < n_views; ++v) {
+        if (report.rejected[v]) continue;
+        const auto& residuals = report.residuals[v];
+        if (corner_squared.size() < residuals.size()) {
+            corner_squared.resize(residuals.size(), 0.0);
+            corner_count.resize(residuals.size(), 0);
+        }
+        for (size_t j = 0; j < residuals.size(); ++j) {
+            double s2 = residuals[j].dot(residuals[j]);
+            corner_squared[j] += s2;
+            corner_count[j]++;
+            total_squared += s2;
+            total_points++;
+
+            const cv::Point2f& p = image_points[v][j];
+            int cx = std::min(cols - 1, std::max(0, static_cast<int>(p.x * cols / image_size.width)));
+            int cy = std::min(rows - 1, std::max(0, static_cast<int>(p.y * rows / image_size.height)));
+            report.coverage.at<int>(cy, cx)++;
+            error_sum.at<double>(cy, cx) += std::sqrt(s2);
+        }
+    }
+    report.rms = std::sqrt(total_squared / std::max<size_t>(total_points, 1));
+    for (size_t j = 0; j < corner_squared.size(); ++j) {
+        report.corner_rms.push_back(std::sqrt(corner_squared[j] / std::max(corner_count[j], 1)));
+    }
+    report.cell_error.create(rows, cols, CV_64F);
+    int covered = 0;
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            int count = report.coverage.at<int>(y, x);
+            covered += count > 0;
+            report.cell_error.at<double>(y, x) =
+                count > 0 ? error_sum.at<double>(y, x) / count : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    report.coverage_fraction = static_cast<double>(covered) / (rows * cols);
+
+    // Quality gates
+    std::ostringstream message;
+    if (options.max_rms > 0 && report.rms > options.max_rms) {
+        message << "RMS reprojection error " << report.rms << " px exceeds " << options.max_rms << " px";
+        report.failures.push_back(message.str());
+    }
+    if (options.max_view_rms > 0) {
+        for (int v = 0; v < n_views; ++v) {
+            if (!report.rejected[v] && report.view_rms[v] > options.max_view_rms) {
+                message.str("");
+                message << report.views[v] << ": RMS " << report.view_rms[v] << " px exceeds "
+                        << options.max_view_rms << " px";
+                report.failures.push_back(message.str());
+            }
+        }
+    }
+    if (options.min_coverage > 0 && report.coverage_fraction < options.min_coverage) {
+        message.str("");
+        message << "Corners cover " << report.coverage_fraction * 100 << "% of the image, below "
+                << options.min_coverage * 100 << "%";
+        report.failures.push_back(message.str());
+    }
+    return report;
+}
+
+bool writeReportJson(const std::string& path, const CalibrationReport& report) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    out << "{\n";
+    out << "  \"image_size\": [" << report.image_size.width << ", " << report.image_size.height << "],\n";
+    out << "  \"camera_matrix\": ";
+    writeMatrix(out, report.intrinsics.camera_matrix);
+    out << ",\n  \"distortion_model\": \"" << distortionModelName(report.intrinsics.model) << "\"";
+    out << ",\n  \"dist_coeffs\": ";
+    writeMatrix(out, report.intrinsics.dist_coeffs);
+    out << ",\n  \"rms\": " << number(report.rms) << ",\n";
+
+    out << "  \"views\": [\n";
+    for (size_t v = 0; v < report.views.size(); ++v) {
+        out << "    {\"name\": \"" << escapeJson(report.views[v]) << "\", \"rms\": " << number(report.view_rms[v])
+            << ", \"max\": " << number(report.view_max[v]) << ", \"rejected\": "
+            << (report.rejected[v] ? "true" : "false") << ", \"residuals\": ";
+        writeArray(out, report.residuals[v],
+                   [](const cv::Point2f& r) { return "[" + number(r.x) + ", " + number(r.y) + "]"; });
+        out << "}" << (v + 1 < report.views.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+
+    out << "  \"corner_rms\": ";
+    writeArray(out, report.corner_rms, number);
+    out << ",\n  \"coverage\": {\"columns\": " << report.coverage.cols << ", \"rows\": " << report.coverage.rows
+        << ", \"fraction\": " << number(report.coverage_fraction) << ", \"counts\": ";
+    writeMatrix(out, report.coverage);
+    out << ", \"mean_error\": ";
+    writeMatrix(out, report.cell_error);
+    out << "},\n";
+
+    out << "  \"timings\": [";
+    for (size_t i = 0; i < report.timings.size(); ++i) {
+        out << (i ? ", " : "") << "{\"stage\": \"" << escapeJson(report.timings[i].name)
+            << "\", \"seconds\": " << number(report.timings[i].seconds) << "}";
+    }
+    out << "],\n";
+
+    const ReportOptions& o = report.options;
+    out << "  \"gates\": {\"max_rms\": " << number(o.max_rms) << ", \"max_view_rms\": " << number(o.max_view_rms)
+        << ", \"min_coverage\": " << number(o.min_coverage) << ", \"passed\": "
+        << (report.passed() ? "true" : "false") << ", \"failures\": ";
+    writeArray(out, report.failures, [](const std::string& s) { return "\"" + escapeJson(s) + "\""; });
+    out << "}\n}\n";
+    return static_cast<bool>(out);
+}
+
+bool writeReportHtml(const std::string& path, const CalibrationReport& report) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    const int kChartWidth = 720;
+    out << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Calibration report</title>\n"
+        << "<style>body{font-family:sans-serif;margin:2em;max-width:" << kChartWidth + 80 << "px}"
+        << "table{border-collapse:collapse}td,th{border:1px solid #ccc;padding:2px 8px;text-align:right}"
+        << "td:first-child{text-align:left}.fail{color:#b00}.pass{color:#080}"
+        << ".rejected{color:#999}</style></head><body>\n";
+
+    out << "<h1>Calibration report</h1>\n";
+    out << "<p class=\"" << (report.passed() ? "pass\">All quality gates passed" : "fail\">Quality gates failed")
+        << "</p>\n";
+    if (!report.passed()) {
+        out << "<ul class=\"fail\">";
+        for (const auto& failure : report.failures) out << "<li>" << escapeHtml(failure) << "</li>";
+        out << "</ul>\n";
+    }
+
+    std::ostringstream K, D;
+    K << report.intrinsics.camera_matrix;
+    D << report.intrinsics.dist_coeffs.t();
+    out << "<table><tr><td>Image size</td><td>" << report.image_size.width << " x " << report.image_size.height
+        << "</td></tr><tr><td>RMS reprojection error</td><td>" << number(report.rms) << " px</td></tr>"
+        << "<tr><td>Views</td><td>" << report.views.size() << "</td></tr>"
+        << "<tr><td>Coverage</td><td>" << fixed(report.coverage_fraction * 100, 1)
+        << "% of " << report.coverage.cols << " x " << report.coverage.rows << " cells</td></tr>"
+        << "<tr><td>Camera matrix</td><td><pre>" << escapeHtml(K.str()) << "</pre></td></tr>"
+        << "<tr><td>Distortion (" << distortionModelName(report.intrinsics.model) << ")</td><td><pre>" << escapeHtml(D.str()) << "</pre></td></tr></table>\n";
+
+    // Per-view RMS as bars, with the gate as a line
+    double max_view = report.options.max_view_rms;
+    for (double e : report.view_rms) max_view = std::max(max_view, e);
+    max_view = std::max(max_view, 1e-6);
+    const int bar_height = 16;
+    out << "<h2>Per-view reprojection error</h2>\n<svg width=\"" << kChartWidth << "\" height=\""
+        << bar_height * report.views.size() + 4 << "\">";
+    const int label_width = 240;
+    const double scale = (kChartWidth - label_width - 60) / max_view;
+    for (size_t v = 0; v < report.views.size(); ++v) {
+        const bool bad = report.options.max_view_rms > 0 && report.view_rms[v] > report.options.max_view_rms;
+        const std::string color = report.rejected[v] ? "#bbb" : bad ? "#c33" : "#48c";
+        const double y = v * bar_height;
+        std::string name = report.views[v];
+        if (name.size() > 36) name = "..." + name.substr(name.size() - 33);
+        out << "<text x=\"0\" y=\"" << y + 12 << "\" font-size=\"11\">" << escapeHtml(name) << "</text>"
+            << "<rect x=\"" << label_width << "\" y=\"" << y + 2 << "\" width=\"" << report.view_rms[v] * scale
+            << "\" height=\"" << bar_height - 4 << "\" fill=\"" << color << "\"><title>"
+            << number(report.view_rms[v]) << " px, max " << number(report.view_max[v]) << " px</title></rect>"
+            << "<text x=\"" << label_width + report.view_rms[v] * scale + 4 << "\" y=\"" << y + 12
+            << "\" font-size=\"10\">" << fixed(report.view_rms[v], 3) << "</text>";
+    }
+    if (report.options.max_view_rms > 0) {
+        const double x = label_width + report.options.max_view_rms * scale;
+        out << "<line x1=\"" << x << "\" y1=\"0\" x2=\"" << x << "\" y2=\"" << bar_height * report.views.size()
+            << "\" stroke=\"#c33\" stroke-dasharray=\"4\"/>";
+    }
+    out << "</svg>\n";
+
+    // Residual vectors of every kept corner, magnified to be visible
+    double max_residual = 1e-6;
+    for (size_t v = 0; v < report.residuals.size(); ++v) {
+        if (report.rejected[v]) continue;
+        for (const auto& r : report.residuals[v]) max_residual = std::max<double>(max_residual, std::hypot(r.x, r.y));
+    }
+    const int plot = 360;
+    out << "<h2>Corner residuals</h2>\n<p>Every corner's residual (projected - detected); the circle is "
+        << number(max_residual) << " px.</p>\n<svg width=\"" << plot << "\" height=\"" << plot << "\">"
+        << "<circle cx=\"" << plot / 2 << "\" cy=\"" << plot / 2 << "\" r=\"" << plot / 2 - 2
+        << "\" fill=\"none\" stroke=\"#ccc\"/><line x1=\"0\" y1=\"" << plot / 2 << "\" x2=\"" << plot << "\" y2=\""
+        << plot / 2 << "\" stroke=\"#eee\"/><line x1=\"" << plot / 2 << "\" y1=\"0\" x2=\"" << plot / 2
+        << "\" y2=\"" << plot << "\" stroke=\"#eee\"/>";
+    const double r_scale = (plot / 2 - 2) / max_residual;
+    for (size_t v = 0; v < report.residuals.size(); ++v) {
+        if (report.rejected[v]) continue;
+        for (const auto& r : report.residuals[v]) {
+            out << "<circle cx=\"" << plot / 2 + r.x * r_scale << "\" cy=\"" << plot / 2 + r.y * r_scale
+                << "\" r=\"1.5\" fill=\"#48c\" fill-opacity=\"0.5\"/>";
+        }
+    }
+    out << "</svg>\n";
+
+    // Coverage and residual heatmaps over the sensor
+    cv::Mat counts;
+    report.coverage.convertTo(counts, CV_64F);
+    double max_count = 1.0, max_error = 1e-6;
+    cv::minMaxLoc(counts, nullptr, &max_count);
+    for (int y = 0; y < report.cell_error.rows; ++y) {
+        for (int x = 0; x < report.cell_error.cols; ++x) {
+            double e = report.cell_error.at<double>(y, x);
+            if (std::isfinite(e)) max_error = std::max(max_error, e);
+        }
+    }
+    out << "<h2>Corner coverage</h2>\n<p>Detected corners per cell (grey: none, red: up to "
+        << static_cast<int>(max_count) << ").</p>\n";
+    writeHeatmap(out, counts, std::max(max_count, 1.0), kChartWidth);
+    out << "\n<h2>Residual by image region</h2>\n<p>Mean corner residual per cell (red: "
+        << number(max_error) << " px).</p>\n";
+    writeHeatmap(out, report.cell_error, max_error, kChartWidth);
+
+    // Per-corner RMS and stage timing tables
+    out << "\n<h2>Per-corner RMS</h2>\n<p>";
+    for (size_t j = 0; j < report.corner_rms.size(); ++j) {
+        out << (j ? ", " : "") << fixed(report.corner_rms[j], 3);
+    }
+    out << "</p>\n<h2>Timing</h2>\n<table><tr><th>Stage</th><th>Seconds</th></tr>";
+    for (const auto& stage : report.timings) {
+        out << "<tr><td>" << escapeHtml(stage.name) << "</td><td>" << fixed(stage.seconds, 4) << "</td></tr>";
+    }
+    out << "</table>\n</body></html>\n";
+    return static_cast<bool>(out);
+}
+
+bool writeReport(const std::string& base, const CalibrationReport& report) {
+    return writeReportJson(base + ".json", report) && writeReportHtml(base + ".html", report);
+}
+
+void printReportSummary(std::ostream& out, const CalibrationReport& report) {
+    out << "Quality report: RMS " << report.rms << " px over " << report.views.size() << " views, corners cover "
+        << report.coverage_fraction * 100 << "% of the image, "
+        << (report.passed() ? "all gates passed" : "gates FAILED") << std::endl;
+    for (const auto& failure : report.failures) {
+        out << "  " << failure << std::endl;
+    }
+}
+
+}  // namespace calib
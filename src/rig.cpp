@@ -0,0 +1,528 @@
+#include "calib/rig.hpp"
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+
+#include "calib/board.hpp"
+#include "calib/detect.hpp"
+#include "calib/distortion.hpp"
+#include "lm_solver.hpp"
+
+namespace calib {
+
+namespace {
+
+constexpr int kPoseParams = 6;
+constexpr int kFocalParams = 4;
+
+// Everything the joint adjustment estimates. Camera 0 defines the rig frame,
+// so its extrinsics stay at identity and are not parameters.
+struct RigState {
+    std::vector<cv::Vec4d> focal;  // per camera: fx, fy, cx, cy
+    std::vector<cv::Mat> dist;     // per camera: Nx1 CV_64F
+    std::vector<cv::Vec3d> cam_r, cam_t;      // per camera: camera 0 -> camera
+    std::vector<cv::Vec3d> board_r, board_t;  // per frame set: board -> camera 0
+};
+
+// Where each camera's parameters sit in the shared parameter vector
+struct Layout {
+    std::vector<int> intr_offset, intr_size, extr_offset;  // extr_offset is -1 for camera 0
+    int shared = 0;
+};
+
+cv::Matx33d cameraMatrix(const cv::Vec4d& f) {
+    return cv::Matx33d(f[0], 0, f[2], 0, f[1], f[3], 0, 0, 1);
+}
+
+class JointProblem {
+public:
+    JointProblem(const RigObservations& obs, const std::vector<cv::Vec3f>& board, const RefineOptions& options,
+                 const std::vector<int>& frames, const Layout& layout)
+        : obs_(obs), board_(board), options_(options), frames_(frames), layout_(layout) {}
+
+    // Robust cost; squared and points collect the plain squared error and
+    // number of corners per camera
+    double cost(const RigState& s, std::vector<double>* squared = nullptr, std::vector<size_t>* points = nullptr) const {
+        const size_t n_cameras = obs_.cameras.size();
+        std::vector<double> frame_cost(frames_.size(), 0.0);
+        std::vector<std::vector<double>> frame_squared(frames_.size(), std::vector<double>(n_cameras, 0.0));
+        cv::parallel_for_(cv::Range(0, static_cast<int>(frames_.size())), [&](const cv::Range& range) {
+            std::vector<cv::Point2d> projected;
+            for (int a = range.start; a < range.end; ++a) {
+                for (size_t c = 0; c < n_cameras; ++c) {
+                    const auto& corners = obs_.corners[c][frames_[a]];
+                    if (corners.empty()) continue;
+                    cv::Vec3d r, t;
+                    cv::composeRT(s.board_r[a], s.board_t[a], s.cam_r[c], s.cam_t[c], r, t);
+                    cv::projectPoints(board_, r, t, cameraMatrix(s.focal[c]), s.dist[c], projected);
+                    for (size_t j = 0; j < projected.size(); ++j) {
+                        double dx = projected[j].x - corners[j].x, dy = projected[j].y - corners[j].y;
+                        double s2 = dx * dx + dy * dy;
+                        frame_cost[a] += lm::robustCost(s2, options_);
+                        frame_squared[a][c] += s2;
+                    }
+                }
+            }
+        });
+        if (squared && points) {
+            squared->assign(n_cameras, 0.0);
+            points->assign(n_cameras, 0);
+            for (size_t a = 0; a < frames_.size(); ++a) {
+                for (size_t c = 0; c < n_cameras; ++c) {
+                    (*squared)[c] += frame_squared[a][c];
+                    (*points)[c] += obs_.corners[c][frames_[a]].size();
+                }
+            }
+        }
+        return std::accumulate(frame_cost.begin(), frame_cost.end(), 0.0);
+    }
+
+    // Normal equations. Each frame set owns its pose block, so frame sets
+    // are linearized in parallel; the shared block is summed per thread.
+    void linearize(const RigState& s, lm::NormalEquations& eq) const {
+        const int n_frames = static_cast<int>(frames_.size());
+        const int G = layout_.shared;
+        eq.U = cv::Mat::zeros(G, G, CV_64F);
+        eq.g_c = cv::Mat::zeros(G, 1, CV_64F);
+        eq.V.assign(n_frames, cv::Mat());
+        eq.W.assign(n_frames, cv::Mat());
+        eq.g_p.assign(n_frames, cv::Mat());
+        std::mutex shared_mutex;
+
+        cv::parallel_for_(cv::Range(0, n_frames), [&](const cv::Range& range) {
+            cv::Mat U = cv::Mat::zeros(G, G, CV_64F), g_c = cv::Mat::zeros(G, 1, CV_64F);
+            std::vector<cv::Point2d> projected;
+            cv::Mat jacobian;
+            for (int a = range.start; a < range.end; ++a) {
+                cv::Mat V = cv::Mat::zeros(kPoseParams, kPoseParams, CV_64F);
+                cv::Mat W = cv::Mat::zeros(G, kPoseParams, CV_64F);
+                cv::Mat g_p = cv::Mat::zeros(kPoseParams, 1, CV_64F);
+                for (size_t c = 0; c < obs_.cameras.size(); ++c) {
+                    const auto& corners = obs_.corners[c][frames_[a]];
+                    if (corners.empty()) continue;
+                    accumulate(s, static_cast<int>(c), a, corners, projected, jacobian, U, g_c, V, W, g_p);
+                }
+                eq.V[a] = V;
+                eq.W[a] = W;
+                eq.g_p[a] = g_p;
+            }
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            eq.U += U;
+            eq.g_c += g_c;
+        });
+    }
+
+    RigState apply(const RigState& s, const cv::Mat& dc, const std::vector<cv::Mat>& dp) const {
+        RigState next = s;
+        for (size_t c = 0; c < s.focal.size(); ++c) {
+            const int o = layout_.intr_offset[c];
+            next.dist[c] = s.dist[c].clone();
+            for (int i = 0; i < kFocalParams; ++i) next.focal[c][i] += dc.at<double>(o + i);
+            for (int i = kFocalParams; i < layout_.intr_size[c]; ++i) {
+                next.dist[c].at<double>(i - kFocalParams) += dc.at<double>(o + i);
+            }
+            if (layout_.extr_offset[c] >= 0) {
+                const int e = layout_.extr_offset[c];
+                for (int i = 0; i < 3; ++i) {
+                    next.cam_r[c][i] += dc.at<double>(e + i);
+                    next.cam_t[c][i] += dc.at<double>(e + 3 + i);
+                }
+            }
+        }
+        for (size_t a = 0; a < dp.size(); ++a) {
+            for (int i = 0; i < 3; ++i) {
+                next.board_r[a][i] += dp[a].at<double>(i);
+                next.board_t[a][i] += dp[a].at<double>(i + 3);
+            }
+        }
+        return next;
+    }
+
+private:
+    // Add one camera's view of one frame set. The camera sees the board
+    // through the composition of the board pose and the camera extrinsics,
+    // so the projectPoints pose Jacobian is chained through composeRT.
+    void accumulate(const RigState& s, int c, int a, const std::vector<cv::Point2f>& corners,
+                    std::vector<cv::Point2d>& projected, cv::Mat& jacobian, cv::Mat& U, cv::Mat& g_c, cv::Mat& V,
+                    cv::Mat& W, cv::Mat& g_p) const {
+        cv::Vec3d r, t;
+        cv::Mat dr3dr1, dr3dt1, dr3dr2, dr3dt2, dt3dr1, dt3dt1, dt3dr2, dt3dt2;
+        cv::composeRT(s.board_r[a], s.board_t[a], s.cam_r[c], s.cam_t[c], r, t, dr3dr1, dr3dt1, dr3dr2, dr3dt2,
+                      dt3dr1, dt3dt1, dt3dr2, dt3dt2);
+        cv::projectPoints(board_, r, t, cameraMatrix(s.focal[c]), s.dist[c], projected, jacobian);
+
+        cv::Mat d_board, d_camera, top, bottom;
+        cv::hconcat(dr3dr1, dr3dt1, top);
+        cv::hconcat(dt3dr1, dt3dt1, bottom);
+        cv::vconcat(top, bottom, d_board);
+        cv::hconcat(dr3dr2, dr3dt2, top);
+        cv::hconcat(dt3dr2, dt3dt2, bottom);
+        cv::vconcat(top, bottom, d_camera);
+
+        const cv::Mat J_rt = jacobian.colRange(0, kPoseParams);
+        const int m = layout_.intr_size[c];
+        const bool has_extr = layout_.extr_offset[c] >= 0;
+        cv::Mat J_pose = J_rt * d_board;
+        cv::Mat B(jacobian.rows, m + (has_extr ? kPoseParams : 0), CV_64F);
+        jacobian.colRange(kPoseParams, kPoseParams + m).copyTo(B.colRange(0, m));
+        if (has_extr) {
+            cv::Mat J_ext = J_rt * d_camera;
+            J_ext.copyTo(B.colRange(m, m + kPoseParams));
+        }
+
+        cv::Mat r_w(jacobian.rows, 1, CV_64F);
+        for (size_t j = 0; j < corners.size(); ++j) {
+            double dx = projected[j].x - corners[j].x, dy = projected[j].y - corners[j].y;
+            double sw = std::sqrt(lm::robustWeight(dx * dx + dy * dy, options_));
+            for (int row = static_cast<int>(2 * j); row < static_cast<int>(2 * j + 2); ++row) {
+                double* bp = B.ptr<double>(row);
+                double* pp = J_pose.ptr<double>(row);
+                for (int k = 0; k < B.cols; ++k) bp[k] *= sw;
+                for (int k = 0; k < kPoseParams; ++k) pp[k] *= sw;
+            }
+            r_w.at<double>(static_cast<int>(2 * j)) = dx * sw;
+            r_w.at<double>(static_cast<int>(2 * j + 1)) = dy * sw;
+        }
+
+        // Scatter into the shared parameter layout
+        std::vector<int> index(B.cols);
+        for (int i = 0; i < m; ++i) index[i] = layout_.intr_offset[c] + i;
+        for (int i = m; i < B.cols; ++i) index[i] = layout_.extr_offset[c] + i - m;
+        cv::Mat BtB = B.t() * B, Btr = B.t() * r_w, BtP = B.t() * J_pose;
+        for (int i = 0; i < B.cols; ++i) {
+            for (int k = 0; k < B.cols; ++k) U.at<double>(index[i], index[k]) += BtB.at<double>(i, k);
+            for (int k = 0; k < kPoseParams; ++k) W.at<double>(index[i], k) += BtP.at<double>(i, k);
+            g_c.at<double>(index[i]) += Btr.at<double>(i);
+        }
+        V += J_pose.t() * J_pose;
+        g_p += J_pose.t() * r_w;
+    }
+
+    const RigObservations& obs_;
+    const std::vector<cv::Vec3f>& board_;
+    const RefineOptions& options_;
+    const std::vector<int>& frames_;
+    const Layout& layout_;
+};
+
+size_t sharedViews(const RigObservations& obs, size_t a, size_t b) {
+    size_t n = 0;
+    for (size_t f = 0; f < obs.frame_sets.size(); ++f) {
+        if (!obs.corners[a][f].empty() && !obs.corners[b][f].empty()) n++;
+    }
+    return n;
+}
+
+}  // namespace
+
+size_t RigObservations::views(size_t camera) const {
+    return static_cast<size_t>(std::count_if(corners[camera].begin(), corners[camera].end(),
+                                             [](const std::vector<cv::Point2f>& c) { return !c.empty(); }));
+}
+
+bool detectRig(const std::vector<std::string>& camera_dirs, const Config& cfg, RigObservations& observations) {
+    namespace fs = std::filesystem;
+    observations = RigObservations();
+    observations.cameras = camera_dirs;
+
+    // Frame sets are matched by file name across the camera directories
+    std::vector<std::map<std::string, std::string>> files(camera_dirs.size());
+    std::map<std::string, int> frame_index;
+    for (size_t c = 0; c < camera_dirs.size(); ++c) {
+        std::vector<std::string> images = listImages(camera_dirs[c]);
+        if (images.empty()) {
+            std::cerr << "Error: No images found in " << camera_dirs[c] << std::endl;
+            return false;
+        }
+        for (const std::string& path : images) {
+            std::string name = fs::path(path).filename().string();
+            files[c][name] = path;
+            frame_index[name] = 0;
+        }
+    }
+    for (auto& entry : frame_index) {
+        entry.second = static_cast<int>(observations.frame_sets.size());
+        observations.frame_sets.push_back(entry.first);
+    }
+
+    struct Job {
+        int camera, frame;
+        std::string path;
+    };
+    std::vector<Job> jobs;
+    for (size_t c = 0; c < files.size(); ++c) {
+        for (const auto& file : files[c]) {
+            jobs.push_back({static_cast<int>(c), frame_index[file.first], file.second});
+        }
+    }
+
+    observations.corners.assign(camera_dirs.size(),
+                                std::vector<std::vector<cv::Point2f>>(observations.frame_sets.size()));
+    observations.image_sizes.assign(camera_dirs.size(), cv::Size());
+    std::mutex size_mutex;
+    bool sizes_match = true;
+    cv::parallel_for_(cv::Range(0, static_cast<int>(jobs.size())), [&](const cv::Range& range) {
+        cv::Mat gray;
+        for (int i = range.start; i < range.end; ++i) {
+            const Job& job = jobs[i];
+            cv::Mat image = cv::imread(job.path);
+            if (image.empty()) {
+                std::cerr << "Error: Could not load image at " << job.path << std::endl;
+                continue;
+            }
+            toGray(image, gray);
+            {
+                std::lock_guard<std::mutex> lock(size_mutex);
+                cv::Size& size = observations.image_sizes[job.camera];
+                if (size.empty()) size = gray.size();
+                sizes_match = sizes_match && size == gray.size();
+            }
+            std::vector<cv::Point2f> corners;
+            if (detectBoard(gray, cfg, corners)) {
+                observations.corners[job.camera][job.frame] = std::move(corners);
+            }
+        }
+    });
+    if (!sizes_match) {
+        std::cerr << "Error: Images of one camera must all have the same size" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool calibrateRig(const RigObservations& obs, const std::vector<cv::Vec3f>& board_points, DistortionModel model,
+                  const RefineOptions& options, RigCalibration& rig) {
+    const size_t n_cameras = obs.cameras.size();
+    const size_t n_frames = obs.frame_sets.size();
+    rig = RigCalibration();
+    rig.names = obs.cameras;
+    rig.cameras.resize(n_cameras);
+    if (n_cameras < 2) {
+        std::cerr << "Error: A rig needs at least two cameras" << std::endl;
+        return false;
+    }
+    if (model == DistortionModel::Fisheye) {
+        std::cerr << "Error: Rig calibration supports the pinhole distortion models only" << std::endl;
+        return false;
+    }
+
+    // Per-camera calibration gives intrinsics and a board pose per view
+    std::vector<std::vector<cv::Vec3d>> view_r(n_cameras, std::vector<cv::Vec3d>(n_frames));
+    std::vector<std::vector<cv::Vec3d>> view_t(n_cameras, std::vector<cv::Vec3d>(n_frames));
+    for (size_t c = 0; c < n_cameras; ++c) {
+        std::vector<std::vector<cv::Vec3f>> object_points;
+        std::vector<std::vector<cv::Point2f>> image_points;
+        std::vector<size_t> frames;
+        for (size_t f = 0; f < n_frames; ++f) {
+            if (obs.corners[c][f].empty()) continue;
+            object_points.push_back(board_points);
+            image_points.push_back(obs.corners[c][f]);
+            frames.push_back(f);
+        }
+        if (image_points.size() < kMinCalibrationViews) {
+            std::cerr << "Error: Camera " << obs.cameras[c] << " saw the board in " << image_points.size()
+                      << " images, at least " << kMinCalibrationViews << " are required" << std::endl;
+            return false;
+        }
+        CalibrationResult single = calibrate(object_points, image_points, obs.image_sizes[c],
+                                             initialIntrinsics(obs.image_sizes[c], model));
+        rig.cameras[c].intrinsics = single.intrinsics;
+        rig.cameras[c].image_size = obs.image_sizes[c];
+        for (size_t i = 0; i < frames.size(); ++i) {
+            view_r[c][frames[i]] = cv::Vec3d(single.rvecs[i].reshape(1, 3));
+            view_t[c][frames[i]] = cv::Vec3d(single.tvecs[i].reshape(1, 3));
+        }
+    }
+
+    // Chain stereo calibrations outwards from camera 0, always through the
+    // pair with the most shared frame sets
+    std::vector<bool> solved(n_cameras, false);
+    solved[0] = true;
+    for (size_t round = 1; round < n_cameras; ++round) {
+        size_t best_from = 0, best_to = 0, best_shared = 0;
+        for (size_t a = 0; a < n_cameras; ++a) {
+            if (!solved[a]) continue;
+            for (size_t b = 0; b < n_cameras; ++b) {
+                if (solved[b]) continue;
+                size_t shared = sharedViews(obs, a, b);
+                if (shared > best_shared) {
+                    best_from = a;
+                    best_to = b;
+                    best_shared = shared;
+                }
+            }
+        }
+        if (best_shared == 0) {
+            std::cerr << "Error: Some cameras share no frame sets with the rest of the rig" << std::endl;
+            return false;
+        }
+
+        std::vector<std::vector<cv::Vec3f>> object_points;
+        std::vector<std::vector<cv::Point2f>> points_a, points_b;
+        for (size_t f = 0; f < n_frames; ++f) {
+            if (obs.corners[best_from][f].empty() || obs.corners[best_to][f].empty()) continue;
+            object_points.push_back(board_points);
+            points_a.push_back(obs.corners[best_from][f]);
+            points_b.push_back(obs.corners[best_to][f]);
+        }
+        // Intrinsics are fixed; copies keep stereoCalibrate from writing to
+        // them. The coefficients go in OpenCV's pinhole layout.
+        cv::Mat K_a = rig.cameras[best_from].intrinsics.camera_matrix.clone();
+        cv::Mat D_a = pinholeCoefficients(rig.cameras[best_from].intrinsics).clone();
+        cv::Mat K_b = rig.cameras[best_to].intrinsics.camera_matrix.clone();
+        cv::Mat D_b = pinholeCoefficients(rig.cameras[best_to].intrinsics).clone();
+        cv::Mat R_ab, t_ab, E, F;
+        cv::stereoCalibrate(object_points, points_a, points_b, K_a, D_a, K_b, D_b, obs.image_sizes[best_to], R_ab, t_ab,
+                            E, F, cv::CALIB_FIX_INTRINSIC);
+        cv::Matx33d R_rel(R_ab);
+        cv::Vec3d t_rel(t_ab.reshape(1, 3));
+        RigCamera& from = rig.cameras[best_from];
+        RigCamera& to = rig.cameras[best_to];
+        to.R = R_rel * from.R;
+        to.t = R_rel * from.t + t_rel;
+        solved[best_to] = true;
+    }
+
+    // Board pose in the rig frame for every frame set, from the first camera
+    // that saw it
+    std::vector<int> frames;
+    RigState state;
+    for (size_t f = 0; f < n_frames; ++f) {
+        for (size_t c = 0; c < n_cameras; ++c) {
+            if (obs.corners[c][f].empty()) continue;
+            cv::Matx33d R_view;
+            cv::Rodrigues(view_r[c][f], R_view);
+            const RigCamera& cam = rig.cameras[c];
+            cv::Matx33d R_board = cam.R.t() * R_view;
+            cv::Vec3d t_board = cam.R.t() * (view_t[c][f] - cam.t);
+            cv::Vec3d r_board;
+            cv::Rodrigues(R_board, r_board);
+            frames.push_back(static_cast<int>(f));
+            state.board_r.push_back(r_board);
+            state.board_t.push_back(t_board);
+            break;
+        }
+    }
+
+    Layout layout;
+    const int model_terms = distortionCoefficients(model);
+    for (size_t c = 0; c < n_cameras; ++c) {
+        const Intrinsics& intr = rig.cameras[c].intrinsics;
+        const cv::Mat& K = intr.camera_matrix;
+        // Coefficients the model lacks are held at zero in OpenCV's layout
+        cv::Mat dist = pinholeCoefficients(intr);
+        if (dist.empty()) dist = cv::Mat::zeros(4, 1, CV_64F);
+        dist.convertTo(dist, CV_64F);
+        dist = dist.reshape(1, static_cast<int>(dist.total()));
+        state.focal.emplace_back(K.at<double>(0, 0), K.at<double>(1, 1), K.at<double>(0, 2), K.at<double>(1, 2));
+        state.dist.push_back(dist);
+        cv::Vec3d r;
+        cv::Rodrigues(rig.cameras[c].R, r);
+        state.cam_r.push_back(r);
+        state.cam_t.push_back(rig.cameras[c].t);
+
+        layout.intr_offset.push_back(layout.shared);
+        layout.intr_size.push_back(kFocalParams + std::min(options.distortion_terms, model_terms));
+        layout.shared += layout.intr_size.back();
+    }
+    layout.extr_offset.push_back(-1);
+    for (size_t c = 1; c < n_cameras; ++c) {
+        layout.extr_offset.push_back(layout.shared);
+        layout.shared += kPoseParams;
+    }
+
+    // Joint refinement of all intrinsics, extrinsics and board poses
+    JointProblem problem(obs, board_points, options, frames, layout);
+    rig.iterations = lm::levenbergMarquardt(
+        state, options, [&](const RigState& s) { return problem.cost(s); },
+        [&](const RigState& s, lm::NormalEquations& eq) { problem.linearize(s, eq); },
+        [&](const RigState& s, const cv::Mat& dc, const std::vector<cv::Mat>& dp) { return problem.apply(s, dc, dp); });
+
+    std::vector<double> squared;
+    std::vector<size_t> points;
+    problem.cost(state, &squared, &points);
+    double total_squared = 0.0;
+    size_t total_points = 0;
+    for (size_t c = 0; c < n_cameras; ++c) {
+        RigCamera& cam = rig.cameras[c];
+        cam.intrinsics.camera_matrix = cv::Mat(cameraMatrix(state.focal[c])).clone();
+        cam.intrinsics.dist_coeffs = model_terms > 0 ? state.dist[c].rowRange(0, model_terms).clone() : cv::Mat();
+        cv::Rodrigues(state.cam_r[c], cam.R);
+        cam.t = state.cam_t[c];
+        cam.views = obs.views(c);
+        cam.rms = std::sqrt(squared[c] / std::max<size_t>(points[c], 1));
+        total_squared += squared[c];
+        total_points += points[c];
+    }
+    rig.rms = std::sqrt(total_squared / std::max<size_t>(total_points, 1));
+    return true;
+}
+
+bool saveRig(const std::string& path, const RigCalibration& rig) {
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    fs << "rms" << rig.rms;
+    fs << "cameras" << "[";
+    for (size_t c = 0; c < rig.cameras.size(); ++c) {
+        const RigCamera& cam = rig.cameras[c];
+        fs << "{";
+        fs << "name" << rig.names[c];
+        fs << "image_size" << cam.image_size;
+        fs << "camera_matrix" << cam.intrinsics.camera_matrix;
+        fs << "distortion_model" << distortionModelName(cam.intrinsics.model);
+        fs << "dist_coeffs" << cam.intrinsics.dist_coeffs;
+        fs << "R" << cv::Mat(cam.R);
+        fs << "t" << cv::Mat(cam.t);
+        fs << "rms" << cam.rms;
+        fs << "views" << static_cast<int>(cam.views);
+        fs << "}";
+    }
+    fs << "]";
+    return true;
+}
+
+StereoRectification rectifyPair(const RigCalibration& rig, int left, int right) {
+    const RigCamera& l = rig.cameras[left];
+    const RigCamera& r = rig.cameras[right];
+    StereoRectification rect;
+    rect.left = left;
+    rect.right = right;
+
+    // Pose of the right camera relative to the left one
+    cv::Matx33d R = r.R * l.R.t();
+    cv::Vec3d t = r.t - R * l.t;
+    const cv::Mat l_dist = pinholeCoefficients(l.intrinsics), r_dist = pinholeCoefficients(r.intrinsics);
+    cv::stereoRectify(l.intrinsics.camera_matrix, l_dist, r.intrinsics.camera_matrix, r_dist, l.image_size, R, t,
+                      rect.R1, rect.R2, rect.P1, rect.P2, rect.Q);
+    cv::initUndistortRectifyMap(l.intrinsics.camera_matrix, l_dist, rect.R1, rect.P1, l.image_size, CV_16SC2,
+                                rect.left_map1, rect.left_map2);
+    cv::initUndistortRectifyMap(r.intrinsics.camera_matrix, r_dist, rect.R2, rect.P2, l.image_size, CV_16SC2,
+                                rect.right_map1, rect.right_map2);
+    return rect;
+}
+
+bool saveRectification(const std::string& path, const StereoRectification& rectification) {
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    fs << "left" << rectification.left << "right" << rectification.right;
+    fs << "R1" << rectification.R1 << "R2" << rectification.R2;
+    fs << "P1" << rectification.P1 << "P2" << rectification.P2 << "Q" << rectification.Q;
+    fs << "left_map1" << rectification.left_map1 << "left_map2" << rectification.left_map2;
+    fs << "right_map1" << rectification.right_map1 << "right_map2" << rectification.right_map2;
+    return true;
+}
+
+}  // namespace calib
@@ -0,0 +1,69 @@
+#pragma once
+
+// POSIX shared-memory mapping shared by the pose and frame channels
+// (pose_channel.cpp, frame_channel.cpp).
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace calib {
+namespace shm {
+
+// Create a read-write object of `bytes` zero bytes, replacing one left behind
+// by a previous run. Readers of the old object keep their mapping and have to
+// reopen. Returns nullptr after printing the reason.
+inline void* create(const std::string& name, size_t bytes, const char* what) {
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Could not create " << what << " " << name << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error: Could not map " << what << " " << name << ": " << std::strerror(error) << std::endl;
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    return memory;
+}
+
+// Map an existing object read-only. bytes receives its size; objects smaller
+// than min_bytes are rejected.
+inline const void* open(const std::string& name, size_t min_bytes, size_t& bytes, const char* what) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        std::cerr << "Error: Could not open " << what << " " << name << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= min_bytes) {
+        bytes = static_cast<size_t>(info.st_size);
+        memory = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error: Could not map " << what << " " << name << std::endl;
+        return nullptr;
+    }
+    return memory;
+}
+
+inline void unmap(const void* memory, size_t bytes) {
+    munmap(const_cast<void*>(memory), bytes);
+}
+
+}  // namespace shm
+}  // namespace calib
@@ -0,0 +1,224 @@
+#include "calib/subpix.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+namespace calib {
+
+namespace {
+
+// cornerSubPix never runs more iterations than this
+constexpr int kMaxIterations = 100;
+
+// Corners per parallel stripe
+constexpr int kStripeCorners = 32;
+
+int vectorLanes() {
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    return cv::VTraits<cv::v_float32>::vlanes();
+#else
+    return 1;
+#endif
+}
+
+// Bilinearly resample an n x n patch whose first sample sits at (x, y), as
+// cv::getRectSubPix does, into rows of the given stride. Samples outside
+// the image repeat its border.
+void samplePatch(const cv::Mat& gray, float x, float y, int n, int stride, float* patch) {
+    const int ix = cvFloor(x), iy = cvFloor(y);
+    const float fx = x - ix, fy = y - iy;
+    const float w00 = (1.f - fx) * (1.f - fy), w01 = fx * (1.f - fy);
+    const float w10 = (1.f - fx) * fy, w11 = fx * fy;
+
+    if (ix < 0 || iy < 0 || ix + n >= gray.cols || iy + n >= gray.rows) {
+        auto at = [&](int r, int c) {
+            return static_cast<float>(gray.at<uchar>(std::min(std::max(r, 0), gray.rows - 1),
+                                                     std::min(std::max(c, 0), gray.cols - 1)));
+        };
+        for (int r = 0; r < n; ++r) {
+            float* d = patch + r * stride;
+            for (int c = 0; c < n; ++c) {
+                d[c] = at(iy + r, ix + c) * w00 + at(iy + r, ix + c + 1) * w01 + at(iy + r + 1, ix + c) * w10 +
+                       at(iy + r + 1, ix + c + 1) * w11;
+            }
+        }
+        return;
+    }
+
+    for (int r = 0; r < n; ++r) {
+        const uchar* s0 = gray.ptr<uchar>(iy + r) + ix;
+        const uchar* s1 = gray.ptr<uchar>(iy + r + 1) + ix;
+        float* d = patch + r * stride;
+        int c = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+        const cv::v_float32 v00 = cv::vx_setall_f32(w00), v01 = cv::vx_setall_f32(w01);
+        const cv::v_float32 v10 = cv::vx_setall_f32(w10), v11 = cv::vx_setall_f32(w11);
+        auto load = [](const uchar* p) {
+            return cv::v_cvt_f32(cv::v_reinterpret_as_s32(cv::vx_load_expand_q(p)));
+        };
+        // The loads read one sample past the vector, which is inside the image here
+        for (; c <= n - lanes; c += lanes) {
+            cv::v_float32 v = cv::v_mul(load(s0 + c), v00);
+            v = cv::v_fma(load(s0 + c + 1), v01, v);
+            v = cv::v_fma(load(s1 + c), v10, v);
+            v = cv::v_fma(load(s1 + c + 1), v11, v);
+            cv::v_store(d + c, v);
+        }
+#endif
+        for (; c < n; ++c) {
+            d[c] = s0[c] * w00 + s0[c + 1] * w01 + s1[c] * w10 + s1[c + 1] * w11;
+        }
+    }
+}
+
+}  // namespace
+
+SubpixOptions subpixOptions(const Config& cfg) {
+    SubpixOptions options;
+    options.window = cfg.subpix_window;
+    options.max_iter = cfg.subpix_max_iter;
+    options.epsilon = cfg.subpix_epsilon;
+    options.parallel_min_corners = cfg.subpix_parallel_corners;
+    options.warm_start = cfg.subpix_warm_start;
+    return options;
+}
+
+SubpixRefiner::SubpixRefiner(const SubpixOptions& options) : options_(options) {
+    const int lanes = vectorLanes();
+    size_ = 2 * options_.window + 1;
+    padded_ = (size_ + lanes - 1) / lanes * lanes;
+    // Gradients read one column either side of the padded window
+    stride_ = padded_ + 2;
+
+    // The weights of cornerSubPix, zero in the padding so it adds nothing
+    std::vector<float> weights(size_);
+    const float coeff = 1.f / (options_.window * options_.window);
+    for (int i = 0; i < size_; ++i) {
+        const float d = static_cast<float>(i - options_.window);
+        weights[i] = std::exp(-d * d * coeff);
+    }
+    mask_.assign(static_cast<size_t>(size_) * padded_, 0.f);
+    for (int y = 0; y < size_; ++y) {
+        for (int x = 0; x < size_; ++x) mask_[y * padded_ + x] = weights[y] * weights[x];
+    }
+    px_.resize(padded_);
+    for (int x = 0; x < padded_; ++x) px_[x] = static_cast<float>(x - options_.window);
+}
+
+void SubpixRefiner::refine(const cv::Mat& gray, std::vector<cv::Point2f>& corners) {
+    const int n = static_cast<int>(corners.size());
+    if (gray.type() != CV_8UC1) {
+        cv::cornerSubPix(gray, corners, cv::Size(options_.window, options_.window), cv::Size(-1, -1),
+                         cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, options_.max_iter,
+                                          options_.epsilon));
+        offsets_.clear();
+        last_iterations_ = 0;
+        return;
+    }
+
+    const int max_iter = std::min(std::max(options_.max_iter, 1), kMaxIterations);
+    const double eps = std::max(options_.epsilon, 0.0) * std::max(options_.epsilon, 0.0);
+    const bool warm = options_.warm_start && static_cast<int>(offsets_.size()) == n;
+    const std::vector<cv::Point2f> initial = corners;
+    std::atomic<int> total_iterations(0);
+
+    auto refineRange = [&](const cv::Range& range) {
+        // Patch of size_ + 2 rows, one extra either side for the gradients
+        std::vector<float> patch(static_cast<size_t>(size_ + 2) * stride_, 0.f);
+        int iterations = 0;
+        for (int k = range.start; k < range.end; ++k) {
+            const cv::Point2f start = initial[k];
+            cv::Point2f ci = start;
+            // Warm start, trusting only offsets that stayed within a pixel
+            if (warm && std::abs(offsets_[k].x) <= 1.f && std::abs(offsets_[k].y) <= 1.f) {
+                ci += offsets_[k];
+            }
+
+            int iter = 0;
+            double err = 0.0;
+            do {
+                samplePatch(gray, ci.x - (options_.window + 1), ci.y - (options_.window + 1), size_ + 2, stride_,
+                            patch.data());
+
+                double a = 0, b = 0, c = 0, bb1 = 0, bb2 = 0;
+                for (int y = 0; y < size_; ++y) {
+                    const float* row = patch.data() + (y + 1) * stride_ + 1;
+                    const float* up = row - stride_;
+                    const float* down = row + stride_;
+                    const float* m = mask_.data() + y * padded_;
+                    const float py = static_cast<float>(y - options_.window);
+                    int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+                    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+                    const cv::v_float32 vpy = cv::vx_setall_f32(py);
+                    cv::v_float32 sa = cv::vx_setzero_f32(), sb = cv::vx_setzero_f32(), sc = cv::vx_setzero_f32();
+                    cv::v_float32 s1 = cv::vx_setzero_f32(), s2 = cv::vx_setzero_f32();
+                    for (; x < padded_; x += lanes) {
+                        const cv::v_float32 gx = cv::v_sub(cv::vx_load(row + x + 1), cv::vx_load(row + x - 1));
+                        const cv::v_float32 gy = cv::v_sub(cv::vx_load(down + x), cv::vx_load(up + x));
+                        const cv::v_float32 w = cv::vx_load(m + x);
+                        const cv::v_float32 px = cv::vx_load(px_.data() + x);
+                        const cv::v_float32 gxx = cv::v_mul(cv::v_mul(gx, gx), w);
+                        const cv::v_float32 gxy = cv::v_mul(cv::v_mul(gx, gy), w);
+                        const cv::v_float32 gyy = cv::v_mul(cv::v_mul(gy, gy), w);
+                        sa = cv::v_add(sa, gxx);
+                        sb = cv::v_add(sb, gxy);
+                        sc = cv::v_add(sc, gyy);
+                        s1 = cv::v_fma(gxx, px, cv::v_fma(gxy, vpy, s1));
+                        s2 = cv::v_fma(gxy, px, cv::v_fma(gyy, vpy, s2));
+                    }
+                    a += cv::v_reduce_sum(sa);
+                    b += cv::v_reduce_sum(sb);
+                    c += cv::v_reduce_sum(sc);
+                    bb1 += cv::v_reduce_sum(s1);
+                    bb2 += cv::v_reduce_sum(s2);
+#endif
+                    for (; x < size_; ++x) {
+                        const double gx = row[x + 1] - row[x - 1];
+                        const double gy = down[x] - up[x];
+                        const double gxx = gx * gx * m[x], gxy = gx * gy * m[x], gyy = gy * gy * m[x];
+                        a += gxx;
+                        b += gxy;
+                        c += gyy;
+                        bb1 += gxx * px_[x] + gxy * py;
+                        bb2 += gxy * px_[x] + gyy * py;
+                    }
+                }
+
+                const double det = a * c - b * b;
+                if (std::fabs(det) <= DBL_EPSILON * DBL_EPSILON) break;
+                const double scale = 1.0 / det;
+                const cv::Point2f next(static_cast<float>(ci.x + c * scale * bb1 - b * scale * bb2),
+                                       static_cast<float>(ci.y - b * scale * bb1 + a * scale * bb2));
+                err = (next.x - ci.x) * (next.x - ci.x) + (next.y - ci.y) * (next.y - ci.y);
+                ci = next;
+                ++iterations;
+                if (ci.x < 0 || ci.x >= gray.cols || ci.y < 0 || ci.y >= gray.rows) break;
+            } while (++iter < max_iter && err > eps);
+
+            // Too far from the input means poor convergence, as in cornerSubPix
+            if (std::fabs(ci.x - start.x) > options_.window || std::fabs(ci.y - start.y) > options_.window) {
+                ci = start;
+            }
+            corners[k] = ci;
+        }
+        total_iterations += iterations;
+    };
+
+    if (options_.parallel_min_corners > 0 && n >= options_.parallel_min_corners) {
+        cv::parallel_for_(cv::Range(0, n), refineRange, static_cast<double>(n) / kStripeCorners);
+    } else {
+        refineRange(cv::Range(0, n));
+    }
+
+    offsets_.resize(n);
+    for (int k = 0; k < n; ++k) offsets_[k] = corners[k] - initial[k];
+    last_iterations_ = total_iterations;
+}
+
+}  // namespace calib
@@ -0,0 +1,491 @@
+#include "calib/trajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace calib {
+
+namespace {
+
+constexpr char kFileMagic[8] = {'C', 'A', 'L', 'T', 'R', 'A', 'J', '1'};
+constexpr char kIndexMagic[8] = {'C', 'A', 'L', 'T', 'R', 'I', 'D', 'X'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kFlagFloat32 = 1u << 0;
+constexpr uint32_t kFlagDelta = 1u << 1;
+constexpr size_t kHeaderBytes = 24;
+constexpr size_t kIndexEntryBytes = 48;
+constexpr size_t kFooterBytes = 32;
+constexpr double kTicksPerSecond = 1e6;
+
+// Little-endian byte buffer helpers
+template <typename T>
+void put(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+bool get(const char*& p, const char* end, T& value) {
+    if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) return false;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+void putVarint(std::string& out, int64_t value) {
+    // Zigzag so small negative deltas stay short
+    uint64_t v = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool getVarint(const char*& p, const char* end, int64_t& value) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            value = static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void putDeltas(std::string& out, const std::vector<int64_t>& values) {
+    int64_t previous = 0;
+    for (int64_t v : values) {
+        putVarint(out, v - previous);
+        previous = v;
+    }
+}
+
+bool getDeltas(const char*& p, const char* end, size_t rows, std::vector<int64_t>& values) {
+    int64_t current = 0;
+    for (size_t i = 0; i < rows; ++i) {
+        int64_t delta;
+        if (!getVarint(p, end, delta)) return false;
+        current += delta;
+        values.push_back(current);
+    }
+    return true;
+}
+
+// One component of a double column in the stored precision
+template <typename Get>
+void putReals(std::string& out, size_t rows, bool float32, Get value) {
+    for (size_t i = 0; i < rows; ++i) {
+        if (float32) {
+            put(out, static_cast<float>(value(i)));
+        } else {
+            put(out, value(i));
+        }
+    }
+}
+
+template <typename Set>
+bool getReals(const char*& p, const char* end, size_t rows, bool float32, Set set) {
+    for (size_t i = 0; i < rows; ++i) {
+        double v;
+        if (float32) {
+            float f;
+            if (!get(p, end, f)) return false;
+            v = f;
+        } else if (!get(p, end, v)) {
+            return false;
+        }
+        set(i, v);
+    }
+    return true;
+}
+
+void encodeChunk(const TrajectoryColumns& columns, uint32_t flags, std::string& out) {
+    const size_t rows = columns.size();
+    const bool float32 = flags & kFlagFloat32;
+    if (flags & kFlagDelta) {
+        std::vector<int64_t> ticks(rows);
+        for (size_t i = 0; i < rows; ++i) {
+            ticks[i] = std::llround(columns.timestamp[i] * kTicksPerSecond);
+        }
+        putDeltas(out, ticks);
+        putDeltas(out, columns.frame);
+    } else {
+        for (double t : columns.timestamp) put(out, t);
+        for (int64_t f : columns.frame) put(out, f);
+    }
+    for (int k = 0; k < 3; ++k) {
+        putReals(out, rows, float32, [&](size_t i) { return columns.rvec[i][k]; });
+    }
+    for (int k = 0; k < 3; ++k) {
+        putReals(out, rows, float32, [&](size_t i) { return columns.tvec[i][k]; });
+    }
+    putReals(out, rows, float32, [&](size_t i) { return columns.error[i]; });
+}
+
+// Append a decoded chunk to the columns
+bool decodeChunk(const char* p, const char* end, size_t rows, uint32_t flags, TrajectoryColumns& columns) {
+    const bool float32 = flags & kFlagFloat32;
+    const size_t base = columns.size();
+    if (flags & kFlagDelta) {
+        std::vector<int64_t> ticks;
+        ticks.reserve(rows);
+        if (!getDeltas(p, end, rows, ticks)) return false;
+        for (int64_t t : ticks) columns.timestamp.push_back(t / kTicksPerSecond);
+        if (!getDeltas(p, end, rows, columns.frame)) return false;
+    } else {
+        for (size_t i = 0; i < rows; ++i) {
+            double t;
+            if (!get(p, end, t)) return false;
+            columns.timestamp.push_back(t);
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            int64_t f;
+            if (!get(p, end, f)) return false;
+            columns.frame.push_back(f);
+        }
+    }
+    columns.rvec.resize(base + rows);
+    columns.tvec.resize(base + rows);
+    columns.error.resize(base + rows);
+    for (int k = 0; k < 3; ++k) {
+        if (!getReals(p, end, rows, float32, [&](size_t i, double v) { columns.rvec[base + i][k] = v; })) return false;
+    }
+    for (int k = 0; k < 3; ++k) {
+        if (!getReals(p, end, rows, float32, [&](size_t i, double v) { columns.tvec[base + i][k] = v; })) return false;
+    }
+    return getReals(p, end, rows, float32, [&](size_t i, double v) { columns.error[base + i] = v; });
+}
+
+}  // namespace
+
+PoseMessage toPoseMessage(const PoseSample& sample) {
+    PoseMessage message;
+    message.frame = sample.frame;
+    message.timestamp = sample.timestamp;
+    for (int k = 0; k < 3; ++k) {
+        message.rvec[k] = sample.rvec[k];
+        message.tvec[k] = sample.tvec[k];
+    }
+    message.error = sample.error;
+    return message;
+}
+
+TrajectoryOptions trajectoryOptions(const Config& cfg) {
+    TrajectoryOptions options;
+    options.chunk_rows = static_cast<uint32_t>(cfg.trajectory_chunk_rows);
+    options.float32 = cfg.trajectory_float32;
+    options.delta = cfg.trajectory_delta;
+    return options;
+}
+
+// ---------------------------------------------------------------------------
+// TrajectoryColumns
+// ---------------------------------------------------------------------------
+void TrajectoryColumns::clear() {
+    timestamp.clear();
+    frame.clear();
+    rvec.clear();
+    tvec.clear();
+    error.clear();
+}
+
+void TrajectoryColumns::append(const PoseSample& sample) {
+    timestamp.push_back(sample.timestamp);
+    frame.push_back(sample.frame);
+    rvec.push_back(sample.rvec);
+    tvec.push_back(sample.tvec);
+    error.push_back(sample.error);
+}
+
+PoseSample TrajectoryColumns::row(size_t i) const {
+    PoseSample sample;
+    sample.timestamp = timestamp[i];
+    sample.frame = frame[i];
+    sample.rvec = rvec[i];
+    sample.tvec = tvec[i];
+    sample.error = error[i];
+    return sample;
+}
+
+// ---------------------------------------------------------------------------
+// TrajectoryWriter
+// ---------------------------------------------------------------------------
+TrajectoryWriter::~TrajectoryWriter() {
+    close();
+}
+
+bool TrajectoryWriter::open(const std::string& path, const TrajectoryOptions& options) {
+    close();
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        std::cerr << "Error: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+    path_ = path;
+    options_ = options;
+    options_.chunk_rows = std::max<uint32_t>(1, options.chunk_rows);
+    pending_.clear();
+    index_.clear();
+    rows_ = 0;
+
+    uint32_t flags = (options_.float32 ? kFlagFloat32 : 0) | (options_.delta ? kFlagDelta : 0);
+    std::string header(kFileMagic, sizeof(kFileMagic));
+    put(header, kVersion);
+    put(header, flags);
+    put(header, options_.chunk_rows);
+    put(header, uint32_t(0));
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    return static_cast<bool>(file_);
+}
+
+bool TrajectoryWriter::append(const PoseSample& sample) {
+    if (!file_.is_open()) return false;
+    if (pending_.size() > 0 || !index_.empty()) {
+        int64_t last_frame = pending_.size() > 0 ? pending_.frame.back() : index_.back().last_frame;
+        double last_time = pending_.size() > 0 ? pending_.timestamp.back() : index_.back().last_time;
+        if (sample.frame < last_frame || sample.timestamp < last_time) {
+            std::cerr << "Error: Trajectory samples must be in frame and time order (frame " << sample.frame
+                      << " after " << last_frame << ")" << std::endl;
+            return false;
+        }
+    }
+    pending_.append(sample);
+    rows_++;
+    if (pending_.size() >= options_.chunk_rows) {
+        return flushChunk();
+    }
+    return true;
+}
+
+bool TrajectoryWriter::flushChunk() {
+    if (pending_.size() == 0) return true;
+    uint32_t flags = (options_.float32 ? kFlagFloat32 : 0) | (options_.delta ? kFlagDelta : 0);
+    std::string payload;
+    encodeChunk(pending_, flags, payload);
+
+    ChunkInfo info;
+    info.offset = static_cast<uint64_t>(file_.tellp());
+    info.rows = static_cast<uint32_t>(pending_.size());
+    info.bytes = static_cast<uint32_t>(payload.size());
+    info.first_frame = pending_.frame.front();
+    info.last_frame = pending_.frame.back();
+    info.first_time = pending_.timestamp.front();
+    info.last_time = pending_.timestamp.back();
+    index_.push_back(info);
+
+    file_.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    pending_.clear();
+    if (!file_) {
+        std::cerr << "Error: Could not write " << path_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryWriter::close() {
+    if (!file_.is_open()) return true;
+    bool ok = flushChunk();
+
+    std::string tail;
+    uint64_t index_offset = static_cast<uint64_t>(file_.tellp());
+    for (const ChunkInfo& info : index_) {
+        put(tail, info.offset);
+        put(tail, info.rows);
+        put(tail, info.bytes);
+        put(tail, info.first_frame);
+        put(tail, info.last_frame);
+        put(tail, info.first_time);
+        put(tail, info.last_time);
+    }
+    put(tail, index_offset);
+    put(tail, rows_);
+    put(tail, static_cast<uint32_t>(index_.size()));
+    put(tail, uint32_t(0));
+    tail.append(kIndexMagic, sizeof(kIndexMagic));
+    file_.write(tail.data(), static_cast<std::streamsize>(tail.size()));
+
+    ok = ok && static_cast<bool>(file_);
+    file_.close();
+    if (!ok) {
+        std::cerr << "Error: Could not write " << path_ << std::endl;
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// TrajectoryReader
+// ---------------------------------------------------------------------------
+bool TrajectoryReader::open(const std::string& path) {
+    file_.close();
+    file_.clear();
+    index_.clear();
+    rows_ = 0;
+    cached_chunk_ = SIZE_MAX;
+    cache_.clear();
+    path_ = path;
+
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+
+    char header[kHeaderBytes];
+    if (!file_.read(header, sizeof(header)) || std::memcmp(header, kFileMagic, sizeof(kFileMagic)) != 0) {
+        std::cerr << "Error: " << path << " is not a trajectory file" << std::endl;
+        return false;
+    }
+    const char* p = header + sizeof(kFileMagic);
+    uint32_t version = 0;
+    get(p, header + kHeaderBytes, version);
+    get(p, header + kHeaderBytes, flags_);
+    if (version != kVersion) {
+        std::cerr << "Error: " << path << " has unsupported trajectory version " << version << std::endl;
+        return false;
+    }
+
+    char footer[kFooterBytes];
+    file_.seekg(-static_cast<std::streamoff>(kFooterBytes), std::ios::end);
+    if (!file_.read(footer, sizeof(footer)) ||
+        std::memcmp(footer + kFooterBytes - sizeof(kIndexMagic), kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        std::cerr << "Error: " << path << " has no index (was the writer closed?)" << std::endl;
+        return false;
+    }
+    uint64_t index_offset = 0;
+    uint32_t chunks = 0;
+    p = footer;
+    get(p, footer + kFooterBytes, index_offset);
+    get(p, footer + kFooterBytes, rows_);
+    get(p, footer + kFooterBytes, chunks);
+
+    std::string index(static_cast<size_t>(chunks) * kIndexEntryBytes, '\0');
+    file_.seekg(static_cast<std::streamoff>(index_offset));
+    if (!file_.read(&index[0], static_cast<std::streamsize>(index.size()))) {
+        std::cerr << "Error: " << path << " has a truncated index" << std::endl;
+        return false;
+    }
+    p = index.data();
+    const char* end = p + index.size();
+    uint64_t first_row = 0;
+    for (uint32_t i = 0; i < chunks; ++i) {
+        ChunkInfo info;
+        get(p, end, info.offset);
+        get(p, end, info.rows);
+        get(p, end, info.bytes);
+        get(p, end, info.first_frame);
+        get(p, end, info.last_frame);
+        get(p, end, info.first_time);
+        get(p, end, info.last_time);
+        info.first_row = first_row;
+        first_row += info.rows;
+        index_.push_back(info);
+    }
+    if (first_row != rows_) {
+        std::cerr << "Error: " << path << " index does not match its row count" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TrajectoryReader::readAll(TrajectoryColumns& columns) {
+    columns.clear();
+    if (index_.empty()) return true;
+
+    // Chunks are contiguous, so the whole file body is a single read
+    const uint64_t begin = index_.front().offset;
+    const uint64_t end = index_.back().offset + index_.back().bytes;
+    std::string body(static_cast<size_t>(end - begin), '\0');
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(begin));
+    if (!file_.read(&body[0], static_cast<std::streamsize>(body.size()))) {
+        std::cerr << "Error: Could not read " << path_ << std::endl;
+        return false;
+    }
+
+    columns.timestamp.reserve(rows_);
+    columns.frame.reserve(rows_);
+    for (const ChunkInfo& info : index_) {
+        const char* p = body.data() + (info.offset - begin);
+        if (!decodeChunk(p, p + info.bytes, info.rows, flags_, columns)) {
+            std::cerr << "Error: " << path_ << " has a corrupt chunk at offset " << info.offset << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t TrajectoryReader::chunkOfRow(uint64_t row) const {
+    auto it = std::upper_bound(index_.begin(), index_.end(), row,
+                               [](uint64_t r, const ChunkInfo& info) { return r < info.first_row; });
+    return static_cast<size_t>(it - index_.begin()) - 1;
+}
+
+bool TrajectoryReader::loadChunk(size_t chunk) {
+    if (chunk == cached_chunk_) return true;
+    const ChunkInfo& info = index_[chunk];
+    std::string payload(info.bytes, '\0');
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(info.offset));
+    cache_.clear();
+    cached_chunk_ = SIZE_MAX;
+    if (!file_.read(&payload[0], static_cast<std::streamsize>(payload.size())) ||
+        !decodeChunk(payload.data(), payload.data() + payload.size(), info.rows, flags_, cache_)) {
+        std::cerr << "Error: " << path_ << " has a corrupt chunk at offset " << info.offset << std::endl;
+        return false;
+    }
+    cached_chunk_ = chunk;
+    return true;
+}
+
+bool TrajectoryReader::readRows(uint64_t begin, uint64_t end, TrajectoryColumns& columns) {
+    columns.clear();
+    end = std::min(end, rows_);
+    for (uint64_t row = begin; row < end;) {
+        size_t chunk = chunkOfRow(row);
+        if (!loadChunk(chunk)) return false;
+        const ChunkInfo& info = index_[chunk];
+        uint64_t stop = std::min<uint64_t>(end, info.first_row + info.rows);
+        for (; row < stop; ++row) {
+            columns.append(cache_.row(static_cast<size_t>(row - info.first_row)));
+        }
+    }
+    return true;
+}
+
+bool TrajectoryReader::sample(uint64_t row, PoseSample& sample) {
+    if (row >= rows_) return false;
+    size_t chunk = chunkOfRow(row);
+    if (!loadChunk(chunk)) return false;
+    sample = cache_.row(static_cast<size_t>(row - index_[chunk].first_row));
+    return true;
+}
+
+uint64_t TrajectoryReader::findFrame(int64_t frame) {
+    // First chunk whose last frame reaches the target
+    auto it = std::lower_bound(index_.begin(), index_.end(), frame,
+                               [](const ChunkInfo& info, int64_t f) { return info.last_frame < f; });
+    if (it == index_.end()) return rows_;
+    size_t chunk = static_cast<size_t>(it - index_.begin());
+    if (!loadChunk(chunk)) return rows_;
+    auto pos = std::lower_bound(cache_.frame.begin(), cache_.frame.end(), frame);
+    return it->first_row + static_cast<uint64_t>(pos - cache_.frame.begin());
+}
+
+uint64_t TrajectoryReader::findTime(double timestamp) {
+    auto it = std::lower_bound(index_.begin(), index_.end(), timestamp,
+                               [](const ChunkInfo& info, double t) { return info.last_time < t; });
+    if (it == index_.end()) return rows_;
+    size_t chunk = static_cast<size_t>(it - index_.begin());
+    if (!loadChunk(chunk)) return rows_;
+    auto pos = std::lower_bound(cache_.timestamp.begin(), cache_.timestamp.end(), timestamp);
+    return it->first_row + static_cast<uint64_t>(pos - cache_.timestamp.begin());
+}
+
+}  // namespace calib
@@ -1,11 +1,16 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/aruco.hpp>
 #include <iostream>
+#include "calib/calib.hpp"
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
 
-int main() {
     // Define the checkerboard dimensions
-    cv::Size CHECKERBOARD(9, 6);
-    cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001);
+    cv::Size CHECKERBOARD = cfg.boardSize();
 
     // Load the checkerboard image
     std::string image_path = "checkerboard.png";
@@ -18,16 +23,14 @@ int main() {
     }
 
     cv::Mat gray;
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+    calib::toGray(image, gray);
 
-    // Find the chess board corners
+    // Find the chess board corners and refine them to subpixel accuracy
     std::vector<cv::Point2f> corners;
-    bool ret = cv::findChessboardCorners(gray, CHECKERBOARD, corners);
+    bool ret = calib::detectBoard(gray, cfg, corners);
 
-    // If found, refine the corner locations and draw them
+    // If found, draw them
     if (ret) {
-        cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1), criteria);
-        
         // Draw and display the corners
         cv::drawChessboardCorners(image, CHECKERBOARD, corners, ret);
         
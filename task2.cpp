@@ -1,78 +1,107 @@
 #include <opencv2/opencv.hpp>
+#include <filesystem>
 #include <iostream>
 #include <vector>
+#include "calib/calib.hpp"
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
 
-int main() {
     // Define the checkerboard dimensions
-    cv::Size CHECKERBOARD(9, 6);
-    cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001);
-
-    // Calibration data storage
-    std::vector<std::vector<cv::Point2f>> corner_list;
-    std::vector<std::vector<cv::Vec3f>> point_list;
-    std::vector<cv::Vec3f> point_set;
-
-    // Create the 3D world points for the checkerboard
-    for (int i = 0; i < CHECKERBOARD.height; i++) {
-        for (int j = 0; j < CHECKERBOARD.width; j++) {
-            point_set.push_back(cv::Vec3f(j, -i, 0));
-        }
+    cv::Size CHECKERBOARD = cfg.boardSize();
+
+    // Start video capture (camera, video file or image sequence, see calib.cfg)
+    calib::FrameSource source;
+    if (!source.open(cfg)) {
+        std::cerr << "Error: Could not open video capture" << std::endl;
+        return -1;
     }
 
-    while (true) {
-        // Load the checkerboard image
-        std::string image_path = "checkerboard.png";
-        cv::Mat image = cv::imread(image_path);
+    std::error_code ec;
+    std::filesystem::create_directories(cfg.capture_dir, ec);
+    if (ec) {
+        std::cerr << "Error: Could not create " << cfg.capture_dir << ": " << ec.message() << std::endl;
+        return -1;
+    }
 
-        // Check if the image is loaded successfully
-        if (image.empty()) {
-            std::cerr << "Error: Could not load image at " << image_path << std::endl;
-            return -1;
-        }
+    // Accepted views are kept in memory; their images are encoded and saved
+    // in the background so the capture loop never waits on the disk
+    calib::CaptureAssistant assistant(CHECKERBOARD, calib::captureOptions(cfg));
+    calib::AsyncImageWriter writer;
+
+    calib::Overlay overlay(cfg);
+    calib::BoardGate gate(cfg);
+    calib::SubpixRefiner refiner(calib::subpixOptions(cfg));
+
+    calib::Frame captured;
+    calib::CaptureAssistant::Verdict verdict = calib::CaptureAssistant::Verdict::NoBoard;
+    bool stopped_by_user = false;
 
+    while (!assistant.done() && source.read(captured)) {
+        cv::Mat& frame = captured.image;
         cv::Mat gray;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        calib::toGray(frame, gray);
 
-        // Find the chess board corners
+        // Find the chess board corners and refine them to subpixel accuracy
         std::vector<cv::Point2f> corners;
-        bool ret = cv::findChessboardCorners(gray, CHECKERBOARD, corners);
-
-        // If found, refine the corner locations and draw them
-        if (ret) {
-            cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1), criteria);
-            
-            // Draw and display the corners
-            cv::drawChessboardCorners(image, CHECKERBOARD, corners, ret);
-            
-            // Print the number of corners and the coordinates of the first corner
-            std::cout << "Number of corners found: " << corners.size() << std::endl;
-            std::cout << "Coordinates of the first corner: " << corners[0].x << ", " << corners[0].y << std::endl;
-
-            // Display the image with corners
-            cv::imshow("Checkerboard", image);
-        } else {
-            std::cerr << "Error: Could not find chessboard corners." << std::endl;
+        bool ret = calib::detectBoard(gray, cfg, corners, gate, refiner);
+
+        bool save = false;
+        if (cfg.capture_auto) {
+            verdict = assistant.offer(gray, ret ? corners : std::vector<cv::Point2f>());
+            save = verdict == calib::CaptureAssistant::Verdict::Accepted;
         }
 
-        // Wait for a key press
-        char key = (char)cv::waitKey(0);
-        if (key == 's' && ret) {
-            corner_list.push_back(corners);
-            point_list.push_back(point_set);
-            std::cout << "Corners and 3D world points saved." << std::endl;
-
-            // Save the image used for calibration
-            std::string save_path = "calibration_image_" + std::to_string(corner_list.size()) + ".png";
-            cv::imwrite(save_path, image);
-            std::cout << "Calibration image saved as " << save_path << std::endl;
-        } else if (key == 'q') {
-            break;
-        } else {
-            std::cerr << "No corners saved." << std::endl;
+        // Display the frame with the corners and the capture progress; 's'
+        // captures the current view, 'q' or Esc stops, 1-4 toggle layers
+        if (cfg.display) {
+            cv::Mat shown = frame.clone();
+            overlay.begin();
+            if (ret) overlay.chessboardCorners(CHECKERBOARD, corners, ret);
+            overlay.composite(shown);
+            std::string status = std::to_string(assistant.views().size()) + " views, " +
+                                 std::to_string(static_cast<int>(100 * assistant.coverage())) + "% covered";
+            if (cfg.capture_auto) status += ", " + std::string(calib::verdictName(verdict));
+            cv::putText(shown, status, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 255), 2);
+            cv::imshow("Checkerboard", shown);
+
+            int key = cv::waitKey(source.isLive() ? 30 : 1);
+            if (key == 's' && ret && !save) {
+                assistant.accept(corners, gray.size());
+                save = true;
+            } else if (key == 'q' || key == 27) {
+                stopped_by_user = true;
+                break;
+            } else if (key >= 0 && key != 's') {
+                overlay.handleKey(key);
+            }
         }
 
-        cv::destroyAllWindows();
+        if (save) {
+            // The raw frame, so the images can be calibrated again with task3
+            std::string save_path =
+                cfg.capture_dir + "/calibration_image_" + std::to_string(assistant.views().size()) + ".png";
+            writer.write(save_path, frame);
+            std::cout << "View " << assistant.views().size() << " saved as " << save_path << " (coverage "
+                      << assistant.coverage() << ")" << std::endl;
+        }
+    }
+
+    writer.close();
+
+    if (source.isLive() && !stopped_by_user && !assistant.done()) {
+        std::cerr << "Error: Could not capture frame" << std::endl;
+    }
+    std::cout << "Captured " << assistant.views().size() << " views covering " << 100 * assistant.coverage()
+              << "% of the image; " << writer.written() << " images written to " << cfg.capture_dir << std::endl;
+    if (writer.failed() > 0) {
+        std::cerr << "Error: " << writer.failed() << " images could not be written" << std::endl;
+        return -1;
     }
+    std::cout << "Calibrate with: ./task3 --image_dir=" << cfg.capture_dir << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
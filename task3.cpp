@@ -1,118 +1,190 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include <string>
 #include <vector>
-#include <filesystem>
-#include <fstream>
+#include "calib/calib.hpp"
+
+// Calibrate every camera of a rig and the camera-to-camera extrinsics from
+// synchronized image directories (rig_cameras in calib.cfg)
+int calibrateRig(const calib::Config& cfg) {
+    std::vector<std::string> dirs = cfg.rigCameraDirs();
+    int64_t start_ticks = cv::getTickCount();
+    calib::RigObservations observations;
+    if (!calib::detectRig(dirs, cfg, observations)) {
+        return -1;
+    }
+    double detect_seconds = (cv::getTickCount() - start_ticks) / cv::getTickFrequency();
+    std::cout << "Detected boards in " << observations.frame_sets.size() << " frame sets from " << dirs.size()
+              << " cameras in " << detect_seconds << " s" << std::endl;
+
+    calib::RigCalibration rig;
+    if (!calib::calibrateRig(observations, calib::boardPoints(cfg), calib::distortionModel(cfg),
+                             calib::refineOptions(cfg), rig)) {
+        return -1;
+    }
+    std::cout << "Rig calibration: RMS " << rig.rms << " px after " << rig.iterations << " iterations" << std::endl;
+    for (size_t c = 0; c < rig.cameras.size(); ++c) {
+        const calib::RigCamera& cam = rig.cameras[c];
+        std::cout << "Camera " << c << " (" << rig.names[c] << "): " << cam.views << " views, RMS " << cam.rms
+                  << " px\nCamera matrix:\n" << cam.intrinsics.camera_matrix
+                  << "\nDistortion coefficients:\n" << cam.intrinsics.dist_coeffs
+                  << "\nRotation from camera 0:\n" << cv::Mat(cam.R) << "\nTranslation from camera 0:\n"
+                  << cv::Mat(cam.t) << std::endl;
+    }
+
+    if (calib::saveRig(cfg.rig_file, rig)) {
+        std::cout << "Rig calibration saved to " << cfg.rig_file << std::endl;
+    }
+    if (cfg.rig_rectify) {
+        for (int c = 1; c < static_cast<int>(rig.cameras.size()); ++c) {
+            std::string path = "rectify_" + std::to_string(c - 1) + "_" + std::to_string(c) + ".yml.gz";
+            if (calib::saveRectification(path, calib::rectifyPair(rig, c - 1, c))) {
+                std::cout << "Rectification maps saved to " << path << std::endl;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
+    if (!cfg.rig_cameras.empty()) {
+        return calibrateRig(cfg);
+    }
 
-int main() {
     // Define the checkerboard dimensions
-    cv::Size CHECKERBOARD(9, 6);
-    cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001);
+    cv::Size CHECKERBOARD = cfg.boardSize();
 
     // Calibration data storage
     std::vector<std::vector<cv::Point2f>> corner_list; // List of 2D image points
     std::vector<std::vector<cv::Vec3f>> point_list;    // List of 3D world points
-    std::vector<cv::Vec3f> point_set;                  // 3D world points for one image
-
-    // Create the 3D world points for the checkerboard
-    for (int i = 0; i < CHECKERBOARD.height; i++) {
-        for (int j = 0; j < CHECKERBOARD.width; j++) {
-            point_set.push_back(cv::Vec3f(j, -i, 0));
-        }
-    }
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg); // 3D world points for one image
+    std::vector<std::string> view_paths;                        // Image each view came from
 
-    // Directory containing the calibration images
-    std::string image_directory = "images";
+    cv::Size image_size;
+    calib::StageClock clock;  // per-stage timing for the quality report
 
-    cv::Mat gray; // Define gray here so it's accessible later
+    // Detections of images seen before come from the cache without decoding
+    calib::DetectionCache cache;
+    if (!cfg.detection_cache.empty() && !cache.open(cfg.detection_cache, cfg)) {
+        return -1;
+    }
 
     // Iterate over all images in the directory
-    for (const auto& entry : std::filesystem::directory_iterator(image_directory)) {
-        std::string image_path = entry.path().string();
-
-        // Skip non-image files
-        if (entry.path().extension() != ".jpeg" && entry.path().extension() != ".jpg" && entry.path().extension() != ".png") {
-            continue;
-        }
-
-        cv::Mat image = cv::imread(image_path);
-
-        // Check if the image is loaded successfully
-        if (image.empty()) {
+    for (const std::string& image_path : calib::listImages(cfg.image_dir)) {
+        // The image itself is only needed to display it
+        calib::Detection detection;
+        cv::Mat image;
+        if (!cache.detect(image_path, cfg, detection, nullptr, cfg.display ? &image : nullptr)) {
             std::cerr << "Error: Could not load image at " << image_path << std::endl;
             continue;
         }
+        image_size = detection.image_size;
+        const std::vector<cv::Point2f>& corners = detection.corners;
 
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-
-        // Find the chess board corners
-        std::vector<cv::Point2f> corners;
-        bool ret = cv::findChessboardCorners(gray, CHECKERBOARD, corners);
-
-        // If found, refine the corner locations and draw them
-        if (ret) {
-            cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1), criteria);
-            
-            // Draw and display the corners
-            cv::drawChessboardCorners(image, CHECKERBOARD, corners, ret);
-            
+        // If found, draw them
+        if (detection.found()) {
             // Print the number of corners and the coordinates of the first corner
             std::cout << "Number of corners found: " << corners.size() << std::endl;
             std::cout << "Coordinates of the first corner: " << corners[0].x << ", " << corners[0].y << std::endl;
 
-            // Display the image with corners
-            cv::imshow("Checkerboard", image);
-            cv::waitKey(1000); // Display each image for 1000 ms
+            // Draw and display the corners
+            if (cfg.display) {
+                cv::drawChessboardCorners(image, CHECKERBOARD, corners, true);
+                cv::imshow("Checkerboard", image);
+                cv::waitKey(1000); // Display each image for 1000 ms
+                cv::destroyAllWindows();
+            }
 
             // Save the detected corners and corresponding 3D world points
             corner_list.push_back(corners);
             point_list.push_back(point_set);
+            view_paths.push_back(image_path);
             std::cout << "Corners and 3D world points saved for image: " << image_path << std::endl;
         } else {
             std::cerr << "Error: Could not find chessboard corners in image: " << image_path << std::endl;
         }
+    }
 
-        cv::destroyAllWindows();
+    clock.lap("load, detect and display");
+    if (cache.isOpen()) {
+        cache.flush();
+        calib::printCacheStats(std::cout, cache.stats());
     }
 
     // If at least 5 calibration images have been selected, run the calibration
-    if (corner_list.size() >= 5) {
-        cv::Mat camera_matrix = cv::Mat::eye(3, 3, CV_64F);
-        camera_matrix.at<double>(0, 2) = gray.cols / 2.0;
-        camera_matrix.at<double>(1, 2) = gray.rows / 2.0;
-        cv::Mat dist_coeffs = cv::Mat::zeros(8, 1, CV_64F);
-        std::vector<cv::Mat> rvecs, tvecs;
+    if (corner_list.size() >= calib::kMinCalibrationViews) {
+        calib::Intrinsics initial = calib::initialIntrinsics(image_size, calib::distortionModel(cfg));
 
-        std::cout << "Camera matrix before calibration:\n" << camera_matrix << std::endl;
-        std::cout << "Distortion coefficients before calibration:\n" << dist_coeffs << std::endl;
+        std::cout << "Camera matrix before calibration:\n" << initial.camera_matrix << std::endl;
+        std::cout << "Distortion model: " << calib::distortionModelName(initial.model) << std::endl;
+        std::cout << "Distortion coefficients before calibration:\n" << initial.dist_coeffs << std::endl;
 
-        double reprojection_error = cv::calibrateCamera(point_list, corner_list, gray.size(), camera_matrix, dist_coeffs, rvecs, tvecs);
+        calib::CalibrationResult result = calib::calibrate(point_list, corner_list, image_size, initial);
+        clock.lap("calibrate");
 
         std::cout << "Calibration successful!" << std::endl;
-        std::cout << "Reprojection error: " << reprojection_error << std::endl;
-        std::cout << "Camera matrix after calibration:\n" << camera_matrix << std::endl;
-        std::cout << "Distortion coefficients after calibration:\n" << dist_coeffs << std::endl;
+        std::cout << "Reprojection error: " << result.reprojection_error << std::endl;
+        std::cout << "Camera matrix after calibration:\n" << result.intrinsics.camera_matrix << std::endl;
+        std::cout << "Distortion coefficients after calibration:\n" << result.intrinsics.dist_coeffs << std::endl;
+
+        // Bundle-adjust intrinsics and view poses, dropping views that do not fit
+        std::vector<bool> rejected;
+        if (cfg.refine && result.intrinsics.model == calib::DistortionModel::Fisheye) {
+            std::cout << "Skipping refinement, which supports the pinhole distortion models only" << std::endl;
+        } else if (cfg.refine) {
+            // A failed refinement leaves result as calibrateCamera returned it,
+            // which is still saved
+            calib::RefineReport report;
+            if (!calib::refineCalibration(point_list, corner_list, calib::refineOptions(cfg), result, report)) {
+                std::cerr << "Refinement failed, keeping the unrefined calibration" << std::endl;
+            } else {
+                std::cout << "Refinement: RMS " << report.initial_rms << " -> " << report.final_rms << " px in "
+                          << report.iterations << " iterations (" << report.seconds << " s)" << std::endl;
+                for (size_t i = 0; i < view_paths.size(); ++i) {
+                    std::cout << "  " << view_paths[i] << ": " << report.view_rms[i] << " px"
+                              << (report.rejected[i] ? " (rejected)" : "") << std::endl;
+                }
+                std::cout << "Camera matrix after refinement:\n" << result.intrinsics.camera_matrix << std::endl;
+                std::cout << "Distortion coefficients after refinement:\n" << result.intrinsics.dist_coeffs
+                          << std::endl;
+                rejected = report.rejected;
+            }
+            clock.lap("refine");
+        }
+
+        // Per-view and per-corner residuals, corner coverage and quality gates
+        calib::CalibrationReport quality;
+        if (!cfg.report_file.empty()) {
+            quality = calib::buildReport(point_list, corner_list, result, image_size, view_paths, rejected,
+                                         calib::reportOptions(cfg));
+            clock.lap("report");
+            quality.timings = clock.stages();
+            calib::printReportSummary(std::cout, quality);
+            if (calib::writeReport(cfg.report_file, quality)) {
+                std::cout << "Report saved to " << cfg.report_file << ".html and .json" << std::endl;
+            }
+        }
 
         // Save the intrinsic parameters to a file
-        std::ofstream file("calibration_parameters.txt");
-        file << "Camera matrix:\n" << camera_matrix << "\n";
-        file << "Distortion coefficients:\n" << dist_coeffs << "\n";
-        file << "Reprojection error:\n" << reprojection_error << "\n";
-        file.close();
-        std::cout << "Calibration parameters saved to calibration_parameters.txt" << std::endl;
+        if (calib::saveCalibration(cfg.calibration_file, result.intrinsics, result.reprojection_error)) {
+            std::cout << "Calibration parameters saved to " << cfg.calibration_file << std::endl;
+        }
 
         // Save the rotations and translations
-        std::ofstream rt_file("rotations_translations.txt");
-        for (size_t i = 0; i < rvecs.size(); ++i) {
-            rt_file << "Image " << i + 1 << ":\n";
-            rt_file << "Rotation vector:\n" << rvecs[i] << "\n";
-            rt_file << "Translation vector:\n" << tvecs[i] << "\n";
+        if (calib::saveViewPoses("rotations_translations.txt", result.rvecs, result.tvecs)) {
+            std::cout << "Rotations and translations saved to rotations_translations.txt" << std::endl;
+        }
+
+        if (cfg.report_enforce && !quality.passed()) {
+            return 2;
         }
-        rt_file.close();
-        std::cout << "Rotations and translations saved to rotations_translations.txt" << std::endl;
     } else {
-        std::cerr << "Not enough calibration images. At least 5 are required." << std::endl;
+        std::cerr << "Not enough calibration images. At least " << calib::kMinCalibrationViews << " are required." << std::endl;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,46 +1,30 @@
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include "calib/calib.hpp"
 
-int main() {
-    // Read the camera calibration parameters from a file
-    cv::Mat camera_matrix, dist_coeffs;
-    std::ifstream file("calibration_parameters.txt");
-    if (file.is_open()) {
-        std::string line;
-        while (std::getline(file, line)) {
-            if (line.find("Camera matrix:") != std::string::npos) {
-                camera_matrix = cv::Mat::eye(3, 3, CV_64F);
-                for (int i = 0; i < 3; ++i) {
-                    for (int j = 0; j < 3; ++j) {
-                        file >> camera_matrix.at<double>(i, j);
-                    }
-                }
-            } else if (line.find("Distortion coefficients:") != std::string::npos) {
-                dist_coeffs = cv::Mat::zeros(8, 1, CV_64F);
-                for (int i = 0; i < 8; ++i) {
-                    file >> dist_coeffs.at<double>(i);
-                }
-            }
-        }
-        file.close();
-    } else {
-        std::cerr << "Error: Could not open calibration_parameters.txt" << std::endl;
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
         return -1;
     }
 
-    // Define the checkerboard dimensions
-    cv::Size CHECKERBOARD(9, 6);
-    std::vector<cv::Vec3f> point_set;
-    for (int i = 0; i < CHECKERBOARD.height; i++) {
-        for (int j = 0; j < CHECKERBOARD.width; j++) {
-            point_set.push_back(cv::Vec3f(j, -i, 0));
-        }
+    // Read the camera calibration parameters from a file
+    calib::Intrinsics intrinsics;
+    if (!calib::loadCalibration(cfg.calibration_file, intrinsics)) {
+        return -1;
     }
 
-    // Start video capture
-    cv::VideoCapture cap(0); // Use the default camera (index 0)
-    if (!cap.isOpened()) {
+    // Fixed-size copy of the intrinsics for the per-frame pose path
+    const calib::Camera camera = calib::toCamera(intrinsics);
+
+    // 3D world points of the board
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+
+    // Start video capture (camera, video file or image sequence, see calib.cfg)
+    calib::FrameSource source;
+    if (!source.open(cfg)) {
         std::cerr << "Error: Could not open video capture" << std::endl;
         return -1;
     }
@@ -52,53 +36,164 @@ int main() {
         return -1;
     }
 
-    while (true) {
-        cv::Mat frame, gray;
-        cap >> frame;
-        if (frame.empty()) {
-            std::cerr << "Error: Could not capture frame" << std::endl;
-            break;
+    // Binary trajectory of every tracked pose, for analysis tools
+    calib::TrajectoryWriter trajectory;
+    if (!cfg.trajectory_file.empty() && !trajectory.open(cfg.trajectory_file, calib::trajectoryOptions(cfg))) {
+        return -1;
+    }
+
+    // Live pose channel for other processes; publish() is a no-op when closed
+    calib::PosePublisher pose_channel;
+    if (!cfg.pose_channel.empty() &&
+        !pose_channel.open(cfg.pose_channel, static_cast<uint32_t>(cfg.pose_channel_capacity))) {
+        return -1;
+    }
+
+    // Annotated frames for viewers and frame_recorder; the ring is sized on
+    // the first frame
+    calib::FramePublisher frame_channel;
+
+    // AR drawing, blended onto only the parts of the frame it covers
+    calib::Overlay overlay(cfg);
+
+    // Skips full detection on frames without a board
+    calib::BoardGate gate(cfg);
+
+    // Detection and refinement at the quality level that keeps frames
+    // within quality_budget_ms
+    calib::QualityController quality(cfg);
+
+    // Keeps IPPE from flipping between the board's mirror-image poses
+    calib::PoseTracker pose_tracker(calib::poseOptions(cfg));
+
+    // The boards listed in the boards key, even a single one, are detected
+    // together, each with its own pose tracker; without the key the board
+    // of board_width x board_height takes the single-board path
+    calib::MultiBoardDetector boards(cfg);
+    const bool multi_board = !cfg.boards.empty();
+
+    calib::Frame captured;
+    int processed = 0;
+    bool stopped_by_user = false;
+    int64_t start_ticks = cv::getTickCount();
+
+    while (source.read(captured)) {
+        cv::Mat& frame = captured.image;
+        cv::Mat gray;
+        processed++;
+        quality.beginFrame();
+
+        calib::toGray(frame, gray);
+
+        // Find the chess board corners, refine them to subpixel accuracy and
+        // estimate the board pose. With boards configured, every board is
+        // found in one pass and the poses are solved in parallel.
+        std::vector<calib::BoardDetection> detections;
+        if (multi_board) {
+            boards.detect(gray, detections);
+            quality.lap(calib::FrameStage::Detect);
+            boards.solvePoses(camera, detections);
+        } else {
+            calib::BoardDetection detection;
+            if (quality.detect(gray, detection.corners, gate)) {
+                detection.board = 0;
+                detection.posed = pose_tracker.solve(point_set, detection.corners, camera, detection.pose);
+                if (detection.posed) {
+                    detection.error = calib::reprojectionError(point_set, detection.corners, camera, detection.pose);
+                }
+                detections.push_back(std::move(detection));
+            } else {
+                pose_tracker.reset();
+            }
         }
 
-        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        // Draw each board and record its pose
+        overlay.begin();
+        for (const calib::BoardDetection& detection : detections) {
+            const calib::BoardSpec& spec = boards.boards()[detection.board];
+            if (quality.level().overlay_detail) overlay.chessboardCorners(spec.size, detection.corners, true);
+
+            // A board whose pose could not be solved is drawn but not recorded
+            if (!detection.posed) continue;
 
-        // Find the chess board corners
-        std::vector<cv::Point2f> corners;
-        bool ret = cv::findChessboardCorners(gray, CHECKERBOARD, corners);
+            calib::PoseSample pose;
+            pose.timestamp = captured.timestamp;
+            pose.frame = captured.index;
+            pose.rvec = detection.pose.rvec;
+            pose.tvec = detection.pose.tvec;
+            pose.error = detection.error;
 
-        // If found, refine the corner locations and draw them
-        if (ret) {
-            cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001));
-            cv::drawChessboardCorners(frame, CHECKERBOARD, corners, ret);
+            // Hand the pose to live subscribers before any file output; the
+            // channel and the trajectory carry the first board only
+            if (detection.board == 0) pose_channel.publish(calib::toPoseMessage(pose));
 
-            // Solve for pose
-            cv::Mat rvec, tvec;
-            cv::solvePnP(point_set, corners, camera_matrix, dist_coeffs, rvec, tvec);
+            // Print rotation and translation vectors and save them to file
+            if (multi_board) {
+                std::cout << "Board " << detection.board << ":\n";
+                rt_file << "Board " << detection.board << ":\n";
+            }
+            calib::writePose(std::cout, detection.pose);
+            calib::writePose(rt_file, detection.pose);
+            if (detection.board == 0 && trajectory.isOpen()) {
+                trajectory.append(pose);
+            }
 
-            // Print rotation and translation vectors
-            std::cout << "Rotation vector: " << rvec.t() << std::endl;
-            std::cout << "Translation vector: " << tvec.t() << std::endl;
+            // Draw the axes (three squares long)
+            overlay.axes(camera, detection.pose, 3 * static_cast<float>(spec.square_size));
+        }
 
-            // Save rotation and translation vectors to file
-            rt_file << "Rotation vector: " << rvec.t() << std::endl;
-            rt_file << "Translation vector: " << tvec.t() << std::endl;
+        quality.lap(calib::FrameStage::Pose);
+        overlay.composite(frame);
+        quality.lap(calib::FrameStage::Draw);
 
-            // Project 3D points onto the image plane
-            std::vector<cv::Point3f> axes_points = { {0, 0, 0}, {3, 0, 0}, {0, 3, 0}, {0, 0, -3} };
-            std::vector<cv::Point2f> image_points;
-            cv::projectPoints(axes_points, rvec, tvec, camera_matrix, dist_coeffs, image_points);
+        // Hand the annotated frame to viewers and recorders in other processes
+        if (!cfg.frame_channel.empty()) {
+            if (!frame_channel.isOpen() &&
+                !frame_channel.open(cfg.frame_channel, static_cast<uint32_t>(cfg.frame_channel_slots),
+                                    frame.total() * frame.elemSize())) {
+                return -1;
+            }
+            frame_channel.publish(frame, captured.index, captured.timestamp);
+        }
+        quality.lap(calib::FrameStage::Output);
+        quality.endFrame();
 
-            // Draw the axes
-            cv::line(frame, image_points[0], image_points[1], cv::Scalar(0, 0, 255), 2);
-            cv::line(frame, image_points[0], image_points[2], cv::Scalar(0, 255, 0), 2);
-            cv::line(frame, image_points[0], image_points[3], cv::Scalar(255, 0, 0), 2);
+        // Display the frame (not counted against the budget)
+        if (cfg.display) {
+            cv::imshow("Video", frame);
+            // Keys 1-4 toggle overlay layers, any other key stops
+            int key = cv::waitKey(source.isLive() ? 30 : 1);
+            if (key >= 0 && !overlay.handleKey(key)) {
+                stopped_by_user = true;
+                break;
+            }
         }
+    }
 
-        // Display the frame
-        cv::imshow("Video", frame);
-        if (cv::waitKey(30) >= 0) break;
+    if (source.isLive()) {
+        if (!stopped_by_user) std::cerr << "Error: Could not capture frame" << std::endl;
+    } else {
+        double seconds = (cv::getTickCount() - start_ticks) / cv::getTickFrequency();
+        double fps = processed / std::max(seconds, 1e-9);
+        std::cout << "Processed " << processed << " frames in " << seconds << " s (" << fps << " fps, "
+                  << fps / source.fps() << "x real time)" << std::endl;
+    }
+
+    calib::printGateStats(std::cout, gate.stats());
+    if (multi_board) {
+        calib::printMultiBoardStats(std::cout, boards.stats(), boards.boards().size());
+        for (size_t i = 0; i < boards.boards().size(); ++i) {
+            std::cout << "Board " << i << ": ";
+            calib::printPoseStats(std::cout, pose_tracker.options(), boards.poseStats(static_cast<int>(i)));
+        }
+    } else {
+        calib::printPoseStats(std::cout, pose_tracker.options(), pose_tracker.stats());
     }
+    calib::printQualityMetrics(std::cout, quality.options(), quality.metrics());
 
     rt_file.close();
+    trajectory.close();
+    pose_channel.close();
+    frame_channel.close();
     return 0;
-}
\ No newline at end of file
+}
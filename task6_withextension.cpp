@@ -2,13 +2,21 @@
 
 #include <opencv2/opencv.hpp>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 #include <filesystem>
+#include "calib/calib.hpp"
 
-// Function to draw 3D objects (pyramid, cube, and prism) on the image
-void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans) {
+// Scale object points given in board squares to world units
+static void scalePoints(std::vector<cv::Vec3f> &points, float scale) {
+    for (auto &p : points) {
+        p *= scale;
+    }
+}
+
+// Function to draw 3D objects (pyramid, cube, and prism) on the overlay.
+// Object coordinates are in board squares and scaled by the square size.
+void draw3dObject(calib::Overlay &overlay, const calib::Intrinsics &intrinsics, const cv::Mat &rot, const cv::Mat &trans, float square_size) {
     // PYRAMID
     std::vector<cv::Vec3f> pyramid_points;
     pyramid_points.push_back(cv::Vec3f({0, 0, -3})); // apex
@@ -16,10 +24,11 @@ void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv:
     pyramid_points.push_back(cv::Vec3f({1, -1, 0})); // br
     pyramid_points.push_back(cv::Vec3f({-1, -1, 0})); // bl
     pyramid_points.push_back(cv::Vec3f({-1, 1, 0})); // tl
+    scalePoints(pyramid_points, square_size);
     
     std::vector<cv::Point2f> pyramid_corners;
     
-    cv::projectPoints(pyramid_points, rot, trans, camera_matrix, dist_coeff, pyramid_corners);
+    calib::projectPoints(pyramid_points, rot, trans, intrinsics, pyramid_corners);
 
     std::cout << "Pyramid corners: ";
     for (const auto& corner : pyramid_corners) {
@@ -27,14 +36,14 @@ void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv:
     }
     std::cout << std::endl;
 
-    cv::line(src, pyramid_corners[0], pyramid_corners[1], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[0], pyramid_corners[2], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[0], pyramid_corners[3], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[0], pyramid_corners[4], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[1], pyramid_corners[2], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[2], pyramid_corners[3], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[3], pyramid_corners[4], cv::Scalar(0, 255, 255), 2);
-    cv::line(src, pyramid_corners[4], pyramid_corners[1], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[0], pyramid_corners[1], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[0], pyramid_corners[2], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[0], pyramid_corners[3], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[0], pyramid_corners[4], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[1], pyramid_corners[2], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[2], pyramid_corners[3], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[3], pyramid_corners[4], cv::Scalar(0, 255, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, pyramid_corners[4], pyramid_corners[1], cv::Scalar(0, 255, 255), 2);
         
     pyramid_points.clear();
     pyramid_corners.clear();
@@ -49,10 +58,11 @@ void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv:
     cube_points.push_back(cv::Vec3f({2, 0, 0})); // brb
     cube_points.push_back(cv::Vec3f({0, 0, 0})); // blb
     cube_points.push_back(cv::Vec3f({0, 2, 0})); // tlb
+    scalePoints(cube_points, square_size);
     
     std::vector<cv::Point2f> cube_corners;
     
-    cv::projectPoints(cube_points, rot, trans, camera_matrix, dist_coeff, cube_corners);
+    calib::projectPoints(cube_points, rot, trans, intrinsics, cube_corners);
 
     std::cout << "Cube corners: ";
     for (const auto& corner : cube_corners) {
@@ -60,18 +70,18 @@ void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv:
     }
     std::cout << std::endl;
 
-    cv::line(src, cube_corners[0], cube_corners[1], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[1], cube_corners[2], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[2], cube_corners[3], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[3], cube_corners[0], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[4], cube_corners[5], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[5], cube_corners[6], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[6], cube_corners[7], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[7], cube_corners[4], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[0], cube_corners[4], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[1], cube_corners[5], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[2], cube_corners[6], cv::Scalar(255, 255, 0), 2);
-    cv::line(src, cube_corners[3], cube_corners[7], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[0], cube_corners[1], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[1], cube_corners[2], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[2], cube_corners[3], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[3], cube_corners[0], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[4], cube_corners[5], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[5], cube_corners[6], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[6], cube_corners[7], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[7], cube_corners[4], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[0], cube_corners[4], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[1], cube_corners[5], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[2], cube_corners[6], cv::Scalar(255, 255, 0), 2);
+    overlay.line(calib::OverlayLayer::Objects, cube_corners[3], cube_corners[7], cv::Scalar(255, 255, 0), 2);
     
     cube_points.clear();
     cube_corners.clear();
@@ -83,10 +93,11 @@ void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv:
     prism_points.push_back(cv::Vec3f({-4, -4, -1})); // blf
     prism_points.push_back(cv::Vec3f({-4, -2, -1})); // tlf
     prism_points.push_back(cv::Vec3f({-3, -3, 1})); // apex
+    scalePoints(prism_points, square_size);
     
     std::vector<cv::Point2f> prism_corners;
     
-    cv::projectPoints(prism_points, rot, trans, camera_matrix, dist_coeff, prism_corners);
+    calib::projectPoints(prism_points, rot, trans, intrinsics, prism_corners);
 
     std::cout << "Prism corners: ";
     for (const auto& corner : prism_corners) {
@@ -94,105 +105,149 @@ void draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv:
     }
     std::cout << std::endl;
 
-    cv::line(src, prism_corners[0], prism_corners[1], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[1], prism_corners[2], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[2], prism_corners[3], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[3], prism_corners[0], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[0], prism_corners[4], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[1], prism_corners[4], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[2], prism_corners[4], cv::Scalar(255, 0, 255), 2);
-    cv::line(src, prism_corners[3], prism_corners[4], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[0], prism_corners[1], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[1], prism_corners[2], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[2], prism_corners[3], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[3], prism_corners[0], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[0], prism_corners[4], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[1], prism_corners[4], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[2], prism_corners[4], cv::Scalar(255, 0, 255), 2);
+    overlay.line(calib::OverlayLayer::Objects, prism_corners[3], prism_corners[4], cv::Scalar(255, 0, 255), 2);
 }
 
-bool isImageFile(const std::string& filename) {
-    std::vector<std::string> extensions = {".jpg", ".jpeg", ".png", ".bmp", ".tiff"};
-    for (const auto& ext : extensions) {
-        if (filename.size() >= ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0) {
-            return true;
-        }
-    }
-    return false;
+// The same objects as filled meshes for the rasterizer, in world units
+std::vector<calib::Mesh> objectMeshes(float square_size) {
+    const std::vector<cv::Vec3i> pyramid_faces = {{0, 1, 2}, {0, 2, 3}, {0, 3, 4}, {0, 4, 1}, {1, 2, 3}, {1, 3, 4}};
+    std::vector<cv::Vec3f> pyramid_points = {{0, 0, -3}, {1, 1, 0}, {1, -1, 0}, {-1, -1, 0}, {-1, 1, 0}};
+    std::vector<cv::Vec3f> prism_points = {{-2, -2, -1}, {-2, -4, -1}, {-4, -4, -1}, {-4, -2, -1}, {-3, -3, 1}};
+    scalePoints(pyramid_points, square_size);
+    scalePoints(prism_points, square_size);
+    // The prism's apex is vertex 4 rather than 0
+    const std::vector<cv::Vec3i> prism_faces = {{4, 0, 1}, {4, 1, 2}, {4, 2, 3}, {4, 3, 0}, {0, 1, 2}, {0, 2, 3}};
+
+    std::vector<calib::Mesh> meshes;
+    meshes.push_back(calib::makeMesh(pyramid_points, pyramid_faces, cv::Scalar(0, 255, 255)));
+    meshes.push_back(calib::boxMesh(cv::Vec3f(0, 0, -2) * square_size, cv::Vec3f(2, 2, 0) * square_size,
+                                    cv::Scalar(255, 255, 0)));
+    meshes.push_back(calib::makeMesh(prism_points, prism_faces, cv::Scalar(255, 0, 255)));
+    return meshes;
 }
 
-int main() {
-    // Read the camera calibration parameters from a file
-    cv::Mat camera_matrix = (cv::Mat_<double>(3, 3) << 3798.033892402914, 0, 666.3589707850728,
-                                                       0, 2547.018779697359, 544.6239271635342,
-                                                       0, 0, 1);
-    cv::Mat dist_coeffs = (cv::Mat_<double>(5, 1) << 4.122649975238361,
-                                                     -1623.806667310265,
-                                                     0.7493398563977504,
-                                                     0.06095266374411317,
-                                                     -34.614502945302644);
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
+
+    // Camera calibration parameters used for this task
+    calib::Intrinsics intrinsics;
+    intrinsics.camera_matrix = (cv::Mat_<double>(3, 3) << 3798.033892402914, 0, 666.3589707850728,
+                                                          0, 2547.018779697359, 544.6239271635342,
+                                                          0, 0, 1);
+    intrinsics.dist_coeffs = (cv::Mat_<double>(5, 1) << 4.122649975238361,
+                                                        -1623.806667310265,
+                                                        0.7493398563977504,
+                                                        0.06095266374411317,
+                                                        -34.614502945302644);
 
     // Print calibration parameters for debugging
-    std::cout << "Camera matrix:\n" << camera_matrix << std::endl;
-    std::cout << "Distortion coefficients:\n" << dist_coeffs << std::endl;
+    std::cout << "Camera matrix:\n" << intrinsics.camera_matrix << std::endl;
+    std::cout << "Distortion coefficients:\n" << intrinsics.dist_coeffs << std::endl;
 
     // Define the checkerboard dimensions
-    cv::Size CHECKERBOARD(9, 6);
-    std::vector<cv::Vec3f> point_set;
-    for (int i = 0; i < CHECKERBOARD.height; i++) {
-        for (int j = 0; j < CHECKERBOARD.width; j++) {
-            point_set.push_back(cv::Vec3f(j, -i, 0));
-        }
+    cv::Size CHECKERBOARD = cfg.boardSize();
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+
+    // AR drawing, blended onto only the parts of the image it covers
+    calib::Overlay overlay(cfg);
+
+    // Filled objects are rasterized into the frame under the overlay
+    const bool filled = cfg.render_mode != "wireframe";
+    const calib::Camera camera = calib::toCamera(intrinsics);
+    const std::vector<calib::Mesh> meshes = objectMeshes(static_cast<float>(cfg.square_size));
+    calib::Rasterizer rasterizer(calib::rasterOptions(cfg));
+
+    // Detections of images seen before come from the cache
+    calib::DetectionCache cache;
+    if (!cfg.detection_cache.empty() && !cache.open(cfg.detection_cache, cfg)) {
+        return -1;
     }
 
-    // Directory containing the images
-    std::string image_directory = "images"; // Change this to your image directory
-
     // Iterate through the images in the directory
-    for (const auto& entry : std::filesystem::directory_iterator(image_directory)) {
-        std::string image_path = entry.path().string();
-        std::cout << "Checking file: " << image_path << std::endl;
-        if (!isImageFile(image_path)) {
-            std::cout << "Skipping non-image file: " << image_path << std::endl;
-            continue;
-        }
-
+    for (const std::string& image_path : calib::listImages(cfg.image_dir)) {
         std::cout << "Processing image: " << image_path << std::endl;
-        cv::Mat frame = cv::imread(image_path);
-        if (frame.empty()) {
+
+        // Find the chess board corners and refine them to subpixel accuracy,
+        // or take them from the cache; the image is decoded for drawing
+        calib::Detection detection;
+        cv::Mat frame;
+        if (!cache.detect(image_path, cfg, detection, nullptr, &frame)) {
             std::cerr << "Error: Could not open image " << image_path << std::endl;
             continue;
         }
+        const std::vector<cv::Point2f>& corners = detection.corners;
+        bool ret = detection.found();
 
-        cv::Mat gray;
-        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-
-        // Find the chess board corners
-        std::vector<cv::Point2f> corners;
-        bool ret = cv::findChessboardCorners(gray, CHECKERBOARD, corners);
-
-        // If found, refine the corner locations and draw them
+        // If found, draw them and estimate the board pose
+        overlay.begin();
+        rasterizer.begin(frame.size());
         if (ret) {
-            cv::cornerSubPix(gray, corners, cv::Size(11, 11), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001));
-            cv::drawChessboardCorners(frame, CHECKERBOARD, corners, ret);
+            overlay.chessboardCorners(CHECKERBOARD, corners, ret);
 
-            // Solve for pose
+            // Solve for pose; without one the view is shown but not saved
             cv::Mat rvec, tvec;
-            cv::solvePnP(point_set, corners, camera_matrix, dist_coeffs, rvec, tvec);
-
-            // Print rotation and translation vectors
-            std::cout << "Rotation vector: " << rvec.t() << std::endl;
-            std::cout << "Translation vector: " << tvec.t() << std::endl;
-
-            // Draw 3D objects on the image
-            std::cout << "Drawing 3D objects..." << std::endl;
-            draw3dObject(frame, camera_matrix, dist_coeffs, rvec, tvec);
-
-            // Save the frame to a file
-            std::string output_filename = "output_" + entry.path().filename().string();
-            cv::imwrite(output_filename, frame);
-            std::cout << "Frame saved as " << output_filename << std::endl;
+            ret = calib::solvePose(point_set, corners, intrinsics, rvec, tvec);
+            if (ret) {
+                // Print rotation and translation vectors
+                calib::writePose(std::cout, rvec, tvec);
+
+                // Draw 3D objects on the image
+                std::cout << "Drawing 3D objects..." << std::endl;
+                if (filled) {
+                    const calib::Pose pose = calib::toPose(rvec, tvec);
+                    for (const calib::Mesh& mesh : meshes) rasterizer.draw(mesh, camera, pose);
+                } else {
+                    draw3dObject(overlay, intrinsics, rvec, tvec, static_cast<float>(cfg.square_size));
+                }
+            } else {
+                std::cerr << "Error: Could not solve the board pose in image " << image_path << std::endl;
+            }
         } else {
             std::cerr << "Error: Could not find chessboard corners in image " << image_path << std::endl;
         }
 
-        // Display the frame
-        cv::imshow("Image", frame);
-        if (cv::waitKey(0) >= 0) break; // Wait for a key press to move to the next image
+        // The rasterizer keeps its triangles, so the objects can be drawn
+        // again whenever the overlay is
+        auto annotate = [&](cv::Mat& annotated) {
+            frame.copyTo(annotated);
+            if (overlay.visible(calib::OverlayLayer::Objects)) rasterizer.render(annotated);
+            overlay.composite(annotated);
+        };
+        cv::Mat annotated;
+        annotate(annotated);
+
+        // Save the frame to a file
+        if (ret) {
+            std::string output_filename = "output_" + std::filesystem::path(image_path).filename().string();
+            cv::imwrite(output_filename, annotated);
+            std::cout << "Frame saved as " << output_filename << std::endl;
+        }
+
+        // Display the frame. Keys 1-4 toggle overlay layers on this image,
+        // 'q' or Esc stops, any other key moves to the next one.
+        cv::imshow("Image", annotated);
+        int key;
+        while (overlay.handleKey(key = cv::waitKey(0))) {
+            annotate(annotated);
+            cv::imshow("Image", annotated);
+        }
+        if (key == 'q' || key == 27) break;
+    }
+
+    if (cache.isOpen()) {
+        cache.flush();
+        calib::printCacheStats(std::cout, cache.stats());
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,9 +1,15 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
+#include "calib/config.hpp"
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
 
-int main() {
     // Start video capture
-    cv::VideoCapture cap(0); // Use the default camera (index 0)
+    cv::VideoCapture cap(cfg.camera_index);
     if (!cap.isOpened()) {
         std::cerr << "Error: Could not open video capture" << std::endl;
         return -1;
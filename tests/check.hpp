@@ -0,0 +1,72 @@
+#pragma once
+
+// Minimal test harness: each TEST registers a function, CHECK records a
+// failure and keeps going, and runAllTests returns the process exit code.
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace calib_test {
+
+struct TestCase {
+    std::string name;
+    std::function<void()> fn;
+};
+
+inline std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+struct Registrar {
+    Registrar(const std::string& name, std::function<void()> fn) { registry().push_back({name, std::move(fn)}); }
+};
+
+inline int runAllTests() {
+    int failed_tests = 0;
+    for (const auto& test : registry()) {
+        int before = failures();
+        test.fn();
+        bool ok = failures() == before;
+        if (!ok) failed_tests++;
+        std::cout << (ok ? "[PASS] " : "[FAIL] ") << test.name << std::endl;
+    }
+    std::cout << registry().size() - failed_tests << "/" << registry().size() << " tests passed" << std::endl;
+    return failed_tests == 0 ? 0 : 1;
+}
+
+}  // namespace calib_test
+
+#define CALIB_TEST_CONCAT2(a, b) a##b
+#define CALIB_TEST_CONCAT(a, b) CALIB_TEST_CONCAT2(a, b)
+
+#define TEST(name)                                                                               \
+    static void name();                                                                          \
+    static calib_test::Registrar CALIB_TEST_CONCAT(name, _registrar)(#name, name);               \
+    static void name()
+
+#define CHECK(cond)                                                                              \
+    do {                                                                                         \
+        if (!(cond)) {                                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            calib_test::failures()++;                                                            \
+        }                                                                                        \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                                    \
+    do {                                                                                         \
+        double calib_a = (a), calib_b = (b);                                                     \
+        if (!(std::abs(calib_a - calib_b) <= (tol))) {                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #a ", " #b ") failed: "  \
+                      << calib_a << " vs " << calib_b << std::endl;                              \
+            calib_test::failures()++;                                                            \
+        }                                                                                        \
+    } while (0)
@@ -0,0 +1,632 @@
+// Accuracy and throughput regression suite. Runs the detection, calibration,
+// pose and projection paths over a synthetic dataset with exact ground truth
+// and over the checked-in images/, checks their errors against the golden
+// limits in tests/golden/regression.yml, and records the throughput of every
+// path next to its errors in regression_results.yml. A speedup that changes
+// accuracy fails here in the same run that measures it.
+//
+//   calib_regression                  check against the golden data
+//   calib_regression --update-golden  also rewrite the image reference values
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "calib/calib.hpp"
+#include "check.hpp"
+
+namespace {
+
+const std::string kSourceDir = CALIB_SOURCE_DIR;
+const std::string kGoldenPath = kSourceDir + "/tests/golden/regression.yml";
+const std::string kResultsPath = "regression_results.yml";
+
+// Synthetic dataset: a 9x6 board seen by a 1280x720 camera with radial
+// distortion, from kSyntheticViews fixed poses
+const cv::Size kSyntheticSize(1280, 720);
+constexpr int kSyntheticViews = 12;
+constexpr int kTexelsPerSquare = 64;
+
+// Repeats of the cheap paths, so their rates are measurable
+constexpr int kPoseRepeats = 200;
+constexpr int kProjectionRepeats = 20000;
+
+// ---------------------------------------------------------------------------
+// Results: every error next to its limit, every rate next to the errors
+// ---------------------------------------------------------------------------
+
+struct Metric {
+    std::string name;
+    double value;
+    double limit;
+};
+
+struct Rate {
+    std::string name;
+    int64_t items;
+    double ms;
+};
+
+std::vector<Metric>& metrics() {
+    static std::vector<Metric> list;
+    return list;
+}
+
+std::vector<Rate>& rates() {
+    static std::vector<Rate> list;
+    return list;
+}
+
+// Record an error and fail the test if it is above its limit
+void checkWithin(const std::string& name, double value, double limit) {
+    metrics().push_back({name, value, limit});
+    if (!(value <= limit)) {
+        std::cerr << name << ": " << value << " exceeds the golden limit " << limit << std::endl;
+        calib_test::failures()++;
+    }
+}
+
+// With --update-golden the golden image values are rewritten from this run
+bool updating = false;
+
+// Record a drift from the golden image values. When they are being rewritten
+// the drift is reported only: the new values replace the reference.
+void checkDrift(const std::string& name, double value, double limit) {
+    if (updating) {
+        metrics().push_back({name, value, limit});
+        return;
+    }
+    checkWithin(name, value, limit);
+}
+
+void recordRate(const std::string& name, int64_t items, int64_t ticks) {
+    rates().push_back({name, items, ticks * 1000.0 / cv::getTickFrequency()});
+}
+
+// ---------------------------------------------------------------------------
+// Golden data
+// ---------------------------------------------------------------------------
+
+struct GoldenView {
+    std::string name;
+    std::vector<cv::Point2f> corners;
+    calib::Pose pose;
+};
+
+struct Golden {
+    // Synthetic limits against ground truth
+    double corner_rms = 0, corner_max = 0, focal_rel = 0, principal = 0, distortion_k1 = 0, calibration_rms = 0;
+    double pose_rotation_deg = 0, pose_translation_rel = 0, projection = 0;
+    // Image tolerances around the reference values
+    struct {
+        double corner = 0, focal_rel = 0, principal = 0, calibration_rms = 0, pose_rotation_deg = 0;
+        double pose_translation_rel = 0;
+    } tolerance;
+    // Image reference values
+    cv::Size image_size;
+    calib::Intrinsics intrinsics;
+    double image_calibration_rms = 0;
+    std::vector<GoldenView> views;
+};
+
+bool loadGolden(const std::string& path, Golden& golden) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        std::cerr << "Error: Could not open golden data " << path << std::endl;
+        return false;
+    }
+    const cv::FileNode synthetic = fs["synthetic"];
+    golden.corner_rms = synthetic["corner_rms"];
+    golden.corner_max = synthetic["corner_max"];
+    golden.focal_rel = synthetic["focal_rel"];
+    golden.principal = synthetic["principal"];
+    golden.distortion_k1 = synthetic["distortion_k1"];
+    golden.calibration_rms = synthetic["calibration_rms"];
+    golden.pose_rotation_deg = synthetic["pose_rotation_deg"];
+    golden.pose_translation_rel = synthetic["pose_translation_rel"];
+    golden.projection = synthetic["projection"];
+
+    const cv::FileNode images = fs["images"];
+    const cv::FileNode tolerance = images["tolerance"];
+    golden.tolerance.corner = tolerance["corner"];
+    golden.tolerance.focal_rel = tolerance["focal_rel"];
+    golden.tolerance.principal = tolerance["principal"];
+    golden.tolerance.calibration_rms = tolerance["calibration_rms"];
+    golden.tolerance.pose_rotation_deg = tolerance["pose_rotation_deg"];
+    golden.tolerance.pose_translation_rel = tolerance["pose_translation_rel"];
+    golden.image_size = cv::Size(static_cast<int>(images["image_width"]), static_cast<int>(images["image_height"]));
+    images["camera_matrix"] >> golden.intrinsics.camera_matrix;
+    images["dist_coeffs"] >> golden.intrinsics.dist_coeffs;
+    golden.image_calibration_rms = images["calibration_rms"];
+    for (const cv::FileNode& node : images["views"]) {
+        GoldenView view;
+        cv::Mat corners, rvec, tvec;
+        node["name"] >> view.name;
+        node["corners"] >> corners;
+        node["rvec"] >> rvec;
+        node["tvec"] >> tvec;
+        corners.copyTo(view.corners);
+        view.pose = calib::toPose(rvec, tvec);
+        golden.views.push_back(std::move(view));
+    }
+    if (golden.intrinsics.camera_matrix.empty() || golden.views.empty()) {
+        std::cerr << "Error: Golden data " << path << " has no image reference values" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool saveGolden(const std::string& path, const Golden& golden) {
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::cerr << "Error: Could not write golden data " << path << std::endl;
+        return false;
+    }
+    fs.writeComment("Golden data of calib_regression (tests/regression.cpp). The synthetic limits");
+    fs.writeComment("and the image tolerances are set by hand; the image reference values are");
+    fs.writeComment("rewritten by \"calib_regression --update-golden\".");
+    fs << "synthetic" << "{";
+    fs << "corner_rms" << golden.corner_rms << "corner_max" << golden.corner_max << "focal_rel" << golden.focal_rel
+       << "principal" << golden.principal << "distortion_k1" << golden.distortion_k1 << "calibration_rms"
+       << golden.calibration_rms << "pose_rotation_deg" << golden.pose_rotation_deg << "pose_translation_rel"
+       << golden.pose_translation_rel << "projection" << golden.projection;
+    fs << "}";
+    fs << "images" << "{";
+    fs << "tolerance" << "{";
+    fs << "corner" << golden.tolerance.corner << "focal_rel" << golden.tolerance.focal_rel << "principal"
+       << golden.tolerance.principal << "calibration_rms" << golden.tolerance.calibration_rms << "pose_rotation_deg"
+       << golden.tolerance.pose_rotation_deg << "pose_translation_rel" << golden.tolerance.pose_translation_rel;
+    fs << "}";
+    fs << "image_width" << golden.image_size.width << "image_height" << golden.image_size.height;
+    fs << "camera_matrix" << golden.intrinsics.camera_matrix << "dist_coeffs" << golden.intrinsics.dist_coeffs;
+    fs << "calibration_rms" << golden.image_calibration_rms;
+    fs << "views" << "[";
+    for (const GoldenView& view : golden.views) {
+        fs << "{" << "name" << view.name << "corners" << cv::Mat(view.corners) << "rvec" << cv::Mat(view.pose.rvec)
+           << "tvec" << cv::Mat(view.pose.tvec) << "}";
+    }
+    fs << "]";
+    fs << "}";
+    return true;
+}
+
+Golden& golden() {
+    static Golden data;
+    return data;
+}
+
+// ---------------------------------------------------------------------------
+// Error measures
+// ---------------------------------------------------------------------------
+
+double rotationErrorDeg(const calib::Pose& a, const calib::Pose& b) {
+    const double c = (cv::trace(a.rotation().t() * b.rotation()) - 1.0) / 2.0;
+    return std::acos(std::min(1.0, std::max(-1.0, c))) * 180.0 / CV_PI;
+}
+
+double translationErrorRel(const calib::Pose& pose, const calib::Pose& truth) {
+    return cv::norm(pose.tvec - truth.tvec) / cv::norm(truth.tvec);
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic dataset
+// ---------------------------------------------------------------------------
+
+struct SyntheticView {
+    cv::Mat gray;
+    calib::Pose pose;
+    std::vector<cv::Point2f> truth;     // projected board corners
+    std::vector<cv::Point2f> detected;  // in the order of truth, empty if not found
+};
+
+calib::Intrinsics syntheticIntrinsics() {
+    calib::Intrinsics intrinsics = calib::initialIntrinsics(kSyntheticSize);
+    intrinsics.camera_matrix.at<double>(0, 0) = intrinsics.camera_matrix.at<double>(1, 1) = 1000;
+    intrinsics.dist_coeffs.at<double>(0) = -0.1;
+    intrinsics.dist_coeffs.at<double>(1) = 0.02;
+    return intrinsics;
+}
+
+// A view of the board centre from about 20 squares, tilted by up to 25
+// degrees; the poses are fixed so every run sees the same images
+calib::Pose syntheticPose(int view) {
+    calib::Pose pose;
+    pose.rvec = cv::Vec3d(0.45 * std::sin(view * 1.3), 0.45 * std::cos(view * 0.9), 0.25 * std::sin(view * 0.7));
+    const cv::Vec3d center(4.0, -2.5, 0.0);
+    pose.tvec = cv::Vec3d(1.5 * std::sin(view * 2.1), std::cos(view * 1.7), 20.0 + 4.0 * std::sin(view * 0.5)) -
+                pose.rotation() * center;
+    return pose;
+}
+
+// The board with a light margin of one square, kTexelsPerSquare texels per
+// square. Texel (x, y) is board point ((x + 0.5) / S - 2, 2 - (y + 0.5) / S),
+// so the corners of boardPoints() fall on texel corners.
+cv::Mat boardTexture(cv::Size board) {
+    const int S = kTexelsPerSquare;
+    cv::Mat texture((board.height + 3) * S, (board.width + 3) * S, CV_8U, cv::Scalar(225));
+    for (int sy = 0; sy < board.height + 3; ++sy) {
+        for (int sx = 0; sx < board.width + 3; ++sx) {
+            const int a = sx - 2, b = 1 - sy;  // lower left corner of the square
+            if (a >= -1 && a < board.width && b >= -board.height && b < 1 && ((a + b) & 1) == 0) {
+                texture(cv::Rect(sx * S, sy * S, S, S)).setTo(30);
+            }
+        }
+    }
+    // Antialiasing for the texture's minification
+    cv::GaussianBlur(texture, texture, cv::Size(), S / 32.0);
+    return texture;
+}
+
+// Render every view by casting each pixel's undistorted ray onto the board
+// plane, then match the detections to the ground truth
+std::vector<SyntheticView> renderSyntheticViews(const calib::Config& cfg) {
+    const calib::Intrinsics intrinsics = syntheticIntrinsics();
+    const std::vector<cv::Vec3f> points = calib::boardPoints(cfg);
+    const cv::Mat texture = boardTexture(cfg.boardSize());
+
+    std::vector<cv::Point2f> pixels, rays;
+    pixels.reserve(kSyntheticSize.area());
+    for (int y = 0; y < kSyntheticSize.height; ++y) {
+        for (int x = 0; x < kSyntheticSize.width; ++x) {
+            pixels.emplace_back(static_cast<float>(x), static_cast<float>(y));
+        }
+    }
+    calib::undistortPoints(pixels, intrinsics, rays);
+
+    std::vector<SyntheticView> views(kSyntheticViews);
+    cv::Mat map_x(kSyntheticSize, CV_32F), map_y(kSyntheticSize, CV_32F);
+    for (int v = 0; v < kSyntheticViews; ++v) {
+        SyntheticView& view = views[v];
+        view.pose = syntheticPose(v);
+        const cv::Matx33d R = view.pose.rotation();
+        const cv::Vec3d& t = view.pose.tvec;
+        // Board plane to normalized image: the homography [r1 r2 t]
+        const cv::Matx33d to_board =
+            cv::Matx33d(R(0, 0), R(0, 1), t[0], R(1, 0), R(1, 1), t[1], R(2, 0), R(2, 1), t[2]).inv();
+        float* mx = map_x.ptr<float>();
+        float* my = map_y.ptr<float>();
+        for (int i = 0; i < kSyntheticSize.area(); ++i) {
+            const cv::Vec3d p = to_board * cv::Vec3d(rays[i].x, rays[i].y, 1.0);
+            const double a = p[0] / p[2], b = p[1] / p[2];
+            mx[i] = static_cast<float>((a + 2.0) * kTexelsPerSquare - 0.5);
+            my[i] = static_cast<float>((2.0 - b) * kTexelsPerSquare - 0.5);
+        }
+        cv::remap(texture, view.gray, map_x, map_y, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(128));
+        cv::GaussianBlur(view.gray, view.gray, cv::Size(), 0.7);
+        calib::projectPoints(points, view.pose, calib::toCamera(intrinsics), view.truth);
+    }
+    return views;
+}
+
+// The detected corner nearest to each true corner, so an equivalent
+// labelling of the symmetric board does not count as an error
+std::vector<cv::Point2f> matchToTruth(const std::vector<cv::Point2f>& detected,
+                                      const std::vector<cv::Point2f>& truth) {
+    std::vector<cv::Point2f> matched;
+    for (const cv::Point2f& p : truth) {
+        matched.push_back(*std::min_element(detected.begin(), detected.end(), [&](const cv::Point2f& a,
+                                                                                    const cv::Point2f& b) {
+            return cv::norm(a - p) < cv::norm(b - p);
+        }));
+    }
+    return matched;
+}
+
+const calib::Config& config() {
+    static const calib::Config cfg;
+    return cfg;
+}
+
+// Rendered and detected once, shared by the synthetic tests
+std::vector<SyntheticView>& syntheticViews() {
+    static std::vector<SyntheticView> views;
+    if (views.empty()) {
+        views = renderSyntheticViews(config());
+        const int64_t start = cv::getTickCount();
+        for (SyntheticView& view : views) {
+            std::vector<cv::Point2f> corners;
+            if (calib::detectBoard(view.gray, config(), corners)) view.detected = matchToTruth(corners, view.truth);
+        }
+        recordRate("detect synthetic 1280x720", kSyntheticViews, cv::getTickCount() - start);
+    }
+    return views;
+}
+
+// ---------------------------------------------------------------------------
+// Image dataset
+// ---------------------------------------------------------------------------
+
+struct ImageView {
+    std::string name;
+    cv::Size size;
+    std::vector<cv::Point2f> corners;  // empty if not found
+};
+
+// Decoded and detected once, shared by the image tests
+std::vector<ImageView>& imageViews() {
+    static std::vector<ImageView> views;
+    if (views.empty()) {
+        std::vector<cv::Mat> grays;
+        for (const std::string& path : calib::listImages(kSourceDir + "/images")) {
+            cv::Mat gray;
+            calib::toGray(cv::imread(path), gray);
+            if (gray.empty()) continue;
+            views.push_back({std::filesystem::path(path).filename().string(), gray.size(), {}});
+            grays.push_back(gray);
+        }
+        const int64_t start = cv::getTickCount();
+        for (size_t i = 0; i < views.size(); ++i) calib::detectBoard(grays[i], config(), views[i].corners);
+        recordRate("detect images/", static_cast<int64_t>(views.size()), cv::getTickCount() - start);
+    }
+    return views;
+}
+
+const GoldenView* goldenView(const std::string& name) {
+    for (const GoldenView& view : golden().views) {
+        if (view.name == name) return &view;
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+// ---------------------------------------------------------------------------
+// Synthetic: errors against ground truth
+// ---------------------------------------------------------------------------
+
+TEST(SyntheticDetectionFindsTrueCorners) {
+    double sum_sq = 0.0, worst = 0.0;
+    size_t count = 0;
+    for (const SyntheticView& view : syntheticViews()) {
+        CHECK(!view.detected.empty());
+        for (size_t i = 0; i < view.detected.size(); ++i) {
+            const double error = cv::norm(view.detected[i] - view.truth[i]);
+            sum_sq += error * error;
+            worst = std::max(worst, error);
+            count++;
+        }
+    }
+    checkWithin("synthetic corner rms px", std::sqrt(sum_sq / std::max<size_t>(count, 1)), golden().corner_rms);
+    checkWithin("synthetic corner max px", worst, golden().corner_max);
+}
+
+TEST(SyntheticCalibrationRecoversIntrinsics) {
+    const std::vector<cv::Vec3f> points = calib::boardPoints(config());
+    std::vector<std::vector<cv::Vec3f>> object_points;
+    std::vector<std::vector<cv::Point2f>> image_points;
+    for (const SyntheticView& view : syntheticViews()) {
+        if (view.detected.empty()) continue;
+        object_points.push_back(points);
+        image_points.push_back(view.detected);
+    }
+    CHECK(image_points.size() >= calib::kMinCalibrationViews);
+    if (image_points.size() < calib::kMinCalibrationViews) return;
+
+    const int64_t start = cv::getTickCount();
+    const calib::CalibrationResult result =
+        calib::calibrate(object_points, image_points, kSyntheticSize, calib::initialIntrinsics(kSyntheticSize));
+    recordRate("calibrate synthetic", 1, cv::getTickCount() - start);
+
+    const cv::Mat& K = result.intrinsics.camera_matrix;
+    const cv::Mat& truth = syntheticIntrinsics().camera_matrix;
+    checkWithin("synthetic fx relative", std::abs(K.at<double>(0, 0) / truth.at<double>(0, 0) - 1.0),
+                golden().focal_rel);
+    checkWithin("synthetic fy relative", std::abs(K.at<double>(1, 1) / truth.at<double>(1, 1) - 1.0),
+                golden().focal_rel);
+    checkWithin("synthetic cx px", std::abs(K.at<double>(0, 2) - truth.at<double>(0, 2)), golden().principal);
+    checkWithin("synthetic cy px", std::abs(K.at<double>(1, 2) - truth.at<double>(1, 2)), golden().principal);
+    checkWithin("synthetic k1",
+                std::abs(result.intrinsics.dist_coeffs.at<double>(0) - syntheticIntrinsics().dist_coeffs.at<double>(0)),
+                golden().distortion_k1);
+    checkWithin("synthetic calibration rms px", result.reprojection_error, golden().calibration_rms);
+}
+
+TEST(SyntheticPoseMatchesTruth) {
+    const calib::Camera camera = calib::toCamera(syntheticIntrinsics());
+    const std::vector<cv::Vec3f> points = calib::boardPoints(config());
+    for (calib::PoseSolver solver : {calib::PoseSolver::Iterative, calib::PoseSolver::Ippe, calib::PoseSolver::Sqpnp}) {
+        calib::PoseOptions options;
+        options.solver = solver;
+        const std::string name = calib::poseSolverName(solver);
+
+        // Accuracy from independent solves, throughput from a tracker that
+        // runs over the views repeatedly as a tracking tool would
+        double rotation = 0.0, translation = 0.0;
+        for (const SyntheticView& view : syntheticViews()) {
+            calib::Pose pose;
+            if (view.detected.empty() || !calib::solvePose(points, view.detected, camera, pose, options)) {
+                CHECK(view.detected.empty());
+                continue;
+            }
+            rotation = std::max(rotation, rotationErrorDeg(pose, view.pose));
+            translation = std::max(translation, translationErrorRel(pose, view.pose));
+        }
+        checkWithin("synthetic pose " + name + " rotation deg", rotation, golden().pose_rotation_deg);
+        checkWithin("synthetic pose " + name + " translation relative", translation, golden().pose_translation_rel);
+
+        calib::PoseTracker tracker(options);
+        calib::Pose pose;
+        int64_t solves = 0;
+        const int64_t start = cv::getTickCount();
+        for (int r = 0; r < kPoseRepeats; ++r) {
+            for (const SyntheticView& view : syntheticViews()) {
+                if (view.detected.empty()) continue;
+                tracker.solve(points, view.detected, camera, pose);
+                solves++;
+            }
+        }
+        recordRate("pose " + name, solves, cv::getTickCount() - start);
+    }
+}
+
+TEST(ProjectionMatchesOpenCV) {
+    const calib::Intrinsics intrinsics = syntheticIntrinsics();
+    const calib::Camera camera = calib::toCamera(intrinsics);
+    const std::vector<cv::Vec3f> points = calib::boardPoints(config());
+    double worst = 0.0;
+    for (const SyntheticView& view : syntheticViews()) {
+        std::vector<cv::Point2f> projected, reference;
+        calib::projectPoints(points, view.pose, camera, projected);
+        cv::projectPoints(points, view.pose.rvec, view.pose.tvec, intrinsics.camera_matrix, intrinsics.dist_coeffs,
+                          reference);
+        for (size_t i = 0; i < projected.size(); ++i) worst = std::max(worst, cv::norm(projected[i] - reference[i]));
+    }
+    checkWithin("projection max px", worst, golden().projection);
+
+    const calib::Pose pose = syntheticPose(0);
+    std::vector<cv::Point2f> projected(points.size());
+    int64_t start = cv::getTickCount();
+    for (int r = 0; r < kProjectionRepeats; ++r) calib::projectPoints(points, pose, camera, projected.data());
+    recordRate("project points (fixed)", static_cast<int64_t>(kProjectionRepeats * points.size()),
+               cv::getTickCount() - start);
+    const cv::Mat rvec(pose.rvec), tvec(pose.tvec);
+    start = cv::getTickCount();
+    for (int r = 0; r < kProjectionRepeats; ++r) calib::projectPoints(points, rvec, tvec, intrinsics, projected);
+    recordRate("project points (Mat)", static_cast<int64_t>(kProjectionRepeats * points.size()),
+               cv::getTickCount() - start);
+}
+
+// ---------------------------------------------------------------------------
+// images/: errors against the golden reference values
+// ---------------------------------------------------------------------------
+
+TEST(ImageDetectionMatchesGolden) {
+    const std::vector<ImageView>& views = imageViews();
+    // New or removed images are expected when the reference is rewritten
+    CHECK(updating || views.size() == golden().views.size());
+    double worst = 0.0;
+    for (const ImageView& view : views) {
+        CHECK(!view.corners.empty());
+        const GoldenView* reference = goldenView(view.name);
+        CHECK(updating || reference != nullptr);
+        if (!reference || view.corners.size() != reference->corners.size()) continue;
+        for (size_t i = 0; i < view.corners.size(); ++i) {
+            worst = std::max(worst, cv::norm(view.corners[i] - reference->corners[i]));
+        }
+    }
+    checkDrift("images corner drift px", worst, golden().tolerance.corner);
+}
+
+TEST(ImageCalibrationMatchesGolden) {
+    // The calibration task3 runs: every view that has a board, at the size of
+    // the last one
+    const std::vector<cv::Vec3f> points = calib::boardPoints(config());
+    std::vector<std::vector<cv::Vec3f>> object_points;
+    std::vector<std::vector<cv::Point2f>> image_points;
+    cv::Size image_size;
+    for (const ImageView& view : imageViews()) {
+        if (view.corners.empty()) continue;
+        object_points.push_back(points);
+        image_points.push_back(view.corners);
+        image_size = view.size;
+    }
+    CHECK(image_points.size() >= calib::kMinCalibrationViews);
+    if (image_points.size() < calib::kMinCalibrationViews) return;
+
+    const int64_t start = cv::getTickCount();
+    const calib::CalibrationResult result =
+        calib::calibrate(object_points, image_points, image_size, calib::initialIntrinsics(image_size));
+    recordRate("calibrate images/", 1, cv::getTickCount() - start);
+
+    Golden& reference = golden();
+    const cv::Mat& K = result.intrinsics.camera_matrix;
+    const cv::Mat& G = reference.intrinsics.camera_matrix;
+    CHECK(updating || image_size == reference.image_size);
+    checkDrift("images fx drift relative", std::abs(K.at<double>(0, 0) / G.at<double>(0, 0) - 1.0),
+                reference.tolerance.focal_rel);
+    checkDrift("images fy drift relative", std::abs(K.at<double>(1, 1) / G.at<double>(1, 1) - 1.0),
+                reference.tolerance.focal_rel);
+    checkDrift("images cx drift px", std::abs(K.at<double>(0, 2) - G.at<double>(0, 2)),
+                reference.tolerance.principal);
+    checkDrift("images cy drift px", std::abs(K.at<double>(1, 2) - G.at<double>(1, 2)),
+                reference.tolerance.principal);
+    checkDrift("images calibration rms drift px",
+                std::abs(result.reprojection_error - reference.image_calibration_rms),
+                reference.tolerance.calibration_rms);
+
+    if (updating) {
+        reference.image_size = image_size;
+        reference.intrinsics = result.intrinsics;
+        reference.image_calibration_rms = result.reprojection_error;
+    }
+}
+
+TEST(ImagePoseMatchesGolden) {
+    // Solved with the golden intrinsics, so only the corners and the solver
+    // can move the poses
+    const calib::Camera camera = calib::toCamera(golden().intrinsics);
+    const std::vector<cv::Vec3f> points = calib::boardPoints(config());
+    double rotation = 0.0, translation = 0.0;
+    std::vector<GoldenView> updated;
+    for (const ImageView& view : imageViews()) {
+        calib::Pose pose;
+        if (view.corners.empty() || !calib::solvePose(points, view.corners, camera, pose)) {
+            CHECK(view.corners.empty());
+            continue;
+        }
+        updated.push_back({view.name, view.corners, pose});
+        const GoldenView* reference = goldenView(view.name);
+        if (!reference) continue;
+        rotation = std::max(rotation, rotationErrorDeg(pose, reference->pose));
+        translation = std::max(translation, translationErrorRel(pose, reference->pose));
+    }
+    checkDrift("images pose rotation drift deg", rotation, golden().tolerance.pose_rotation_deg);
+    checkDrift("images pose translation drift relative", translation, golden().tolerance.pose_translation_rel);
+
+    if (updating) golden().views = updated;
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--update-golden") {
+            updating = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--update-golden]" << std::endl;
+            return 2;
+        }
+    }
+    if (!loadGolden(kGoldenPath, golden())) return 1;
+
+    const int status = calib_test::runAllTests();
+
+    std::cout << std::left << std::setw(44) << "metric" << std::right << std::setw(14) << "value" << std::setw(14)
+              << "limit" << std::endl;
+    for (const Metric& metric : metrics()) {
+        std::cout << std::left << std::setw(44) << metric.name << std::right << std::setw(14) << metric.value
+                  << std::setw(14) << metric.limit << std::endl;
+    }
+    std::cout << std::left << std::setw(44) << "path" << std::right << std::setw(14) << "items" << std::setw(14)
+              << "items/s" << std::endl;
+    for (const Rate& rate : rates()) {
+        std::cout << std::left << std::setw(44) << rate.name << std::right << std::setw(14) << rate.items
+                  << std::setw(14) << (rate.ms > 0 ? rate.items * 1000.0 / rate.ms : 0.0) << std::endl;
+    }
+
+    // Errors and rates of this run side by side, for comparing runs
+    cv::FileStorage results(kResultsPath, cv::FileStorage::WRITE);
+    if (results.isOpened()) {
+        results << "opencv_threads" << cv::getNumThreads();
+        results << "metrics" << "[";
+        for (const Metric& metric : metrics()) {
+            results << "{" << "name" << metric.name << "value" << metric.value << "limit" << metric.limit << "}";
+        }
+        results << "]" << "throughput" << "[";
+        for (const Rate& rate : rates()) {
+            results << "{" << "name" << rate.name << "items" << static_cast<double>(rate.items) << "ms" << rate.ms
+                    << "}";
+        }
+        results << "]";
+        std::cout << "Results written to " << kResultsPath << std::endl;
+    }
+
+    if (updating) {
+        if (!saveGolden(kGoldenPath, golden())) return 1;
+        std::cout << "Golden image reference values written to " << kGoldenPath << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,945 @@
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "calib/calib.hpp"
+#include "check.hpp"
+
+namespace {
+
+const std::string kSourceDir = CALIB_SOURCE_DIR;
+
+calib::Intrinsics testIntrinsics() {
+    calib::Intrinsics intrinsics;
+    intrinsics.camera_matrix = (cv::Mat_<double>(3, 3) << 800, 0, 320, 0, 800, 240, 0, 0, 1);
+    intrinsics.dist_coeffs = (cv::Mat_<double>(5, 1) << 0.1, -0.05, 0.001, -0.001, 0.01);
+    return intrinsics;
+}
+
+}  // namespace
+
+TEST(ConfigCommandLineOverrides) {
+    calib::Config cfg;
+    const char* argv[] = {"calib_tests", "--board_width=7", "--square-size", "25", "--fast_check=on"};
+    CHECK(calib::loadConfig(5, const_cast<char**>(argv), cfg));
+    CHECK(cfg.boardSize() == cv::Size(7, 6));
+    CHECK_NEAR(cfg.square_size, 25.0, 1e-12);
+    CHECK((cfg.chessboardFlags() & cv::CALIB_CB_FAST_CHECK) != 0);
+}
+
+TEST(ConfigRejectsBadInput) {
+    calib::Config cfg;
+    CHECK(!calib::applySetting(cfg, "no_such_key", "1"));
+    CHECK(!calib::applySetting(cfg, "board_width", "nine"));
+    CHECK(!calib::applySetting(cfg, "square_size", "-1"));
+    CHECK(cfg.board_width == 9);
+}
+
+TEST(BoardPointsUseSquareSize) {
+    calib::Config cfg;
+    cfg.square_size = 2.5;
+    std::vector<cv::Vec3f> points = calib::boardPoints(cfg);
+    CHECK(points.size() == 54);
+    CHECK_NEAR(points[1][0], 2.5, 1e-6);
+    CHECK_NEAR(points[9][1], -2.5, 1e-6);
+    CHECK_NEAR(points[53][0], 20.0, 1e-6);
+}
+
+TEST(ImageFileFilter) {
+    CHECK(calib::isImageFile("images/image1.jpeg"));
+    CHECK(calib::isImageFile("a/B.PNG"));
+    CHECK(!calib::isImageFile("calibration_parameters.txt"));
+    CHECK(calib::listImages(kSourceDir + "/images").size() == 5);
+}
+
+TEST(LoadCheckedInCalibration) {
+    calib::Intrinsics intrinsics;
+    CHECK(calib::loadCalibration(kSourceDir + "/calibration_parameters.txt", intrinsics));
+    CHECK(intrinsics.camera_matrix.rows == 3 && intrinsics.camera_matrix.cols == 3);
+    CHECK_NEAR(intrinsics.camera_matrix.at<double>(0, 0), 37980.33892402914, 1e-6);
+    CHECK_NEAR(intrinsics.camera_matrix.at<double>(1, 2), 544.6239271635342, 1e-9);
+    CHECK(intrinsics.dist_coeffs.total() == 5);
+    CHECK(intrinsics.model == calib::DistortionModel::RadTan5);
+}
+
+TEST(CalibrationFileRoundTrip) {
+    calib::Intrinsics saved = testIntrinsics(), loaded;
+    std::string path = "roundtrip_calibration.txt";
+    CHECK(calib::saveCalibration(path, saved, 0.25));
+    CHECK(calib::loadCalibration(path, loaded));
+    CHECK(cv::norm(saved.camera_matrix, loaded.camera_matrix) < 1e-9);
+    CHECK(cv::norm(saved.dist_coeffs, loaded.dist_coeffs) < 1e-9);
+    std::remove(path.c_str());
+}
+
+TEST(DetectCheckerboardImage) {
+    calib::Config cfg;
+    cv::Mat image = cv::imread(kSourceDir + "/checkerboard.png");
+    CHECK(!image.empty());
+    cv::Mat gray;
+    calib::toGray(image, gray);
+    std::vector<cv::Point2f> corners;
+    CHECK(calib::detectBoard(gray, cfg, corners));
+    CHECK(corners.size() == 54);
+}
+
+TEST(ImageSequenceRangeAndStep) {
+    calib::Config cfg;
+    cfg.input = kSourceDir + "/images";
+    cfg.start_frame = 1;
+    cfg.frame_step = 2;
+    cfg.prefetch = 2;
+    cfg.decode_threads = 3;
+    calib::FrameSource source;
+    CHECK(source.open(cfg));
+    std::vector<int64_t> indices;
+    calib::Frame frame;
+    while (source.read(frame)) {
+        CHECK(!frame.image.empty());
+        indices.push_back(frame.index);
+    }
+    CHECK((indices == std::vector<int64_t>{1, 3}));
+}
+
+TEST(TrajectoryRoundTripAndSeek) {
+    calib::TrajectoryOptions options;
+    options.chunk_rows = 4;
+    std::string path = "roundtrip.ctraj";
+    calib::TrajectoryColumns written;
+    calib::TrajectoryWriter writer;
+    CHECK(writer.open(path, options));
+    for (int i = 0; i < 10; ++i) {
+        calib::PoseSample pose;
+        pose.frame = 100 + 3 * i;
+        pose.timestamp = pose.frame / 30.0;
+        pose.rvec = cv::Vec3d(0.1 * i, -0.2, 0.3);
+        pose.tvec = cv::Vec3d(1, 2, 20 + i);
+        pose.error = 0.01 * i;
+        CHECK(writer.append(pose));
+        written.append(pose);
+    }
+    calib::PoseSample backwards;
+    backwards.frame = 50;
+    CHECK(!writer.append(backwards));
+    CHECK(writer.close());
+
+    calib::TrajectoryReader reader;
+    CHECK(reader.open(path));
+    CHECK(reader.size() == 10 && reader.chunkCount() == 3);
+    calib::TrajectoryColumns all;
+    CHECK(reader.readAll(all));
+    CHECK(all.frame == written.frame);
+    CHECK(all.rvec == written.rvec && all.tvec == written.tvec);
+    CHECK_NEAR(all.timestamp[9], written.timestamp[9], 1e-6);
+
+    CHECK(reader.findFrame(112) == 4);
+    CHECK(reader.findFrame(113) == 5);
+    CHECK(reader.findFrame(0) == 0);
+    CHECK(reader.findFrame(1000) == 10);
+    CHECK(reader.findTime(109 / 30.0 - 1e-3) == 3);
+    calib::TrajectoryColumns range;
+    CHECK(reader.readRows(3, 9, range));
+    CHECK(range.size() == 6 && range.frame.front() == 109 && range.frame.back() == 124);
+    std::remove(path.c_str());
+}
+
+TEST(LoadTextPoseLog) {
+    std::vector<int64_t> frames;
+    std::vector<cv::Vec3d> rvecs, tvecs;
+    CHECK(calib::loadPoseLog(kSourceDir + "/rotation_translation_vectors.txt", frames, rvecs, tvecs));
+    CHECK(frames.size() == 213 && frames.back() == 212);
+    CHECK_NEAR(rvecs[0][2], 37.34550093005255, 1e-12);
+    CHECK(calib::loadPoseLog(kSourceDir + "/rotations_translations.txt", frames, rvecs, tvecs));
+    CHECK(!frames.empty() && frames.front() == 1);
+    CHECK_NEAR(rvecs[0][0], 2.484727866219654, 1e-12);
+}
+
+TEST(PoseRecoversSyntheticView) {
+    calib::Config cfg;
+    calib::Intrinsics intrinsics = testIntrinsics();
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    cv::Mat rvec_true = (cv::Mat_<double>(3, 1) << 0.2, -0.3, 0.1);
+    cv::Mat tvec_true = (cv::Mat_<double>(3, 1) << -4, 2, 20);
+
+    std::vector<cv::Point2f> corners;
+    calib::projectPoints(point_set, rvec_true, tvec_true, intrinsics, corners);
+
+    cv::Mat rvec, tvec;
+    CHECK(calib::solvePose(point_set, corners, intrinsics, rvec, tvec));
+    CHECK(cv::norm(rvec, rvec_true) < 1e-4);
+    CHECK(cv::norm(tvec, tvec_true) < 1e-3);
+}
+
+TEST(RefinementRecoversIntrinsicsAndRejectsBadView) {
+    calib::Config cfg;
+    calib::Intrinsics truth = testIntrinsics();
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    cv::RNG rng(7);
+
+    std::vector<std::vector<cv::Vec3f>> object_points;
+    std::vector<std::vector<cv::Point2f>> image_points;
+    for (int v = 0; v < 20; ++v) {
+        cv::Mat rvec = (cv::Mat_<double>(3, 1) << rng.uniform(-0.5, 0.5), rng.uniform(-0.5, 0.5), rng.uniform(-0.3, 0.3));
+        cv::Mat tvec = (cv::Mat_<double>(3, 1) << rng.uniform(-6.0, -2.0), rng.uniform(-1.0, 3.0), rng.uniform(15.0, 25.0));
+        std::vector<cv::Point2f> corners;
+        calib::projectPoints(point_set, rvec, tvec, truth, corners);
+        // View 3 is badly detected, the rest have 0.1 px noise
+        double sigma = v == 3 ? 5.0 : 0.1;
+        for (auto& c : corners) {
+            c.x += static_cast<float>(rng.gaussian(sigma));
+            c.y += static_cast<float>(rng.gaussian(sigma));
+        }
+        object_points.push_back(point_set);
+        image_points.push_back(corners);
+    }
+
+    calib::CalibrationResult result;
+    result.intrinsics.camera_matrix = (cv::Mat_<double>(3, 3) << 760, 0, 330, 0, 830, 230, 0, 0, 1);
+    result.intrinsics.dist_coeffs = cv::Mat::zeros(5, 1, CV_64F);
+    for (const auto& corners : image_points) {
+        cv::Mat rvec, tvec;
+        calib::solvePose(point_set, corners, result.intrinsics, rvec, tvec);
+        result.rvecs.push_back(rvec);
+        result.tvecs.push_back(tvec);
+    }
+
+    calib::RefineReport report;
+    CHECK(calib::refineCalibration(object_points, image_points, calib::RefineOptions(), result, report));
+    CHECK(report.rejected[3]);
+    CHECK(std::count(report.rejected.begin(), report.rejected.end(), true) == 1);
+    CHECK(report.final_rms < 0.2 && report.final_rms < report.initial_rms);
+    CHECK_NEAR(result.intrinsics.camera_matrix.at<double>(0, 0), 800.0, 5.0);
+    CHECK_NEAR(result.intrinsics.camera_matrix.at<double>(1, 2), 240.0, 5.0);
+    CHECK_NEAR(result.intrinsics.dist_coeffs.at<double>(0), 0.1, 0.03);
+}
+
+TEST(RigRecoversExtrinsics) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    calib::Intrinsics cam0 = testIntrinsics(), cam1 = testIntrinsics();
+    cam1.camera_matrix.at<double>(0, 0) = cam1.camera_matrix.at<double>(1, 1) = 820;
+    cv::Vec3d rig_r(0.0, 0.05, 0.0), rig_t(-3.0, 0.1, 0.5);
+    cv::RNG rng(11);
+
+    calib::RigObservations observations;
+    observations.cameras = {"cam0", "cam1"};
+    observations.image_sizes = {cv::Size(640, 480), cv::Size(640, 480)};
+    observations.corners.resize(2);
+    for (int f = 0; f < 12; ++f) {
+        observations.frame_sets.push_back("frame" + std::to_string(f) + ".png");
+        cv::Vec3d r(rng.uniform(-0.4, 0.4), rng.uniform(-0.4, 0.4), rng.uniform(-0.2, 0.2));
+        cv::Vec3d t(rng.uniform(-3.0, -1.0), rng.uniform(1.0, 3.0), rng.uniform(18.0, 24.0));
+        cv::Vec3d r1, t1;
+        cv::composeRT(r, t, rig_r, rig_t, r1, t1);
+        std::vector<cv::Point2f> corners0, corners1;
+        calib::projectPoints(point_set, cv::Mat(r), cv::Mat(t), cam0, corners0);
+        calib::projectPoints(point_set, cv::Mat(r1), cv::Mat(t1), cam1, corners1);
+        observations.corners[0].push_back(corners0);
+        // Camera 1 misses every fourth frame set
+        observations.corners[1].push_back(f % 4 == 3 ? std::vector<cv::Point2f>() : corners1);
+    }
+    CHECK(observations.views(1) == 9);
+
+    calib::RigCalibration rig;
+    CHECK(calib::calibrateRig(observations, point_set, calib::DistortionModel::RadTan5, calib::RefineOptions(), rig));
+    CHECK(rig.rms < 0.05);
+    CHECK(cv::norm(rig.cameras[1].t - rig_t) < 0.02);
+    cv::Vec3d r_est;
+    cv::Rodrigues(rig.cameras[1].R, r_est);
+    CHECK(cv::norm(r_est - rig_r) < 1e-3);
+    CHECK_NEAR(rig.cameras[1].intrinsics.camera_matrix.at<double>(0, 0), 820.0, 1.0);
+
+    // The configured model is kept; fisheye rigs are rejected
+    calib::RigCalibration rational;
+    CHECK(calib::calibrateRig(observations, point_set, calib::DistortionModel::Rational8, calib::RefineOptions(),
+                              rational));
+    CHECK(rational.cameras[1].intrinsics.model == calib::DistortionModel::Rational8);
+    CHECK(rational.cameras[1].intrinsics.dist_coeffs.total() == 8);
+    calib::RigCalibration fisheye;
+    CHECK(!calib::calibrateRig(observations, point_set, calib::DistortionModel::Fisheye, calib::RefineOptions(),
+                               fisheye));
+}
+
+TEST(PoseChannelDeliversInOrderAndReportsLoss) {
+    const std::string name = "/calib_test_" + std::to_string(cv::getTickCount());
+    calib::PosePublisher publisher;
+    CHECK(publisher.open(name, 4));
+    calib::PoseSubscriber subscriber;
+    CHECK(subscriber.open(name));
+
+    calib::PoseMessage message;
+    CHECK(!subscriber.latest(message));
+    CHECK(!subscriber.next(message));
+    for (int i = 0; i < 2; ++i) {
+        message.frame = 100 + i;
+        message.tvec[2] = 0.5 * i;
+        publisher.publish(message);
+    }
+    CHECK(subscriber.next(message) && message.sequence == 0 && message.frame == 100);
+    CHECK(subscriber.next(message) && message.sequence == 1 && message.tvec[2] == 0.5);
+    CHECK(!subscriber.next(message));
+
+    // Ten more poses overrun the four-slot ring: the reader skips to the
+    // oldest one still held and counts the rest as lost
+    for (int i = 2; i < 12; ++i) {
+        message.frame = 100 + i;
+        publisher.publish(message);
+    }
+    CHECK(subscriber.latest(message) && message.frame == 111);
+    CHECK(subscriber.next(message) && message.sequence == 8);
+    CHECK(subscriber.lost() == 6);
+
+    std::atomic<int> received{0};
+    subscriber.subscribe([&](const calib::PoseMessage& pose) {
+        if (pose.frame == 200) received++;
+    });
+    message.frame = 200;
+    publisher.publish(message);
+    for (int i = 0; i < 1000 && received == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    subscriber.unsubscribe();
+    CHECK(received == 1);
+}
+
+TEST(FrameChannelSharesFramesWithoutCopies) {
+    const std::string name = "/calib_test_frames_" + std::to_string(cv::getTickCount());
+    calib::FramePublisher publisher;
+    CHECK(publisher.open(name, 2, 64 * 48 * 3));
+    calib::FrameSubscriber subscriber;
+    CHECK(subscriber.open(name));
+
+    calib::SharedFrame shared;
+    CHECK(!subscriber.latest(shared));
+    for (int i = 0; i < 3; ++i) {
+        cv::Mat image(48, 64, CV_8UC3, cv::Scalar(i, 2 * i, 3 * i));
+        CHECK(publisher.publish(image, 10 + i, 0.1 * i));
+    }
+    // Two slots: the first frame was overwritten before it was read
+    CHECK(subscriber.next(shared) && shared.sequence == 1 && shared.frame == 11);
+    CHECK(subscriber.lost() == 1);
+    CHECK(shared.image.size() == cv::Size(64, 48) && shared.image.type() == CV_8UC3);
+    CHECK(shared.image.at<cv::Vec3b>(20, 30) == cv::Vec3b(1, 2, 3));
+    CHECK(subscriber.valid(shared));
+
+    // Rendering in place, then wrapping around onto the held frame's slot
+    cv::Mat target = publisher.reserve(cv::Size(64, 48), CV_8UC3);
+    CHECK(!target.empty());
+    target.setTo(cv::Scalar(9, 9, 9));
+    publisher.commit(13, 0.3);
+    CHECK(!subscriber.valid(shared));
+    CHECK(subscriber.latest(shared) && shared.frame == 13 && shared.image.at<cv::Vec3b>(0, 0) == cv::Vec3b(9, 9, 9));
+
+    // Frames larger than the slots are rejected
+    CHECK(!publisher.publish(cv::Mat(100, 100, CV_8UC3, cv::Scalar(0)), 14, 0.4));
+    CHECK(publisher.rejected() == 1);
+}
+
+TEST(OverlayBlendsOnlyDirtyTiles) {
+    cv::Mat frame(2160, 3840, CV_8UC3, cv::Scalar(10, 20, 30));
+    calib::Overlay overlay;
+    overlay.begin();
+    overlay.line(calib::OverlayLayer::Axes, cv::Point2f(100, 100), cv::Point2f(300, 100), cv::Scalar(0, 0, 255), 3);
+    overlay.circle(calib::OverlayLayer::Projected, cv::Point2f(2000, 1500), 5, cv::Scalar(255, 0, 255));
+    overlay.composite(frame);
+    CHECK(overlay.redrawn());
+
+    int dirty_area = 0;
+    for (const cv::Rect& rect : overlay.dirtyRects()) dirty_area += rect.area();
+    CHECK(dirty_area <= 10 * calib::Overlay::kTileSize * calib::Overlay::kTileSize);
+    CHECK(frame.at<cv::Vec3b>(100, 200) == cv::Vec3b(0, 0, 255));
+    CHECK(frame.at<cv::Vec3b>(1500, 2000) == cv::Vec3b(255, 0, 255));
+    CHECK(frame.at<cv::Vec3b>(1000, 1000) == cv::Vec3b(10, 20, 30));
+
+    // Same primitives again: blended without redrawing. Hiding a layer
+    // redraws without it.
+    cv::Mat next(frame.size(), CV_8UC3, cv::Scalar(10, 20, 30));
+    overlay.begin();
+    overlay.line(calib::OverlayLayer::Axes, cv::Point2f(100, 100), cv::Point2f(300, 100), cv::Scalar(0, 0, 255), 3);
+    overlay.circle(calib::OverlayLayer::Projected, cv::Point2f(2000, 1500), 5, cv::Scalar(255, 0, 255));
+    overlay.composite(next);
+    CHECK(!overlay.redrawn());
+    CHECK(next.at<cv::Vec3b>(100, 200) == cv::Vec3b(0, 0, 255));
+    overlay.toggle(calib::OverlayLayer::Axes);
+    next.setTo(cv::Scalar(10, 20, 30));
+    overlay.composite(next);
+    CHECK(overlay.redrawn());
+    CHECK(next.at<cv::Vec3b>(100, 200) == cv::Vec3b(10, 20, 30));
+    CHECK(next.at<cv::Vec3b>(1500, 2000) == cv::Vec3b(255, 0, 255));
+}
+
+TEST(PremultipliedBlendMatchesReference) {
+    // Odd width so both the vector loop and the scalar tail run
+    cv::RNG rng(5);
+    cv::Mat overlay(7, 45, CV_8UC4), dst(7, 45, CV_8UC3);
+    rng.fill(dst, cv::RNG::UNIFORM, 0, 256);
+    for (int y = 0; y < overlay.rows; ++y) {
+        for (int x = 0; x < overlay.cols; ++x) {
+            int alpha = rng.uniform(0, 256);
+            cv::Vec4b& o = overlay.at<cv::Vec4b>(y, x);
+            for (int c = 0; c < 3; ++c) o[c] = static_cast<uchar>(rng.uniform(0, alpha + 1));
+            o[3] = static_cast<uchar>(alpha);
+        }
+    }
+    cv::Mat expected = dst.clone();
+    calib::blendPremultiplied(overlay, dst);
+    int max_error = 0;
+    for (int y = 0; y < dst.rows; ++y) {
+        for (int x = 0; x < dst.cols; ++x) {
+            const cv::Vec4b& o = overlay.at<cv::Vec4b>(y, x);
+            for (int c = 0; c < 3; ++c) {
+                double reference = o[c] + expected.at<cv::Vec3b>(y, x)[c] * (255 - o[3]) / 255.0;
+                max_error = std::max(max_error, static_cast<int>(std::abs(dst.at<cv::Vec3b>(y, x)[c] - reference) + 0.5));
+            }
+        }
+    }
+    CHECK(max_error <= 1);
+}
+
+TEST(ReportFlagsBadViewAndCoverage) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    calib::Intrinsics intrinsics = testIntrinsics();
+    cv::RNG rng(13);
+
+    std::vector<std::vector<cv::Vec3f>> object_points;
+    std::vector<std::vector<cv::Point2f>> image_points;
+    calib::CalibrationResult result;
+    result.intrinsics = intrinsics;
+    for (int v = 0; v < 4; ++v) {
+        cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.1 * v, -0.1, 0.05);
+        cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4.0, 2.0, 30.0);
+        std::vector<cv::Point2f> corners;
+        calib::projectPoints(point_set, rvec, tvec, intrinsics, corners);
+        // View 2 is badly detected, the rest are exact
+        if (v == 2) {
+            for (auto& c : corners) {
+                c.x += static_cast<float>(rng.gaussian(5.0));
+                c.y += static_cast<float>(rng.gaussian(5.0));
+            }
+        }
+        object_points.push_back(point_set);
+        image_points.push_back(corners);
+        result.rvecs.push_back(rvec);
+        result.tvecs.push_back(tvec);
+    }
+
+    // The board only covers the middle of the image from 30 units away
+    calib::ReportOptions options;
+    calib::CalibrationReport report =
+        calib::buildReport(object_points, image_points, result, cv::Size(640, 480), {}, {}, options);
+    CHECK(report.coverage.cols == 16 && report.coverage.rows == 12);
+    CHECK(cv::sum(report.coverage)[0] == 4 * 54);
+    CHECK(report.coverage_fraction > 0.0 && report.coverage_fraction < options.min_coverage);
+    CHECK(report.view_rms[0] < 1e-3 && report.view_rms[2] > options.max_view_rms);
+    CHECK(report.corner_rms.size() == 54);
+    CHECK(report.failures.size() == 3);  // overall RMS, view 3 and coverage
+    CHECK(!report.passed());
+
+    // Once the bad view is rejected only the coverage gate fails
+    report = calib::buildReport(object_points, image_points, result, cv::Size(640, 480), {}, {false, false, true},
+                                options);
+    CHECK(report.rms < 1e-3);
+    CHECK(report.failures.size() == 1);
+    options.min_coverage = 0;
+    report = calib::buildReport(object_points, image_points, result, cv::Size(640, 480), {}, {false, false, true},
+                                options);
+    CHECK(report.passed());
+}
+
+TEST(BatchedSubpixMatchesCornerSubPix) {
+    // A blurred chessboard seen in perspective
+    cv::Mat board(7 * 40, 10 * 40, CV_8U, cv::Scalar(25));
+    for (int y = 0; y < 7; ++y) {
+        for (int x = 0; x < 10; ++x) {
+            if ((x + y) % 2 == 0) board(cv::Rect(x * 40, y * 40, 40, 40)).setTo(230);
+        }
+    }
+    std::vector<cv::Point2f> from = {{0, 0}, {400, 0}, {400, 280}, {0, 280}};
+    std::vector<cv::Point2f> to = {{100, 80}, {540, 60}, {580, 420}, {70, 400}};
+    cv::Mat gray;
+    cv::warpPerspective(board, gray, cv::getPerspectiveTransform(from, to), cv::Size(640, 480), cv::INTER_CUBIC,
+                        cv::BORDER_CONSTANT, cv::Scalar(128));
+    cv::GaussianBlur(gray, gray, cv::Size(), 1.2);
+    std::vector<cv::Point2f> coarse;
+    CHECK(cv::findChessboardCorners(gray, cv::Size(9, 6), coarse));
+
+    std::vector<cv::Point2f> expected = coarse;
+    cv::cornerSubPix(gray, expected, cv::Size(11, 11), cv::Size(-1, -1),
+                     cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001));
+    auto maxDifference = [&](const std::vector<cv::Point2f>& corners) {
+        double worst = 0.0;
+        for (size_t i = 0; i < corners.size(); ++i) worst = std::max(worst, cv::norm(corners[i] - expected[i]));
+        return worst;
+    };
+
+    calib::SubpixRefiner refiner;
+    std::vector<cv::Point2f> refined = coarse;
+    refiner.refine(gray, refined);
+    CHECK(maxDifference(refined) < 0.01);
+    const int cold = refiner.lastIterations();
+
+    // The same frame again starts from the previous offsets and converges at once
+    std::vector<cv::Point2f> warm = coarse;
+    refiner.refine(gray, warm);
+    CHECK(refiner.lastIterations() < cold);
+    CHECK(maxDifference(warm) < 0.01);
+
+    // Splitting the board over threads gives the same corners
+    calib::SubpixOptions options;
+    options.parallel_min_corners = 1;
+    calib::SubpixRefiner parallel(options);
+    std::vector<cv::Point2f> split = coarse;
+    parallel.refine(gray, split);
+    CHECK(parallel.lastIterations() == cold);
+    CHECK(split == refined);
+}
+
+TEST(DistortionModelsMatchOpenCV) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.2, -0.3, 0.1);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4, 2, 12);
+    cv::Matx33d R;
+    cv::Rodrigues(rvec, R);
+    const cv::Mat coefficients = (cv::Mat_<double>(8, 1) << 0.1, -0.05, 0.001, -0.001, 0.01, 0.02, -0.01, 0.005);
+
+    for (calib::DistortionModel model : {calib::DistortionModel::None, calib::DistortionModel::Radial2,
+                                         calib::DistortionModel::RadTan5, calib::DistortionModel::Rational8,
+                                         calib::DistortionModel::Fisheye}) {
+        calib::Intrinsics intrinsics = testIntrinsics();
+        intrinsics.model = model;
+        const int n = calib::distortionCoefficients(model);
+        intrinsics.dist_coeffs = n > 0 ? coefficients.rowRange(0, n).clone() : cv::Mat();
+
+        std::vector<cv::Point2f> projected, reference;
+        calib::projectPoints(point_set, rvec, tvec, intrinsics, projected);
+        if (model == calib::DistortionModel::Fisheye) {
+            cv::fisheye::projectPoints(point_set, reference, rvec, tvec, intrinsics.camera_matrix,
+                                       intrinsics.dist_coeffs);
+        } else {
+            cv::projectPoints(point_set, rvec, tvec, intrinsics.camera_matrix, calib::pinholeCoefficients(intrinsics),
+                              reference);
+        }
+        double worst = 0.0;
+        for (size_t i = 0; i < projected.size(); ++i) worst = std::max(worst, cv::norm(projected[i] - reference[i]));
+        CHECK(worst < 1e-3);
+
+        // Undistortion recovers X/Z, Y/Z and the pose comes back
+        std::vector<cv::Point2f> normalized;
+        calib::undistortPoints(projected, intrinsics, normalized);
+        worst = 0.0;
+        for (size_t i = 0; i < point_set.size(); ++i) {
+            const cv::Vec3d X = R * cv::Vec3d(point_set[i][0], point_set[i][1], point_set[i][2]) + cv::Vec3d(tvec);
+            worst = std::max(worst, cv::norm(cv::Point2d(normalized[i]) - cv::Point2d(X[0] / X[2], X[1] / X[2])));
+        }
+        CHECK(worst < 1e-5);
+        cv::Mat r, t;
+        CHECK(calib::solvePose(point_set, projected, intrinsics, r, t));
+        CHECK(cv::norm(t, tvec) < 1e-2);
+    }
+}
+
+TEST(CalibrationKeepsItsDistortionModel) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    calib::Intrinsics truth = testIntrinsics();
+    truth.model = calib::DistortionModel::Radial2;
+    truth.dist_coeffs = (cv::Mat_<double>(2, 1) << 0.1, -0.05);
+    cv::RNG rng(17);
+
+    std::vector<std::vector<cv::Vec3f>> object_points;
+    std::vector<std::vector<cv::Point2f>> image_points;
+    for (int v = 0; v < 12; ++v) {
+        cv::Mat rvec = (cv::Mat_<double>(3, 1) << rng.uniform(-0.5, 0.5), rng.uniform(-0.5, 0.5), rng.uniform(-0.3, 0.3));
+        cv::Mat tvec = (cv::Mat_<double>(3, 1) << rng.uniform(-6.0, -2.0), rng.uniform(-1.0, 3.0), rng.uniform(12.0, 20.0));
+        std::vector<cv::Point2f> corners;
+        calib::projectPoints(point_set, rvec, tvec, truth, corners);
+        object_points.push_back(point_set);
+        image_points.push_back(corners);
+    }
+
+    const cv::Size image_size(640, 480);
+    calib::CalibrationResult result = calib::calibrate(
+        object_points, image_points, image_size, calib::initialIntrinsics(image_size, calib::DistortionModel::Radial2));
+    CHECK(result.intrinsics.model == calib::DistortionModel::Radial2);
+    CHECK(result.intrinsics.dist_coeffs.total() == 2);
+    CHECK(result.reprojection_error < 0.01);
+    CHECK_NEAR(result.intrinsics.dist_coeffs.at<double>(0), 0.1, 1e-3);
+
+    std::string path = "model_calibration.txt";
+    calib::Intrinsics loaded;
+    CHECK(calib::saveCalibration(path, result.intrinsics, result.reprojection_error));
+    CHECK(calib::loadCalibration(path, loaded));
+    CHECK(loaded.model == calib::DistortionModel::Radial2);
+    CHECK(cv::norm(loaded.dist_coeffs, result.intrinsics.dist_coeffs) < 1e-9);
+    std::remove(path.c_str());
+}
+
+TEST(CaptureAssistantAcceptsNovelViewsUntilCovered) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    calib::Intrinsics intrinsics = testIntrinsics();
+    const cv::Mat gray(480, 640, CV_8U, cv::Scalar(128));
+
+    calib::CaptureOptions options;
+    options.min_views = 3;
+    options.min_sharpness = 0;  // the synthetic views have no image
+    options.max_motion = 0;
+    calib::CaptureAssistant assistant(cfg.boardSize(), options);
+
+    auto view = [&](double x, double y) {
+        cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.1, -0.1, 0.05);
+        cv::Mat tvec = (cv::Mat_<double>(3, 1) << x, y, 30.0);
+        std::vector<cv::Point2f> corners;
+        calib::projectPoints(point_set, rvec, tvec, intrinsics, corners);
+        return corners;
+    };
+
+    // The same board turned by 180 degrees is the same view
+    std::vector<cv::Point2f> corners = view(-4.0, -2.5);
+    std::vector<cv::Point2f> reversed(corners.rbegin(), corners.rend());
+    CHECK(calib::viewDistance(calib::viewSignature(corners, cfg.boardSize(), gray.size()),
+                              calib::viewSignature(reversed, cfg.boardSize(), gray.size())) < 1e-9);
+
+    using Verdict = calib::CaptureAssistant::Verdict;
+    CHECK(assistant.offer(gray, {}) == Verdict::NoBoard);
+    CHECK(assistant.offer(gray, corners) == Verdict::Accepted);
+    CHECK(assistant.offer(gray, corners) == Verdict::Redundant);
+    CHECK(assistant.offer(gray, view(-3.9, -2.5)) == Verdict::Redundant);
+
+    // Sweeping the board over the image covers it and ends the capture
+    for (double y : {-9.0, -2.5, 4.0}) {
+        for (double x : {-12.0, -4.0, 4.0}) {
+            if (!assistant.done()) assistant.offer(gray, view(x, y));
+        }
+    }
+    CHECK(assistant.done());
+    CHECK(assistant.views().size() >= 3 && assistant.views().size() <= 9);
+    CHECK(assistant.coverage() >= options.coverage_target);
+    CHECK(assistant.offer(gray, view(0.0, 0.0)) == Verdict::Done);
+
+    // Edge sharpness of a board image, sharp and blurred
+    cv::Mat board(240, 320, CV_8U);
+    for (int y = 0; y < board.rows; ++y) {
+        for (int x = 0; x < board.cols; ++x) board.at<uchar>(y, x) = ((x / 20 + y / 20) % 2) ? 200 : 50;
+    }
+    const cv::Rect all(0, 0, board.cols, board.rows);
+    CHECK_NEAR(calib::edgeSharpness(board, all), 0.5, 0.01);
+    cv::Mat blurred;
+    cv::GaussianBlur(board, blurred, cv::Size(), 3.0);
+    CHECK(calib::edgeSharpness(blurred, all) < calib::CaptureOptions().min_sharpness);
+}
+
+TEST(FixedGeometryMatchesMatPath) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    calib::Intrinsics intrinsics = testIntrinsics();
+
+    // The span views the board points without copying them
+    calib::PointSpan table(point_set);
+    CHECK(table.size() == point_set.size() && table.data() == point_set.data());
+
+    // Intrinsics survive the round trip through Camera
+    const calib::Camera camera = calib::toCamera(intrinsics);
+    const calib::Intrinsics back = calib::toIntrinsics(camera);
+    CHECK(cv::norm(back.camera_matrix, intrinsics.camera_matrix, cv::NORM_INF) == 0);
+    CHECK(cv::norm(back.dist_coeffs, intrinsics.dist_coeffs, cv::NORM_INF) == 0);
+
+    cv::Mat rvec = (cv::Mat_<double>(3, 1) << 0.3, -0.2, 0.1);
+    cv::Mat tvec = (cv::Mat_<double>(3, 1) << -4.0, 2.0, 30.0);
+    const calib::Pose pose = calib::toPose(rvec, tvec);
+    cv::Matx33d R;
+    cv::Rodrigues(rvec, R);
+    CHECK(cv::norm(pose.rotation(), R, cv::NORM_INF) < 1e-12);
+
+    // Projection, pose and error agree with the Mat interface
+    std::vector<cv::Point2f> expected, projected;
+    cv::projectPoints(point_set, rvec, tvec, intrinsics.camera_matrix, intrinsics.dist_coeffs, expected);
+    calib::projectPoints(table, pose, camera, projected);
+    CHECK(cv::norm(expected, projected, cv::NORM_INF) < 1e-3);
+
+    calib::Pose solved;
+    CHECK(calib::solvePose(table, projected, camera, solved));
+    CHECK(cv::norm(solved.rvec, pose.rvec, cv::NORM_INF) < 1e-4);
+    CHECK(cv::norm(solved.tvec, pose.tvec, cv::NORM_INF) < 1e-3);
+    cv::Mat solved_rvec, solved_tvec;
+    CHECK(calib::solvePose(point_set, projected, intrinsics, solved_rvec, solved_tvec));
+    CHECK(cv::norm(solved_rvec, cv::Mat(solved.rvec), cv::NORM_INF) < 1e-12);
+    CHECK_NEAR(calib::reprojectionError(table, expected, camera, solved),
+               calib::reprojectionError(point_set, expected, intrinsics, solved_rvec, solved_tvec), 1e-9);
+}
+
+TEST(PoseSolversAgreeAndTrackerKeepsPose) {
+    calib::Config cfg;
+    std::vector<cv::Vec3f> point_set = calib::boardPoints(cfg);
+    const calib::Camera camera = calib::toCamera(testIntrinsics());
+    calib::Pose truth;
+    truth.rvec = cv::Vec3d(0.2, 0.1, 0.05);
+    truth.tvec = cv::Vec3d(-4.0, 2.0, 20.0);
+    std::vector<cv::Point2f> corners;
+    calib::projectPoints(point_set, truth, camera, corners);
+
+    for (calib::PoseSolver solver : {calib::PoseSolver::Iterative, calib::PoseSolver::Ippe, calib::PoseSolver::Sqpnp}) {
+        calib::PoseOptions options;
+        options.solver = solver;
+        calib::Pose pose;
+        CHECK(calib::solvePose(point_set, corners, camera, pose, options));
+        CHECK(cv::norm(pose.rvec, truth.rvec) < 1e-4);
+        CHECK(cv::norm(pose.tvec, truth.tvec) < 1e-3);
+    }
+
+    // Points off the board plane fall back from IPPE
+    std::vector<cv::Vec3f> raised = point_set;
+    raised.push_back(cv::Vec3f(0, 0, -2));
+    raised.push_back(cv::Vec3f(8, -5, -2));
+    std::vector<cv::Point2f> raised_corners;
+    calib::projectPoints(raised, truth, camera, raised_corners);
+    calib::Pose pose;
+    CHECK(calib::solvePose(raised, raised_corners, camera, pose));
+    CHECK(cv::norm(pose.tvec, truth.tvec) < 1e-3);
+
+    // Far away the board's mirror-image pose fits noisy corners about as
+    // well; the tracker keeps to the pose of the previous, closer frame
+    calib::Pose far = truth;
+    far.tvec[2] = 120.0;
+    std::vector<cv::Point2f> far_corners;
+    calib::projectPoints(point_set, far, camera, far_corners);
+    auto degreesFromTruth = [&](const calib::Pose& p) {
+        const double c = (cv::trace(p.rotation().t() * truth.rotation()) - 1.0) / 2.0;
+        return std::acos(std::min(1.0, std::max(-1.0, c))) * 180.0 / CV_PI;
+    };
+    cv::RNG rng(5);
+    calib::PoseTracker tracker;
+    int best_wrong = 0, tracked_wrong = 0;
+    for (int trial = 0; trial < 100; ++trial) {
+        std::vector<cv::Point2f> noisy = far_corners;
+        for (auto& c : noisy) {
+            c.x += static_cast<float>(rng.gaussian(0.5));
+            c.y += static_cast<float>(rng.gaussian(0.5));
+        }
+        calib::Pose best, tracked;
+        CHECK(calib::solvePose(point_set, noisy, camera, best));
+        tracker.reset();
+        CHECK(tracker.solve(point_set, corners, camera, tracked));
+        CHECK(tracker.solve(point_set, noisy, camera, tracked));
+        best_wrong += degreesFromTruth(best) > 5.0;
+        tracked_wrong += degreesFromTruth(tracked) > 5.0;
+    }
+    CHECK(tracked_wrong < best_wrong);
+    CHECK(tracker.stats().solved == 200 && tracker.stats().ambiguous > 0 && tracker.stats().flipped > 0);
+
+    CHECK(calib::applySetting(cfg, "pose_solver", "sqpnp"));
+    CHECK(calib::poseOptions(cfg).solver == calib::PoseSolver::Sqpnp);
+    CHECK(!calib::applySetting(cfg, "pose_solver", "epnp"));
+}
+
+TEST(DetectionCacheHitsByPathAndContent) {
+    namespace fs = std::filesystem;
+    const std::string dir = "detection_cache_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::copy_file(kSourceDir + "/checkerboard.png", dir + "/a.png");
+    calib::Config cfg;
+    cfg.detection_cache_gray = true;
+    {
+        calib::DetectionCache cache;
+        CHECK(cache.open(dir + "/cache", cfg));
+        calib::Detection first, second;
+        CHECK(cache.detect(dir + "/a.png", cfg, first));
+        CHECK(first.found() && first.corners.size() == 54);
+        CHECK(cache.detect(dir + "/a.png", cfg, second));
+        CHECK(second.corners == first.corners && second.image_size == first.image_size);
+        CHECK(cache.stats().misses == 1 && cache.stats().hits == 1 && cache.stats().hashed == 1);
+
+        // A copy is found by its content
+        fs::copy_file(dir + "/a.png", dir + "/b.png");
+        calib::Detection copy;
+        cv::Mat image;
+        CHECK(cache.detect(dir + "/b.png", cfg, copy, nullptr, &image));
+        CHECK(copy.corners == first.corners && image.size() == first.image_size);
+        CHECK(cache.stats().hits == 2 && cache.stats().hashed == 2);
+
+        cv::Mat gray;
+        CHECK(cache.loadGray(dir + "/b.png", gray));
+        CHECK(gray.size() == first.image_size && gray.type() == CV_8U);
+        CHECK(!cache.detect(dir + "/missing.png", cfg, copy));
+    }
+
+    // Persisted by the destructor; other detection settings miss
+    calib::DetectionCache reopened;
+    CHECK(reopened.open(dir + "/cache", cfg));
+    calib::Detection detection;
+    CHECK(reopened.detect(dir + "/a.png", cfg, detection));
+    CHECK(reopened.stats().hits == 1 && reopened.stats().hashed == 0);
+    calib::Config other = cfg;
+    other.subpix_window = 5;
+    CHECK(calib::detectionParamsHash(other) != calib::detectionParamsHash(cfg));
+    calib::DetectionCache changed;
+    CHECK(changed.open(dir + "/cache", other));
+    CHECK(changed.detect(dir + "/a.png", other, detection));
+    CHECK(changed.stats().misses == 1 && detection.found());
+
+    const std::string text = "calibration";
+    CHECK(calib::contentHash(text.data(), text.size()) != calib::contentHash(text.data(), text.size() - 1));
+    fs::remove_all(dir);
+}
+
+TEST(QualityControllerHoldsBudgetWithHysteresis) {
+    calib::Config cfg;
+    cfg.quality_adaptive = true;
+    cfg.quality_budget_ms = 2.0;
+    cfg.quality_hold_frames = 5;
+    const int last = static_cast<int>(calib::qualityLevels(cfg).size()) - 1;
+
+    // Slow frames step down to the cheapest level, fast ones back up
+    calib::QualityController controller(cfg);
+    for (int i = 0; i < 60; ++i) {
+        controller.beginFrame();
+        std::this_thread::sleep_for(std::chrono::milliseconds(4));
+        controller.endFrame();
+    }
+    CHECK(controller.metrics().level == last && controller.metrics().lowered == last);
+    CHECK(controller.level().detect_every > 1 && !controller.level().overlay_detail);
+    for (int i = 0; i < 100; ++i) {
+        controller.beginFrame();
+        controller.endFrame();
+    }
+    CHECK(controller.metrics().level == 0 && controller.metrics().raised == last);
+    CHECK(controller.level().subpix_window == cfg.subpix_window);
+    CHECK(controller.metrics().frames == 160 && controller.metrics().over_budget >= 60);
+
+    // Every level finds the board; the cheap ones track between detections
+    cv::Mat gray;
+    calib::toGray(cv::imread(kSourceDir + "/checkerboard.png"), gray);
+    std::vector<cv::Point2f> reference;
+    CHECK(calib::detectBoard(gray, cfg, reference));
+    cfg.quality_budget_ms = 1e-6;
+    calib::QualityController lowering(cfg);
+    calib::BoardGate gate(cfg);
+    bool all_found = true;
+    double worst = 0.0;
+    for (int i = 0; i < 60; ++i) {
+        lowering.beginFrame();
+        std::vector<cv::Point2f> corners;
+        all_found = all_found && lowering.detect(gray, corners, gate) && corners.size() == reference.size();
+        for (size_t c = 0; c < corners.size() && c < reference.size(); ++c) {
+            worst = std::max(worst, static_cast<double>(cv::norm(corners[c] - reference[c])));
+        }
+        lowering.endFrame();
+    }
+    CHECK(all_found);
+    CHECK(worst < 0.25);
+    CHECK(lowering.metrics().level == last && lowering.metrics().tracked > 0);
+
+    CHECK(!calib::applySetting(cfg, "quality_raise_below", "1.5"));
+}
+
+TEST(MultiBoardDetectorFindsAndTracksEveryBoard) {
+    // Two 9x6 boards and a 7x5 board, with a white border of one square
+    auto board = [](cv::Size inner, int square) {
+        cv::Mat image(inner.height * square + 3 * square, inner.width * square + 3 * square, CV_8U, cv::Scalar(255));
+        for (int r = 0; r <= inner.height; ++r) {
+            for (int c = 0; c <= inner.width; ++c) {
+                if ((r + c) % 2 == 0) image(cv::Rect(square + c * square, square + r * square, square, square)) = 0;
+            }
+        }
+        return image;
+    };
+    auto scene = [&](int dx) {
+        cv::Mat gray(1080, 1920, CV_8U, cv::Scalar(200));
+        board(cv::Size(9, 6), 40).copyTo(gray(cv::Rect(cv::Point(100 + dx, 100), cv::Size(480, 360))));
+        board(cv::Size(7, 5), 36).copyTo(gray(cv::Rect(cv::Point(1100 + dx, 500), cv::Size(360, 288))));
+        board(cv::Size(9, 6), 30).copyTo(gray(cv::Rect(cv::Point(150 + dx, 600), cv::Size(360, 270))));
+        cv::GaussianBlur(gray, gray, cv::Size(3, 3), 0.8);
+        return gray;
+    };
+
+    calib::Config cfg;
+    CHECK(calib::applySetting(cfg, "boards", "9x6, 7x5:0.5, 9x6"));
+    CHECK(!calib::applySetting(cfg, "boards", "9x6, 7by5"));
+    CHECK(cfg.boardSpecs().size() == 3 && cfg.boardSpecs()[1].size == cv::Size(7, 5));
+    CHECK_NEAR(cfg.boardSpecs()[1].square_size, 0.5, 1e-12);
+
+    calib::MultiBoardDetector detector(cfg);
+    std::vector<calib::BoardDetection> detections;
+    detector.detect(scene(0), detections);
+    CHECK(detections.size() == 3);
+    for (const calib::BoardDetection& detection : detections) {
+        CHECK(!detection.tracked);
+        CHECK(detection.corners.size() == detector.points(detection.board).size());
+    }
+
+    // The next frames find each board in its own region, with its own index
+    const cv::Point2f first = detections[0].corners[0], second = detections[2].corners[0];
+    const calib::Camera camera = calib::toCamera(calib::initialIntrinsics(cv::Size(1920, 1080)));
+    for (int dx : {6, 12}) {
+        detector.detect(scene(dx), detections);
+        CHECK(detections.size() == 3);
+        for (const calib::BoardDetection& detection : detections) CHECK(detection.tracked);
+        CHECK(cv::norm(detections[0].corners[0] - first - cv::Point2f(static_cast<float>(dx), 0)) < 0.1);
+        CHECK(cv::norm(detections[2].corners[0] - second - cv::Point2f(static_cast<float>(dx), 0)) < 0.1);
+        detector.solvePoses(camera, detections);
+        for (const calib::BoardDetection& detection : detections) CHECK(detection.posed && detection.error < 0.5);
+    }
+    CHECK(detector.stats().frames == 3 && detector.stats().found == 9 && detector.stats().tracked == 6);
+
+    // A frame without boards loses them all
+    detector.detect(cv::Mat(1080, 1920, CV_8U, cv::Scalar(200)), detections);
+    CHECK(detections.empty());
+}
+
+TEST(RasterizerFillsAndDepthTestsMeshes) {
+    calib::Camera camera;
+    camera.K = cv::Matx33d(500, 0, 320, 0, 500, 240, 0, 0, 1);
+    const calib::Pose pose{cv::Vec3d(0, 0, 0), cv::Vec3d(0, 0, 0)};
+    const calib::Mesh far_box = calib::boxMesh(cv::Vec3f(-1, -1, 4), cv::Vec3f(1, 1, 6), cv::Scalar(0, 0, 255));
+    const calib::Mesh near_box =
+        calib::boxMesh(cv::Vec3f(-0.25f, -0.25f, 2), cv::Vec3f(0.25f, 0.25f, 3), cv::Scalar(0, 255, 0));
+    const calib::Mesh behind = calib::boxMesh(cv::Vec3f(-1, -1, -3), cv::Vec3f(1, 1, -2), cv::Scalar(255, 0, 0));
+
+    for (calib::Shading shading : {calib::Shading::Flat, calib::Shading::Gouraud}) {
+        calib::RasterOptions options;
+        options.shading = shading;
+        calib::Rasterizer rasterizer(options);
+
+        // The nearer box wins whichever is drawn first
+        cv::Mat frames[2];
+        for (int order = 0; order < 2; ++order) {
+            rasterizer.begin(cv::Size(640, 480));
+            rasterizer.draw(order ? near_box : far_box, camera, pose);
+            rasterizer.draw(order ? far_box : near_box, camera, pose);
+            rasterizer.draw(behind, camera, pose);
+            frames[order] = cv::Mat::zeros(480, 640, CV_8UC3);
+            rasterizer.render(frames[order]);
+        }
+        CHECK(cv::norm(frames[0], frames[1], cv::NORM_INF) == 0);
+        CHECK(rasterizer.stats().triangles == 36 && rasterizer.stats().dropped == 12);
+        CHECK(rasterizer.stats().tiles > 0 && rasterizer.stats().tiles < 20 * 15);
+
+        // Both front faces are lit well above the ambient level
+        const cv::Vec3b center = frames[0].at<cv::Vec3b>(240, 320);
+        const cv::Vec3b ring = frames[0].at<cv::Vec3b>(240, 320 + 100);
+        CHECK(center[1] > 200 && center[0] == 0 && center[2] == 0);
+        CHECK(ring[2] > 200 && ring[0] == 0 && ring[1] == 0);
+        // Outside the far box's silhouette (125 pixels around the centre) the frame is untouched
+        CHECK(frames[0].at<cv::Vec3b>(240, 320 + 130) == cv::Vec3b(0, 0, 0));
+        CHECK(frames[0].at<cv::Vec3b>(5, 5) == cv::Vec3b(0, 0, 0));
+    }
+
+    // Vertex normals of a sphere point away from its centre
+    const calib::Mesh sphere = calib::sphereMesh(cv::Vec3f(1, 2, 3), 2.0f, 8, 16, cv::Scalar(255, 255, 255));
+    CHECK(sphere.triangles.size() == 2 * 8 * 16);
+    const cv::Vec3f radial = sphere.vertices[40] - cv::Vec3f(1, 2, 3);
+    CHECK_NEAR(sphere.normals[40].dot(radial * 0.5f), 1.0, 0.05);
+}
+
+int main() {
+    return calib_test::runAllTests();
+}
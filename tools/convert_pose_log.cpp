@@ -0,0 +1,77 @@
+// Convert a text pose log (rotation_translation_vectors.txt as written by
+// task4/task5, or rotations_translations.txt from task3) into a binary
+// trajectory file, then read it back to verify it.
+//
+//   ./convert_pose_log --input=rotation_translation_vectors.txt --trajectory_file=poses.ctraj
+//
+// The text log has no timestamps, so poses are timed at input_fps.
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "calib/calib.hpp"
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    cfg.input = "rotation_translation_vectors.txt";
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
+    if (cfg.trajectory_file.empty()) {
+        std::cerr << "Error: No trajectory_file given" << std::endl;
+        return -1;
+    }
+
+    int64_t start_ticks = cv::getTickCount();
+    std::vector<int64_t> frames;
+    std::vector<cv::Vec3d> rvecs, tvecs;
+    if (!calib::loadPoseLog(cfg.input, frames, rvecs, tvecs)) {
+        return -1;
+    }
+    double parse_ms = (cv::getTickCount() - start_ticks) * 1000.0 / cv::getTickFrequency();
+
+    calib::TrajectoryWriter writer;
+    if (!writer.open(cfg.trajectory_file, calib::trajectoryOptions(cfg))) {
+        return -1;
+    }
+    for (size_t i = 0; i < frames.size(); ++i) {
+        calib::PoseSample pose;
+        pose.frame = frames[i];
+        pose.timestamp = frames[i] / cfg.input_fps;
+        pose.rvec = rvecs[i];
+        pose.tvec = tvecs[i];
+        pose.error = std::numeric_limits<double>::quiet_NaN();
+        if (!writer.append(pose)) {
+            return -1;
+        }
+    }
+    if (!writer.close()) {
+        return -1;
+    }
+
+    // Read the result back and check it against the parsed log
+    start_ticks = cv::getTickCount();
+    calib::TrajectoryReader reader;
+    calib::TrajectoryColumns columns;
+    if (!reader.open(cfg.trajectory_file) || !reader.readAll(columns)) {
+        return -1;
+    }
+    double load_ms = (cv::getTickCount() - start_ticks) * 1000.0 / cv::getTickFrequency();
+
+    double max_error = 0.0;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        max_error = std::max(max_error, cv::norm(columns.rvec[i] - rvecs[i], cv::NORM_INF));
+        max_error = std::max(max_error, cv::norm(columns.tvec[i] - tvecs[i], cv::NORM_INF));
+    }
+    if (columns.size() != frames.size() || (!cfg.trajectory_float32 && max_error > 0.0)) {
+        std::cerr << "Error: " << cfg.trajectory_file << " does not match " << cfg.input << std::endl;
+        return -1;
+    }
+
+    std::cout << "Converted " << columns.size() << " poses from " << cfg.input << " to " << cfg.trajectory_file
+              << " in " << reader.chunkCount() << " chunks" << std::endl;
+    std::cout << "Text parse: " << parse_ms << " ms, trajectory load: " << load_ms
+              << " ms, max difference: " << max_error << std::endl;
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Persist the annotated frames task4/task5 publish on frame_channel, so image
+// encoding happens in this process rather than on the tracker's hot path.
+//
+//   ./task5 --frame_channel=/calib_frames &
+//   ./frame_recorder --frame_channel=/calib_frames --record_output=frame_%06d.png
+//   ./frame_recorder --frame_channel=/calib_frames --record_output=annotated.avi
+//
+// Each frame is copied out of the ring and checked before encoding; frames
+// the tracker overwrote first are counted as lost. Recording stops once no
+// frame has arrived for two seconds.
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "calib/calib.hpp"
+
+int main(int argc, char** argv) {
+    calib::Config cfg;
+    cfg.frame_channel = "/calib_frames";
+    if (!calib::loadConfig(argc, argv, cfg)) {
+        return -1;
+    }
+
+    // The tracker creates the channel on its first frame
+    calib::FrameSubscriber subscriber;
+    for (int attempt = 0; !subscriber.open(cfg.frame_channel); ++attempt) {
+        if (attempt == 100) return -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    const bool sequence = cfg.record_output.find('%') != std::string::npos;
+    cv::VideoWriter video;
+    calib::SharedFrame shared;
+    cv::Mat image;
+    int64_t written = 0, torn = 0;
+    int64_t start_ticks = cv::getTickCount();
+
+    while (subscriber.wait(shared, 2.0)) {
+        shared.image.copyTo(image);
+        if (!subscriber.valid(shared)) {
+            torn++;
+            continue;
+        }
+
+        if (sequence) {
+            char filename[4096];
+            std::snprintf(filename, sizeof(filename), cfg.record_output.c_str(), static_cast<int>(written));
+            if (!cv::imwrite(filename, image)) {
+                std::cerr << "Error: Could not write " << filename << std::endl;
+                return -1;
+            }
+        } else {
+            if (!video.isOpened() &&
+                !video.open(cfg.record_output, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), cfg.input_fps,
+                            image.size(), image.channels() == 3)) {
+                std::cerr << "Error: Could not open " << cfg.record_output << " for writing" << std::endl;
+                return -1;
+            }
+            video.write(image);
+        }
+        written++;
+    }
+    video.release();
+
+    double seconds = (cv::getTickCount() - start_ticks) / cv::getTickFrequency();
+    std::cout << "Recorded " << written << " frames to " << cfg.record_output << " in " << seconds << " s, "
+              << subscriber.lost() + torn << " lost" << std::endl;
+    return 0;
+}
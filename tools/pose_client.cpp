@@ -0,0 +1,80 @@
+// Minimal pose channel client: prints every pose task4/task5 publish and the
+// publish-to-receive latency. Needs only calib_pose, not OpenCV.
+//
+//   ./task4 --pose_channel=/calib_pose --display=false &
+//   ./pose_client /calib_pose          # subscribe, until Ctrl-C
+//   ./pose_client /calib_pose 500      # stop after 500 poses
+//   ./pose_client /calib_pose --poll   # sample the latest pose at 10 Hz
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "calib/pose_channel.hpp"
+
+int main(int argc, char** argv) {
+    std::string name = "/calib_pose";
+    long limit = 0;
+    bool poll = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--poll") == 0) {
+            poll = true;
+        } else if (argv[i][0] == '/') {
+            name = argv[i];
+        } else {
+            limit = std::strtol(argv[i], nullptr, 10);
+        }
+    }
+
+    calib::PoseSubscriber subscriber;
+    // The tracker may still be starting up
+    for (int attempt = 0; !subscriber.open(name); ++attempt) {
+        if (attempt == 50) return -1;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    auto print = [](const calib::PoseMessage& pose, double latency_us) {
+        std::printf("#%llu frame %lld t=%.3f rvec=[%.5f %.5f %.5f] tvec=[%.5f %.5f %.5f] err=%.3f px (%.0f us)\n",
+                    static_cast<unsigned long long>(pose.sequence), static_cast<long long>(pose.frame),
+                    pose.timestamp, pose.rvec[0], pose.rvec[1], pose.rvec[2], pose.tvec[0], pose.tvec[1],
+                    pose.tvec[2], pose.error, latency_us);
+    };
+
+    if (poll) {
+        calib::PoseMessage pose;
+        for (long n = 0; limit <= 0 || n < limit; ++n) {
+            if (subscriber.latest(pose)) {
+                print(pose, (calib::monotonicSeconds() - pose.published_at) * 1e6);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return 0;
+    }
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::vector<double> latencies;
+    subscriber.subscribe([&](const calib::PoseMessage& pose) {
+        double latency_us = (calib::monotonicSeconds() - pose.published_at) * 1e6;
+        print(pose, latency_us);
+        std::lock_guard<std::mutex> lock(mutex);
+        latencies.push_back(latency_us);
+        if (limit > 0 && static_cast<long>(latencies.size()) >= limit) done.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return limit > 0 && static_cast<long>(latencies.size()) >= limit; });
+    }
+    subscriber.unsubscribe();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "Received " << latencies.size() << " poses, " << subscriber.lost() << " lost; latency median "
+              << latencies[latencies.size() / 2] << " us, max " << latencies.back() << " us" << std::endl;
+    return 0;
+}